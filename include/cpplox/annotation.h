@@ -0,0 +1,59 @@
+#pragma once
+
+#include <any>
+#include <string>
+#include <typeinfo>
+
+#include "loxstring.h"
+
+namespace CppLox
+{
+  // A declared type: `var x: num`, `fun f(a: str): bool`. Values stored
+  // into an annotated variable or parameter, and values returned from an
+  // annotated function, are checked once at the store, so code reading
+  // them can rely on the type.
+  //
+  // Annotations do not change how values are stored: an annotated local
+  // is still a std::any in its environment, since `num` covers both the
+  // int64 and the double representation. TypeInference trusts them
+  // instead: arithmetic whose operands are annotated locals, parameters,
+  // or (in a script file) globals declared once is marked proven, and the
+  // interpreter skips its operand checks.
+  enum class Annotation
+  {
+    NONE,
+    NUM,
+    STR,
+    BOOL
+  };
+
+  inline const char *annotationName(Annotation annotation)
+  {
+    switch (annotation)
+    {
+    case Annotation::NUM:
+      return "num";
+    case Annotation::STR:
+      return "str";
+    case Annotation::BOOL:
+      return "bool";
+    default:
+      return "any";
+    }
+  }
+
+  inline bool hasType(const std::any &value, Annotation annotation)
+  {
+    switch (annotation)
+    {
+    case Annotation::NUM:
+      return value.type() == typeid(double) || value.type() == typeid(int64_t);
+    case Annotation::STR:
+      return value.type() == typeid(LoxStringRef);
+    case Annotation::BOOL:
+      return value.type() == typeid(bool);
+    default:
+      return true;
+    }
+  }
+}
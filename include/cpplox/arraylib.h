@@ -0,0 +1,18 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "environment.h"
+#include "native.h"
+
+namespace CppLox
+{
+  // Defines Float64Array(n), which makes an array of n zeros, and its bulk
+  // operations: sum, dot, min and max reduce; axpy(alpha, x, y) (y +=
+  // alpha * x) and scale(a, s) update in place; add and mul return a new
+  // array; sort orders in place with NaNs last, and also sorts lists. The
+  // loops run on SIMD lanes rather than one Lox value at a time.
+  void defineArrayLibrary(Environment &globals);
+  // Whether name is one of the functions above.
+  bool isArrayLibraryFunction(const std::string &name);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+#include "interpreter.h"
+
+namespace CppLox
+{
+  enum class NodeTag : uint8_t
+  {
+    NULL_NODE,
+    BINARY,
+    CALL,
+    GET,
+    SET,
+    SUPER,
+    GROUPING,
+    LITERAL,
+    THIS,
+    UNARY,
+    VARIABLE,
+    ASSIGN,
+    LOGICAL,
+    BLOCK,
+    CLASS,
+    EXPRESSION,
+    PRINT,
+    RETURN,
+    VAR,
+    FUNCTION,
+    IF,
+    WHILE,
+    INTERPOLATION,
+    INDEX,
+    SET_INDEX,
+    SLICE
+  };
+
+  // Persists the resolved AST of a script as a compact binary .loxc file,
+  // keyed by a hash of the source, so later runs can skip the front end.
+  // The header also holds the source's length and a checksum of the tree;
+  // a file whose length or checksum does not match is ignored and the
+  // script is parsed again.
+  class AstCache
+  {
+  public:
+    AstCache(std::string directory, std::shared_ptr<Interpreter> interpreter) : directory(std::move(directory)), interpreter(interpreter) {}
+    bool load(const std::string &source, std::vector<StmtPtr> &stmts);
+    void store(const std::string &source, const std::vector<StmtPtr> &stmts);
+
+    static uint64_t hash(const std::string &source);
+    static uint64_t hash(const char *data, size_t size);
+
+  private:
+    std::string directory;
+    std::shared_ptr<Interpreter> interpreter;
+
+    std::string pathFor(const std::string &source) const;
+  };
+
+  class AstWriter : public ExprVisitor<std::any>, public StmtVisitor<std::any>
+  {
+  public:
+    AstWriter(const Interpreter &interpreter, std::string &out) : interpreter(interpreter), out(out) {}
+    std::any visitBinaryExpr(const Binary *expr) override;
+    std::any visitGroupingExpr(const Grouping *expr) override;
+    std::any visitLiteralExpr(const Literal *expr) override;
+    std::any visitUnaryExpr(const Unary *expr) override;
+    std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
+    std::any visitExpressionStmt(const Expression *stmt) override;
+    std::any visitPrintStmt(const Print *stmt) override;
+    std::any visitVariableExpr(const Variable *expr) override;
+    std::any visitVarStmt(const Var *stmt) override;
+    std::any visitAssignExpr(const Assign *expr) override;
+    std::any visitBlockStmt(const Block *stmt) override;
+    std::any visitIfStmt(const If *stmt) override;
+    std::any visitWhileStmt(const While *stmt) override;
+    std::any visitCallExpr(const Call *expr) override;
+    std::any visitFunctionStmt(const Function *stmt) override;
+    std::any visitReturnStmt(const Return *stmt) override;
+    std::any visitClassStmt(const Class *stmt) override;
+    std::any visitGetExpr(const Get *expr) override;
+    std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
+    std::any visitThisExpr(const This *expr) override;
+    std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
+    void writeProgram(size_t sourceSize, const std::vector<StmtPtr> &stmts);
+
+  private:
+    const Interpreter &interpreter;
+    std::string &out;
+
+    void write(const std::vector<StmtPtr> &stmts);
+    void write(const StmtPtr &stmt);
+    void write(const ExprPtr &expr);
+    void writeTag(NodeTag tag);
+    void writeVarint(uint64_t value);
+    void writeString(const std::string &value);
+    void writeLiteral(const LiteralType &value);
+    void writeToken(const Token &token);
+    void writeAnnotation(Annotation annotation);
+    void writeDepth(const Expr *expr);
+  };
+
+  class AstReader
+  {
+  public:
+    AstReader(Interpreter &interpreter, const char *data, size_t size) : interpreter(interpreter), data(data), size(size) {}
+    std::vector<StmtPtr> readProgram(size_t sourceSize);
+
+  private:
+    Interpreter &interpreter;
+    const char *data;
+    size_t size;
+    size_t pos = 0;
+    std::vector<std::pair<const Expr *, int>> depths;
+
+    StmtPtr readStmt();
+    ExprPtr readExpr();
+    std::vector<StmtPtr> readStmts();
+    NodeTag readTag();
+    uint8_t readByte();
+    uint64_t readVarint();
+    std::string readString();
+    LiteralType readLiteral();
+    Token readToken();
+    Annotation readAnnotation();
+    void readDepth(const Expr *expr);
+  };
+}
@@ -6,10 +6,12 @@
 #include <sstream>
 
 #include "expr.h"
+#include "numberformat.h"
+#include "stmt.h"
 
 namespace CppLox
 {
-  class AstPrinter : public ExprVisitor<std::any>
+  class AstPrinter : public ExprVisitor<std::any>, public StmtVisitor<std::any>
   {
   public:
     std::any print(Expr &expr)
@@ -17,6 +19,17 @@ namespace CppLox
       return expr.accept(*this);
     }
 
+    // Prints one statement per line, nesting bodies by indentation.
+    std::string print(const std::vector<StmtPtr> &stmts)
+    {
+      std::ostringstream oss;
+      for (const auto &stmt : stmts)
+      {
+        oss << printStmt(stmt.get());
+      }
+      return oss.str();
+    }
+
     std::string parenthesize(const std::string &name, const std::vector<std::reference_wrapper<Expr>> exprs)
     {
       std::ostringstream oss;
@@ -55,6 +68,18 @@ namespace CppLox
 
     std::any visitLiteralExpr(const Literal *expr) override
     {
+      if (std::holds_alternative<std::string>(expr->value))
+      {
+        return std::any("\"" + std::get<std::string>(expr->value) + "\"");
+      }
+      if (std::holds_alternative<std::nullptr_t>(expr->value))
+      {
+        return std::any(std::string("nil"));
+      }
+      if (std::holds_alternative<double>(expr->value))
+      {
+        return std::any(formatNumber(std::get<double>(expr->value)));
+      }
       return std::any(literal_to_string(expr->value));
     }
 
@@ -62,5 +87,254 @@ namespace CppLox
     {
       return std::any(parenthesize(expr->op.lexeme, {*expr->right}));
     }
+
+    std::any visitCallExpr(const Call *expr) override
+    {
+      std::vector<std::reference_wrapper<Expr>> exprs = {*expr->callee};
+      for (const auto &argument : expr->arguments)
+      {
+        exprs.push_back(*argument);
+      }
+      return std::any(parenthesize("call", exprs));
+    }
+
+    std::any visitGetExpr(const Get *expr) override
+    {
+      return std::any(parenthesize(". " + expr->name.lexeme, {*expr->object}));
+    }
+
+    std::any visitSetExpr(const Set *expr) override
+    {
+      return std::any(parenthesize(".= " + expr->name.lexeme, {*expr->object, *expr->value}));
+    }
+
+    std::any visitIndexExpr(const Index *expr) override
+    {
+      return std::any(parenthesize("[]", {*expr->object, *expr->index}));
+    }
+
+    std::any visitSetIndexExpr(const SetIndex *expr) override
+    {
+      return std::any(parenthesize("[]=", {*expr->object, *expr->index, *expr->value}));
+    }
+
+    std::any visitSliceExpr(const Slice *expr) override
+    {
+      return std::any(parenthesize("[:]", {*expr->object, *expr->start, *expr->end}));
+    }
+
+    std::any visitSuperExpr(const Super *expr) override
+    {
+      return std::any("(super " + expr->method.lexeme + ")");
+    }
+
+    std::any visitThisExpr(const This *expr) override
+    {
+      return std::any(std::string("this"));
+    }
+
+    std::any visitVariableExpr(const Variable *expr) override
+    {
+      return std::any(expr->name.lexeme);
+    }
+
+    std::any visitAssignExpr(const Assign *expr) override
+    {
+      return std::any(parenthesize("= " + expr->name.lexeme, {*expr->value}));
+    }
+
+    std::any visitLogicalExpr(const Logical *expr) override
+    {
+      return std::any(parenthesize(expr->op.lexeme, {*expr->left, *expr->right}));
+    }
+
+    std::any visitInterpolationExpr(const Interpolation *expr) override
+    {
+      std::string out = "(interpolate";
+      for (const auto &part : expr->parts)
+      {
+        out += " " + std::any_cast<std::string>(part->accept(*this));
+      }
+      return std::any(out + ")");
+    }
+
+    std::any visitAssignOpExpr(const AssignOp *expr) override
+    {
+      return std::any(parenthesize(expr->op.lexeme + "= " + expr->name.lexeme, {*expr->value}));
+    }
+
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override
+    {
+      return std::any(parenthesize(expr->op.lexeme + " " + expr->name.lexeme, {*expr->right}));
+    }
+
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override
+    {
+      return std::any(parenthesize("." + expr->op.lexeme + "= " + expr->name.lexeme, {*expr->object, *expr->value}));
+    }
+
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override
+    {
+      std::vector<std::reference_wrapper<Expr>> exprs = {*expr->callee};
+      for (const auto &argument : expr->arguments)
+      {
+        exprs.push_back(*argument);
+      }
+      exprs.push_back(*expr->body);
+      return std::any(parenthesize("inline", exprs));
+    }
+
+    std::any visitArgRefExpr(const ArgRef *expr) override
+    {
+      return std::any("$" + expr->name.lexeme);
+    }
+
+    std::any visitConditionalExpr(const Conditional *expr) override
+    {
+      return std::any(parenthesize("?:", {*expr->condition, *expr->thenBranch, *expr->elseBranch}));
+    }
+
+    std::any visitInvariantExpr(const Invariant *expr) override
+    {
+      return std::any(parenthesize("invariant", {*expr->expression}));
+    }
+
+    std::any visitBlockStmt(const Block *stmt) override
+    {
+      return std::any("(block\n" + printBody(stmt->statements) + indentation() + ")");
+    }
+
+    std::any visitClassStmt(const Class *stmt) override
+    {
+      std::string header = "(class " + stmt->name.lexeme;
+      if (stmt->superclass != nullptr)
+      {
+        header += " < " + std::any_cast<std::string>(print(*stmt->superclass));
+      }
+      return std::any(header + "\n" + printBody(stmt->methods) + indentation() + ")");
+    }
+
+    std::any visitExpressionStmt(const Expression *stmt) override
+    {
+      return std::any(parenthesize(";", {*stmt->expression}));
+    }
+
+    std::any visitPrintStmt(const Print *stmt) override
+    {
+      return std::any(parenthesize("print", {*stmt->expression}));
+    }
+
+    std::any visitReturnStmt(const Return *stmt) override
+    {
+      if (stmt->value == nullptr)
+      {
+        return std::any(std::string("(return)"));
+      }
+      return std::any(parenthesize("return", {*stmt->value}));
+    }
+
+    std::any visitVarStmt(const Var *stmt) override
+    {
+      std::string name = stmt->name.lexeme + annotated(stmt->annotation);
+      if (stmt->initializer == nullptr)
+      {
+        return std::any("(var " + name + ")");
+      }
+      return std::any(parenthesize("var " + name, {*stmt->initializer}));
+    }
+
+    std::any visitFunctionStmt(const Function *stmt) override
+    {
+      std::string params;
+      for (size_t i = 0; i < stmt->params.size(); i++)
+      {
+        params += (params.empty() ? "" : " ") + stmt->params[i].lexeme;
+        if (i < stmt->paramTypes.size())
+        {
+          params += annotated(stmt->paramTypes[i]);
+        }
+      }
+      return std::any("(fun " + stmt->name.lexeme + " (" + params + ")" + annotated(stmt->returnType) + "\n" + printBody(stmt->body) + indentation() + ")");
+    }
+
+    std::any visitIfStmt(const If *stmt) override
+    {
+      std::string out = parenthesize("if", {*stmt->condition});
+      out.pop_back();
+      out += "\n" + printNested(stmt->thenBranch.get());
+      if (stmt->elseBranch != nullptr)
+      {
+        out += printNested(stmt->elseBranch.get());
+      }
+      return std::any(out + indentation() + ")");
+    }
+
+    std::any visitWhileStmt(const While *stmt) override
+    {
+      std::string out = parenthesize("while", {*stmt->condition});
+      out.pop_back();
+      return std::any(out + "\n" + printNested(stmt->body.get()) + indentation() + ")");
+    }
+
+    std::any visitForLoopStmt(const ForLoop *stmt) override
+    {
+      std::string out = parenthesize("for", {*stmt->condition, *stmt->increment});
+      out.pop_back();
+      return std::any(out + "\n" + printBody(stmt->body) + indentation() + ")");
+    }
+
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override
+    {
+      std::string header = "counted " + stmt->name.lexeme;
+      if (stmt->materialize)
+      {
+        header += " materialized";
+      }
+      std::string out = parenthesize(header, {*stmt->start, *stmt->limit});
+      out.pop_back();
+      out += " " + stmt->op.lexeme + " " + stmt->stepOp.lexeme + formatNumber(stmt->step);
+      return std::any(out + "\n" + printBody(stmt->body) + indentation() + ")");
+    }
+
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override
+    {
+      return std::any("(hoisting\n" + printNested(stmt->loop.get()) + indentation() + ")");
+    }
+
+  private:
+    int depth = 0;
+
+    std::string indentation() const
+    {
+      return std::string(depth * 2, ' ');
+    }
+
+    static std::string annotated(Annotation annotation)
+    {
+      return annotation == Annotation::NONE ? "" : std::string(":") + annotationName(annotation);
+    }
+
+    std::string printStmt(const Stmt *stmt)
+    {
+      return indentation() + std::any_cast<std::string>(stmt->accept(*this)) + "\n";
+    }
+
+    std::string printNested(const Stmt *stmt)
+    {
+      depth++;
+      std::string out = printStmt(stmt);
+      depth--;
+      return out;
+    }
+
+    std::string printBody(const std::vector<StmtPtr> &stmts)
+    {
+      std::string out;
+      for (const auto &stmt : stmts)
+      {
+        out += printNested(stmt.get());
+      }
+      return out;
+    }
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <any>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+#include "interpreter.h"
+
+namespace CppLox
+{
+  // One variable declaration: a local `var`, parameter, function, class,
+  // `this`/`super`, or a global name (all top-level declarations and
+  // unresolved references of a name share one global binding).
+  struct Binding
+  {
+    std::string name;
+    bool global = false;
+    // The Var, Function or Class statement that introduced the name; for
+    // parameters, the Function that owns them.
+    const Stmt *declaration = nullptr;
+    // The function the binding lives in, nullptr at top level.
+    const Function *function = nullptr;
+    int declarations = 0;
+    int assignments = 0;
+    int reads = 0;
+    // Read or assigned from a function nested inside the declaring one.
+    bool captured = false;
+  };
+
+  // Maps every Variable/Assign/This/Super node (and the fused AssignOp and
+  // CompareVariable nodes) to the declaration it refers to, mirroring the
+  // Resolver's scopes and the depths it recorded.
+  class BindingAnalysis : public ExprVisitor<std::any>, public StmtVisitor<std::any>
+  {
+  public:
+    BindingAnalysis(const Interpreter &interpreter) : interpreter(interpreter) {}
+    std::any visitBinaryExpr(const Binary *expr) override;
+    std::any visitGroupingExpr(const Grouping *expr) override;
+    std::any visitLiteralExpr(const Literal *expr) override;
+    std::any visitUnaryExpr(const Unary *expr) override;
+    std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
+    std::any visitExpressionStmt(const Expression *stmt) override;
+    std::any visitPrintStmt(const Print *stmt) override;
+    std::any visitVariableExpr(const Variable *expr) override;
+    std::any visitVarStmt(const Var *stmt) override;
+    std::any visitAssignExpr(const Assign *expr) override;
+    std::any visitBlockStmt(const Block *stmt) override;
+    std::any visitIfStmt(const If *stmt) override;
+    std::any visitWhileStmt(const While *stmt) override;
+    std::any visitCallExpr(const Call *expr) override;
+    std::any visitFunctionStmt(const Function *stmt) override;
+    std::any visitReturnStmt(const Return *stmt) override;
+    std::any visitClassStmt(const Class *stmt) override;
+    std::any visitGetExpr(const Get *expr) override;
+    std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
+    std::any visitThisExpr(const This *expr) override;
+    std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
+    void analyze(const std::vector<StmtPtr> &stmts);
+
+    Binding *bindingFor(const Expr *expr) const;
+    Binding *bindingFor(const Stmt *declaration) const;
+    Binding *bindingFor(const Token *param) const;
+
+  private:
+    using BindingScope = std::unordered_map<std::string, Binding *>;
+
+    const Interpreter &interpreter;
+    std::vector<std::unique_ptr<Binding>> bindings;
+    std::vector<BindingScope> scopes;
+    BindingScope globals;
+    std::vector<const Function *> functions;
+    std::unordered_map<const Expr *, Binding *> references;
+    std::unordered_map<const Stmt *, Binding *> declarations;
+    std::unordered_map<const Token *, Binding *> params;
+
+    void analyze(const StmtPtr &stmt);
+    void analyze(const ExprPtr &expr);
+    void analyzeFunction(const Function *stmt);
+    Binding *declare(const std::string &name, const Stmt *declaration);
+    Binding *lookup(const Expr *expr, const std::string &name);
+    Binding *lookup(const Expr *expr, const std::string &name, int depth);
+    const Function *currentFunction() const;
+  };
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <any>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+#include "interpreter.h"
+
+namespace CppLox
+{
+  extern const char *const C_RUNTIME;
+
+  // Translates a resolved (unoptimized) program into one C source file:
+  // a symbol table, the runtime in C_RUNTIME, one C function per Lox
+  // function and a main() for the top-level statements. Locals of scopes
+  // that no closure can capture become C locals; the rest live in heap
+  // environments addressed by the Resolver's depths. The output uses GNU
+  // statement expressions to keep Lox's left-to-right evaluation order.
+  class CEmitter : public ExprVisitor<std::any>, public StmtVisitor<std::any>
+  {
+  public:
+    CEmitter(std::shared_ptr<Interpreter> interpreter) : interpreter(interpreter) {}
+    // Returns false if the tree holds nodes only the optimizer creates, or
+    // uses indexing, slicing or the native libraries, which the C runtime
+    // lacks.
+    bool emit(const std::vector<StmtPtr> &stmts, std::ostream &out);
+
+    std::any visitBinaryExpr(const Binary *expr) override;
+    std::any visitGroupingExpr(const Grouping *expr) override;
+    std::any visitLiteralExpr(const Literal *expr) override;
+    std::any visitUnaryExpr(const Unary *expr) override;
+    std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
+    std::any visitExpressionStmt(const Expression *stmt) override;
+    std::any visitPrintStmt(const Print *stmt) override;
+    std::any visitVariableExpr(const Variable *expr) override;
+    std::any visitVarStmt(const Var *stmt) override;
+    std::any visitAssignExpr(const Assign *expr) override;
+    std::any visitBlockStmt(const Block *stmt) override;
+    std::any visitIfStmt(const If *stmt) override;
+    std::any visitWhileStmt(const While *stmt) override;
+    std::any visitCallExpr(const Call *expr) override;
+    std::any visitFunctionStmt(const Function *stmt) override;
+    std::any visitReturnStmt(const Return *stmt) override;
+    std::any visitClassStmt(const Class *stmt) override;
+    std::any visitGetExpr(const Get *expr) override;
+    std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
+    std::any visitThisExpr(const This *expr) override;
+    std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
+
+  private:
+    // One Resolver scope. A heap scope is an Env at runtime, with its names
+    // in slots; a stack scope's names are C locals of the current function.
+    struct Scope
+    {
+      explicit Scope(bool heap) : heap(heap) {}
+
+      bool heap;
+      int slots = 0;
+      std::unordered_map<std::string, std::string> names;
+    };
+
+    // The C function being written.
+    struct Frame
+    {
+      std::ostringstream body;
+      int indent = 1;
+      bool initializer = false;
+    };
+
+    std::shared_ptr<Interpreter> interpreter;
+    std::vector<Scope> scopes;
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::ostringstream functions;
+    std::ostringstream prototypes;
+    std::unordered_map<std::string, int> symbols;
+    std::vector<std::string> symbolNames;
+    std::vector<std::string> strings;
+    // Names the top level declares, which shadow the native libraries.
+    std::unordered_set<std::string> scriptGlobals;
+    int functionCount = 0;
+    int temporaries = 0;
+    bool supported = true;
+
+    std::string expression(const Expr &expr);
+    void statement(const Stmt &stmt);
+    void line(const std::string &code);
+    std::string temporary();
+    int symbol(const std::string &name);
+    std::string literalString(const std::string &value) const;
+    std::string expect(const std::string &value, Annotation annotation, const std::string &what, const Token &name) const;
+
+    void beginScope(bool heap, int slots);
+    std::string declare(const std::string &name);
+    void define(const std::string &name, const std::string &value, Annotation annotation = Annotation::NONE);
+    std::string variable(const std::string &name, const Expr *expr);
+    bool native(const std::string &name) const;
+    std::string binary(const std::string &function, const Expr &left, const Expr &right, int line);
+    std::string call(const char *function, const Expr &callee, const std::vector<ExprPtr> &arguments, int line);
+    std::string function(const Function *stmt, bool initializer);
+    std::any unsupported();
+  };
+}
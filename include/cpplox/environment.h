@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <iostream>
 
+#include "annotation.h"
 #include "token.h"
 #include "runtime_error.h"
 
@@ -30,6 +31,19 @@ namespace CppLox
       return ancestor(distance)->values[lexeme];
     }
 
+    // The resolved variable's storage, for read-modify-write in place.
+    std::any &slotAt(int distance, const std::string &lexeme)
+    {
+      return ancestor(distance)->values[lexeme];
+    }
+
+    // The value defined in this scope itself, or nullptr.
+    const std::any *find(const std::string &lexeme) const
+    {
+      auto it = values.find(lexeme);
+      return it != values.end() ? &it->second : nullptr;
+    }
+
     std::any get(const Token &name)
     {
       if (values.find(name.lexeme) != values.end())
@@ -45,6 +59,21 @@ namespace CppLox
     }
     void define(std::string name, std::any value)
     {
+      define(std::move(name), std::move(value), Annotation::NONE);
+    }
+
+    // Only globals keep their annotation here; locals are checked at the
+    // Assign nodes the TypeChecker marks.
+    void define(std::string name, std::any value, Annotation annotation)
+    {
+      if (annotation != Annotation::NONE)
+      {
+        annotations[name] = annotation;
+      }
+      else if (!annotations.empty())
+      {
+        annotations.erase(name);
+      }
       values[name] = value;
     }
 
@@ -57,6 +86,12 @@ namespace CppLox
     {
       if (values.find(name.lexeme) != values.end())
       {
+        if (!annotations.empty())
+        {
+          auto annotation = annotations.find(name.lexeme);
+          if (annotation != annotations.end() && !hasType(value, annotation->second))
+            throw RuntimeError(name, std::string("Expected a ") + annotationName(annotation->second) + " value for '" + name.lexeme + "'.");
+        }
         values[name.lexeme] = value;
         return;
       }
@@ -72,5 +107,6 @@ namespace CppLox
 
   private:
     std::unordered_map<std::string, std::any> values;
+    std::unordered_map<std::string, Annotation> annotations;
   };
 }
\ No newline at end of file
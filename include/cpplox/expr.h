@@ -3,17 +3,25 @@
 #include <memory>
 #include <utility>
 #include <any>
+#include <cstdint>
 
 #include "token.h"
+#include "quickening.h"
+#include "annotation.h"
 
 using namespace std;
 
 namespace CppLox {
 
+struct Function;
+struct InvariantLoop;
 class Binary;
 class Call;
 class Get;
 class Set;
+class Index;
+class SetIndex;
+class Slice;
 class Super;
 class Grouping;
 class Literal;
@@ -22,6 +30,14 @@ class Unary;
 class Variable;
 class Assign;
 class Logical;
+class Interpolation;
+class AssignOp;
+class CompareVariable;
+class SetFieldOp;
+class InlinedCall;
+class ArgRef;
+class Conditional;
+class Invariant;
 
 
 
@@ -39,6 +55,9 @@ public:
     virtual R visitCallExpr(const Call *expr) = 0;
     virtual R visitGetExpr(const Get *expr) = 0;
     virtual R visitSetExpr(const Set *expr) = 0;
+    virtual R visitIndexExpr(const Index *expr) = 0;
+    virtual R visitSetIndexExpr(const SetIndex *expr) = 0;
+    virtual R visitSliceExpr(const Slice *expr) = 0;
     virtual R visitSuperExpr(const Super *expr) = 0;
     virtual R visitGroupingExpr(const Grouping *expr) = 0;
     virtual R visitLiteralExpr(const Literal *expr) = 0;
@@ -47,6 +66,14 @@ public:
     virtual R visitVariableExpr(const Variable *expr) = 0;
     virtual R visitAssignExpr(const Assign *expr) = 0;
     virtual R visitLogicalExpr(const Logical *expr) = 0;
+    virtual R visitInterpolationExpr(const Interpolation *expr) = 0;
+    virtual R visitAssignOpExpr(const AssignOp *expr) = 0;
+    virtual R visitCompareVariableExpr(const CompareVariable *expr) = 0;
+    virtual R visitSetFieldOpExpr(const SetFieldOp *expr) = 0;
+    virtual R visitInlinedCallExpr(const InlinedCall *expr) = 0;
+    virtual R visitArgRefExpr(const ArgRef *expr) = 0;
+    virtual R visitConditionalExpr(const Conditional *expr) = 0;
+    virtual R visitInvariantExpr(const Invariant *expr) = 0;
 };
 
 class Expr
@@ -76,6 +103,8 @@ std::any accept(BaseExprVisitor &visitor) const override
     ExprPtr left;
      Token op;
      ExprPtr right;
+    mutable BinaryKind kind = BinaryKind::UNINITIALIZED;
+    mutable bool proven = false;
 
 };
 
@@ -147,6 +176,74 @@ std::any accept(BaseExprVisitor &visitor) const override
 using SetPtr = std::unique_ptr<Set>;
 
 
+struct Index : public Expr
+{
+
+Index(ExprPtr object,  Token bracket,  ExprPtr index) : object(std::move(object)), bracket(std::move(bracket)), index(std::move(index)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitIndexExpr(this));
+  return std::any();
+}
+
+    ExprPtr object;
+     Token bracket;
+     ExprPtr index;
+
+};
+
+using IndexPtr = std::unique_ptr<Index>;
+
+
+struct SetIndex : public Expr
+{
+
+SetIndex(ExprPtr object,  Token bracket,  ExprPtr index,  ExprPtr value) : object(std::move(object)), bracket(std::move(bracket)), index(std::move(index)), value(std::move(value)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitSetIndexExpr(this));
+  return std::any();
+}
+
+    ExprPtr object;
+     Token bracket;
+     ExprPtr index;
+     ExprPtr value;
+
+};
+
+using SetIndexPtr = std::unique_ptr<SetIndex>;
+
+
+struct Slice : public Expr
+{
+
+Slice(ExprPtr object,  Token bracket,  ExprPtr start,  ExprPtr end) : object(std::move(object)), bracket(std::move(bracket)), start(std::move(start)), end(std::move(end)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitSliceExpr(this));
+  return std::any();
+}
+
+    ExprPtr object;
+     Token bracket;
+     ExprPtr start;
+     ExprPtr end;
+
+};
+
+using SlicePtr = std::unique_ptr<Slice>;
+
+
 struct Super : public Expr
 {
 
@@ -202,6 +299,7 @@ std::any accept(BaseExprVisitor &visitor) const override
 }
 
     LiteralType value;
+    std::any materialized = toAny(value);
 
 };
 
@@ -243,6 +341,7 @@ std::any accept(BaseExprVisitor &visitor) const override
 
     Token op;
      ExprPtr right;
+    mutable bool proven = false;
 
 };
 
@@ -284,6 +383,7 @@ std::any accept(BaseExprVisitor &visitor) const override
 
     Token name;
      ExprPtr value;
+    mutable Annotation annotation = Annotation::NONE;
 
 };
 
@@ -311,4 +411,184 @@ std::any accept(BaseExprVisitor &visitor) const override
 
 using LogicalPtr = std::unique_ptr<Logical>;
 
+
+struct Interpolation : public Expr
+{
+
+Interpolation(Token quote,  vector<ExprPtr> parts) : quote(std::move(quote)), parts(std::move(parts)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitInterpolationExpr(this));
+  return std::any();
+}
+
+    Token quote;
+     vector<ExprPtr> parts;
+
+};
+
+using InterpolationPtr = std::unique_ptr<Interpolation>;
+
+
+struct AssignOp : public Expr
+{
+
+AssignOp(Token name,  int depth,  Token op,  ExprPtr value) : name(std::move(name)), depth(std::move(depth)), op(std::move(op)), value(std::move(value)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitAssignOpExpr(this));
+  return std::any();
+}
+
+    Token name;
+     int depth;
+     Token op;
+     ExprPtr value;
+
+};
+
+using AssignOpPtr = std::unique_ptr<AssignOp>;
+
+
+struct CompareVariable : public Expr
+{
+
+CompareVariable(Token name,  int depth,  Token op,  ExprPtr right) : name(std::move(name)), depth(std::move(depth)), op(std::move(op)), right(std::move(right)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitCompareVariableExpr(this));
+  return std::any();
+}
+
+    Token name;
+     int depth;
+     Token op;
+     ExprPtr right;
+
+};
+
+using CompareVariablePtr = std::unique_ptr<CompareVariable>;
+
+
+struct SetFieldOp : public Expr
+{
+
+SetFieldOp(ExprPtr object,  Token name,  Token op,  ExprPtr value) : object(std::move(object)), name(std::move(name)), op(std::move(op)), value(std::move(value)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitSetFieldOpExpr(this));
+  return std::any();
+}
+
+    ExprPtr object;
+     Token name;
+     Token op;
+     ExprPtr value;
+
+};
+
+using SetFieldOpPtr = std::unique_ptr<SetFieldOp>;
+
+
+struct InlinedCall : public Expr
+{
+
+InlinedCall(ExprPtr callee,  Token paren,  vector<ExprPtr> arguments,  const Function *target,  ExprPtr body) : callee(std::move(callee)), paren(std::move(paren)), arguments(std::move(arguments)), target(std::move(target)), body(std::move(body)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitInlinedCallExpr(this));
+  return std::any();
+}
+
+    ExprPtr callee;
+     Token paren;
+     vector<ExprPtr> arguments;
+     const Function *target;
+     ExprPtr body;
+
+};
+
+using InlinedCallPtr = std::unique_ptr<InlinedCall>;
+
+
+struct ArgRef : public Expr
+{
+
+ArgRef(Token name,  int slot) : name(std::move(name)), slot(std::move(slot)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitArgRefExpr(this));
+  return std::any();
+}
+
+    Token name;
+     int slot;
+
+};
+
+using ArgRefPtr = std::unique_ptr<ArgRef>;
+
+
+struct Conditional : public Expr
+{
+
+Conditional(ExprPtr condition,  ExprPtr thenBranch,  ExprPtr elseBranch) : condition(std::move(condition)), thenBranch(std::move(thenBranch)), elseBranch(std::move(elseBranch)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitConditionalExpr(this));
+  return std::any();
+}
+
+    ExprPtr condition;
+     ExprPtr thenBranch;
+     ExprPtr elseBranch;
+
+};
+
+using ConditionalPtr = std::unique_ptr<Conditional>;
+
+
+struct Invariant : public Expr
+{
+
+Invariant(ExprPtr expression,  const InvariantLoop *loop) : expression(std::move(expression)), loop(std::move(loop)) {}
+
+std::any accept(BaseExprVisitor &visitor) const override
+{
+  auto visitor_ptr = dynamic_cast<ExprVisitor<std::any>*>(&visitor);
+  if (visitor_ptr)
+    return std::any(visitor_ptr->visitInvariantExpr(this));
+  return std::any();
+}
+
+    ExprPtr expression;
+     const InvariantLoop *loop;
+    mutable std::any value;
+    mutable uint64_t activation = 0;
+
+};
+
+using InvariantPtr = std::unique_ptr<Invariant>;
+
 }
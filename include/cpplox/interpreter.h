@@ -10,11 +10,18 @@
 #include "stmt.h"
 #include "environment.h"
 #include "loxcallable.h"
+#include "arraylib.h"
+#include "listlib.h"
+#include "maplib.h"
+#include "persistentlib.h"
+#include "stringlib.h"
 
 namespace CppLox
 {
   class InterpreterBlockManager;
   class LoxFunction;
+  class Jit;
+  class Profile;
 
   class Interpreter : public ExprVisitor<std::any>, public StmtVisitor<std::any>, public std::enable_shared_from_this<Interpreter>
   {
@@ -22,12 +29,18 @@ namespace CppLox
     Interpreter() : globals(std::make_shared<Environment>()), environment(globals)
     {
       globals->define("clock", std::make_shared<ClockCallable>());
+      defineStringLibrary(*globals);
+      defineArrayLibrary(*globals);
+      defineListLibrary(*globals);
+      defineMapLibrary(*globals);
+      definePersistentLibrary(*globals);
     }
     std::any visitBinaryExpr(const Binary *expr) override;
     std::any visitGroupingExpr(const Grouping *expr) override;
     std::any visitLiteralExpr(const Literal *expr) override;
     std::any visitUnaryExpr(const Unary *expr) override;
     std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
     std::any visitExpressionStmt(const Expression *stmt) override;
     std::any visitPrintStmt(const Print *stmt) override;
     std::any visitVariableExpr(const Variable *expr) override;
@@ -42,18 +55,52 @@ namespace CppLox
     std::any visitClassStmt(const Class *stmt) override;
     std::any visitGetExpr(const Get *expr) override;
     std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
     std::any visitThisExpr(const This *expr) override;
     std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
     void interpret(std::vector<StmtPtr> &stmts);
     void resolve(const Expr *expr, int depth);
+    int resolvedDepth(const Expr *expr) const;
+    void enableJit();
+    // Counts calls into profile from now on.
+    void recordProfile(std::shared_ptr<Profile> profile);
+    // Lets functions the profile saw run hot compile on their first call.
+    void applyProfile(const Profile &profile);
 
   protected:
     std::shared_ptr<Environment> globals;
     std::shared_ptr<Environment> environment;
     std::unordered_map<const Expr *, int> locals;
+    // Arguments of the inlined calls being evaluated; ArgRef slots index
+    // from inlineBase, the innermost call's first argument.
+    std::vector<std::any> inlineArguments;
+    size_t inlineBase = 0;
+    uint64_t loopActivations = 0;
+    std::shared_ptr<Jit> jit;
+    std::shared_ptr<Profile> profile;
+    // The lists and maps stringify is inside, to cut cycles.
+    std::vector<const void *> printing;
 
   private:
     std::any evaluate(Expr &expr);
+    BinaryKind specialize(TokenType op, const std::any &left, const std::any &right);
+    std::any numericOperation(BinaryKind kind, double a, double b);
+    std::any integerOperation(BinaryKind kind, int64_t a, int64_t b);
+    std::any numberOperation(BinaryKind kind, const std::any &left, const std::any &right);
+    std::any binaryOperation(const Token &op, const std::any &left, const std::any &right);
+    bool applyInPlace(TokenType op, std::any &target, const std::any &operand);
     bool isTruthy(const std::any &value);
     bool isEqual(const std::any &left, const std::any &right);
     void checkNumberOperand(const Token &op, const std::any &operand);
@@ -61,7 +108,11 @@ namespace CppLox
     std::string stringify(std::any &obj);
     void execute(const Stmt &stmt);
     void executeBlock(const std::vector<StmtPtr> &stmts, std::shared_ptr<Environment> environment);
+    bool executeIteration(const std::vector<StmtPtr> &body, Expr *increment = nullptr);
+    template <typename Number>
+    void runCountedLoop(const CountedLoop *stmt, Number counter, Number limit, Number step, std::any &variable);
     std::any lookupVariable(const Token &name, const Expr *expr);
+    std::any call(const Token &paren, const std::any &callee, std::vector<std::any> arguments);
 
     friend class InterpreterBlockManager;
     friend class LoxFunction;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+#include "environment.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define CPPLOX_JIT 1
+#endif
+
+namespace CppLox
+{
+  class Interpreter;
+  class LoxFunction;
+
+  // Baseline compiler from hot functions to x86-64 machine code. A function
+  // qualifies when, given numeric arguments, everything it does is numeric:
+  // arithmetic, comparisons and logic in conditions, locals, if/while/for
+  // loops, returns, and calls to top-level functions that qualify too (which
+  // are compiled along with it). Such code has no side effects, so whenever
+  // compiled code cannot finish (a path falls off the end, recursion runs
+  // too deep, or an integer result leaves the range compiled code holds
+  // exactly) it bails out and the call reruns in the interpreter, and the
+  // function is not tried again with that kind of argument.
+  class Jit
+  {
+  public:
+    // The kind of number a compiled value is to the interpreter. Integers
+    // are kept in doubles, below 2^53 in magnitude.
+    enum class Representation
+    {
+      INTEGER,
+      DOUBLE
+    };
+
+    Jit(const Interpreter &interpreter, std::shared_ptr<Environment> globals) : interpreter(interpreter), globals(globals) {}
+    ~Jit();
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+
+    // Runs function natively if it is hot and compiles, its arguments are
+    // all integers or all doubles and the functions it calls are still bound to the same names.
+    // Returns false to have the interpreter run the call instead.
+    bool call(const LoxFunction &function, const std::vector<std::any> &arguments, std::any &result);
+    // Credits function with calls made in an earlier, profiled run.
+    void seed(const Function *function, uint64_t calls);
+
+  private:
+    static const int HOT_CALL_THRESHOLD = 10;
+    static const int MAX_PARAMS = 16;
+
+    using EntryPoint = int (*)(const double *arguments, double *result);
+
+    enum class State
+    {
+      COLD,
+      COMPILED,
+      FAILED
+    };
+
+    struct Entry
+    {
+      State state = State::COLD;
+      int calls = 0;
+      EntryPoint code = nullptr;
+      // Global names the compiled calls assume, and what they must hold.
+      std::vector<std::pair<std::string, const Function *>> guards;
+    };
+
+    const Interpreter &interpreter;
+    std::shared_ptr<Environment> globals;
+    // By the representation of the arguments.
+    std::unordered_map<const Function *, Entry> entries[2];
+    std::vector<std::pair<void *, size_t>> pages;
+    // Native call depth, checked by every compiled function.
+    uint32_t depth = 0;
+
+    bool compile(const Function *function, Representation representation, Entry &entry);
+    bool guardsHold(const Entry &entry);
+  };
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "environment.h"
+#include "native.h"
+
+namespace CppLox
+{
+  // Defines List(), which makes an empty list, push(l, value), which
+  // appends, and pop(l), which removes and returns the last element. len
+  // and sort also take lists.
+  void defineListLibrary(Environment &globals);
+  // Whether name is one of the functions above.
+  bool isListLibraryFunction(const std::string &name);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CppLox
+{
+  // A fixed-length array of doubles in one contiguous block, made by
+  // Float64Array(n) and read and written with a[i]. Values hold a
+  // shared_ptr, so copies alias. Integers stored in it become doubles.
+  class Float64Array
+  {
+  public:
+    explicit Float64Array(size_t length) : elements(length) {}
+    explicit Float64Array(std::vector<double> elements) : elements(std::move(elements)) {}
+
+    std::string toString() const;
+
+    std::vector<double> elements;
+  };
+}
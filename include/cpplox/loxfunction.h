@@ -1,11 +1,14 @@
 #pragma once
+#include <algorithm>
 #include <any>
 #include <vector>
 #include "interpreter.h"
 #include "environment.h"
+#include "jit.h"
 #include "loxcallable.h"
 #include "loxinstance.h"
 #include "loxreturn.h"
+#include "profile.h"
 #include "stmt.h"
 
 namespace CppLox
@@ -14,33 +17,80 @@ namespace CppLox
   {
   public:
     LoxFunction(const Function *declaration, std::shared_ptr<Environment> enclosing, bool isInitializer) : declaration(declaration), enclosing(enclosing), isInitializer(isInitializer) {}
+    // Tail calls (`return f(...)`) unwind to here and run in this frame, so
+    // tail recursion uses constant native stack.
     std::any call(std::shared_ptr<Interpreter> interpreter, const std::vector<std::any> &arguments) override
     {
-      std::shared_ptr<Environment> environment = std::make_shared<Environment>(enclosing);
-      for (int i = 0; i < declaration->params.size(); i++)
+      const LoxFunction *function = this;
+      std::shared_ptr<LoxFunction> target;
+      std::vector<std::any> tailArguments;
+      const std::vector<std::any> *args = &arguments;
+      // Functions along the tail-call chain that declared a return type; the
+      // final value is returned through each of them.
+      std::vector<const Function *> returnTypes;
+      while (true)
       {
-        environment->define(declaration->params[i].lexeme, arguments[i]);
-      }
+        if (interpreter->profile != nullptr)
+        {
+          interpreter->profile->countCall(function->declaration);
+        }
+        if (function->declaration->annotated())
+        {
+          checkArguments(*function->declaration, *args);
+          // Tail recursion would repeat the same check.
+          if (function->declaration->returnType != Annotation::NONE &&
+              std::find(returnTypes.begin(), returnTypes.end(), function->declaration) == returnTypes.end())
+          {
+            returnTypes.push_back(function->declaration);
+          }
+        }
+        std::any compiled;
+        if (interpreter->jit != nullptr && interpreter->jit->call(*function, *args, compiled))
+        {
+          return checkReturn(returnTypes, std::move(compiled));
+        }
 
-      try
-      {
-        interpreter->executeBlock(declaration->body, environment);
-      }
-      catch (const LoxReturn &returnValue)
-      {
-        if (isInitializer)
+        std::shared_ptr<Environment> environment = std::make_shared<Environment>(function->enclosing);
+        for (int i = 0; i < function->declaration->params.size(); i++)
         {
-          return enclosing->getAt(0, "this");
+          environment->define(function->declaration->params[i].lexeme, (*args)[i]);
         }
-        return returnValue.value;
-      }
 
-      if (isInitializer)
-      {
-        return enclosing->getAt(0, "this");
+        try
+        {
+          interpreter->executeBlock(function->declaration->body, environment);
+        }
+        catch (LoxReturn &returnValue)
+        {
+          if (returnValue.tailCall != nullptr)
+          {
+            // Initializers cannot return a value, so neither end of a tail
+            // call is one.
+            target = std::move(returnValue.tailCall);
+            tailArguments = std::move(returnValue.arguments);
+            function = target.get();
+            args = &tailArguments;
+            continue;
+          }
+          if (function->isInitializer)
+          {
+            return function->enclosing->getAt(0, "this");
+          }
+          return checkReturn(returnTypes, std::move(returnValue.value));
+        }
+
+        if (function->isInitializer)
+        {
+          return function->enclosing->getAt(0, "this");
+        }
+
+        return checkReturn(returnTypes, std::any());
       }
+    }
 
-      return std::any();
+    bool initializer() const
+    {
+      return isInitializer;
     }
 
     int arity() const override
@@ -53,6 +103,11 @@ namespace CppLox
       return "<fn " + declaration->name.lexeme + ">";
     }
 
+    const Function *getDeclaration() const
+    {
+      return declaration;
+    }
+
     std::any bind(std::shared_ptr<LoxInstance> instance)
     {
       std::shared_ptr<Environment> environment = std::make_shared<Environment>(enclosing);
@@ -64,5 +119,29 @@ namespace CppLox
     const Function *declaration;
     std::shared_ptr<Environment> enclosing;
     bool isInitializer;
+
+    static void checkArguments(const Function &declaration, const std::vector<std::any> &arguments)
+    {
+      for (size_t i = 0; i < declaration.paramTypes.size(); i++)
+      {
+        if (!hasType(arguments[i], declaration.paramTypes[i]))
+        {
+          const Token &param = declaration.params[i];
+          throw RuntimeError(param, std::string("Expected a ") + annotationName(declaration.paramTypes[i]) + " argument for '" + param.lexeme + "'.");
+        }
+      }
+    }
+
+    static std::any checkReturn(const std::vector<const Function *> &returnTypes, std::any value)
+    {
+      for (const Function *function : returnTypes)
+      {
+        if (!hasType(value, function->returnType))
+        {
+          throw RuntimeError(function->name, std::string("Expected a ") + annotationName(function->returnType) + " return value from '" + function->name.lexeme + "'.");
+        }
+      }
+      return value;
+    }
   };
 } // namespace CppLox
\ No newline at end of file
@@ -17,6 +17,8 @@ namespace CppLox
     std::string toString();
     std::any get(const Token &name);
     std::any set(const Token &name, std::any value);
+    // The field's storage, or nullptr when the instance has no such field.
+    std::any *field(const std::string &name);
 
   private:
     std::shared_ptr<LoxClass> klass;
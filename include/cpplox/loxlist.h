@@ -0,0 +1,22 @@
+#pragma once
+#include <any>
+#include <vector>
+
+namespace CppLox
+{
+  // A growable list of values in one contiguous block, made by List() and
+  // read and written with l[i]. push appends in amortized constant time.
+  // Values hold a shared_ptr, so copies alias; l[start:end] copies.
+  class LoxList
+  {
+  public:
+    LoxList() = default;
+    explicit LoxList(std::vector<std::any> elements) : elements(std::move(elements)) {}
+
+    // Sorts in place with pdqsort. Throws a NativeError unless the list
+    // holds only numbers or only strings.
+    void sort();
+
+    std::vector<std::any> elements;
+  };
+}
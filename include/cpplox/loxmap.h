@@ -0,0 +1,68 @@
+#pragma once
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CppLox
+{
+  // A hash map from strings, numbers, booleans and nil to values, made by
+  // Map(). Values hold a shared_ptr, so copies alias. An integer and a
+  // double that are the same number are the same key, and a string key
+  // hashes with the hash its LoxString already cached.
+  //
+  // The table is a Swiss table: open addressing over groups of 16 slots,
+  // each with a control byte holding 7 bits of the key's hash, or marking
+  // the slot empty or deleted. A lookup compares a whole group's control
+  // bytes against the hash at once (one SSE2 compare where available) and
+  // only compares keys on a match, so most probes touch no key at all.
+  // Iteration order is the table's, which is deterministic but arbitrary.
+  class LoxMap
+  {
+  public:
+    // Why value cannot be a key, or nullptr if it can.
+    static const char *keyError(const std::any &value);
+    // The hash and equality of valid keys, shared with PersistentMap.
+    static uint64_t hashKey(const std::any &key);
+    static bool sameKey(const std::any &a, const std::any &b);
+
+    // The value under key, or nullptr. key must be a valid key.
+    const std::any *get(const std::any &key) const;
+    void set(const std::any &key, std::any value);
+    // Returns whether the key was there.
+    bool remove(const std::any &key);
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    template <typename Visit>
+    void forEach(Visit visit)
+    {
+      for (size_t i = 0; i < control.size(); i++)
+      {
+        if (control[i] >= 0)
+          visit(slots[i].key, slots[i].value);
+      }
+    }
+
+  private:
+    struct Slot
+    {
+      std::any key;
+      std::any value;
+    };
+
+    // One control byte per slot: EMPTY, DELETED, or the low 7 bits of a
+    // full slot's hash.
+    std::vector<int8_t> control;
+    std::vector<Slot> slots;
+    size_t count = 0;
+    size_t tombstones = 0;
+
+    size_t find(const std::any &key, uint64_t hash) const;
+    size_t firstAvailable(uint64_t hash) const;
+    void rehash(size_t capacity);
+  };
+}
@@ -1,14 +1,25 @@
 #pragma once
 
+#include <any>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 #include "token.h"
 
 namespace CppLox
 {
+  class LoxFunction;
+
   class LoxReturn : public std::runtime_error
   {
   public:
     LoxReturn(std::any value) : std::runtime_error("Return Exception"), value(value) {}
+    LoxReturn(std::shared_ptr<LoxFunction> tailCall, std::vector<std::any> arguments)
+        : std::runtime_error("Return Exception"), tailCall(std::move(tailCall)), arguments(std::move(arguments)) {}
     std::any value;
+    // Set by `return f(...)`: the function the caller's frame should run
+    // next, in place of nesting the call.
+    std::shared_ptr<LoxFunction> tailCall;
+    std::vector<std::any> arguments;
   };
-}
\ No newline at end of file
+}
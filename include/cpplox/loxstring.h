@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace CppLox
+{
+  class LoxStringRef;
+
+  // The characters of a Lox string value. Immutable and shared: values hold
+  // a LoxStringRef, so copying one (a variable read, an argument, a field)
+  // bumps a count instead of copying the characters. String literals are
+  // interned, so two interned strings are equal exactly when they are the
+  // same object.
+  //
+  // A long concatenation is a rope: a node over its two operands, joined
+  // into one buffer only when the characters are needed (printing,
+  // comparing, hashing). Building a string with `s = s + piece` in a loop
+  // is then linear rather than quadratic. The hash is computed once, with
+  // the characters.
+  //
+  // A long substring is a slice: a window into a flat string it keeps
+  // alive. view() reads it in place; str() copies it out on first use.
+  class LoxString
+  {
+  public:
+    LoxString(const LoxString &) = delete;
+    LoxString &operator=(const LoxString &) = delete;
+
+    const std::string &str() const
+    {
+      if (left != nullptr || base != nullptr)
+        flatten();
+      return chars;
+    }
+
+    // The characters without copying a slice out of its base.
+    std::string_view view() const
+    {
+      if (left != nullptr)
+        flatten();
+      if (base != nullptr)
+        return std::string_view(base->chars).substr(offset, size);
+      return chars;
+    }
+
+    size_t hash() const
+    {
+      if (left != nullptr || base != nullptr)
+        flatten();
+      return hashCode;
+    }
+
+    size_t length() const
+    {
+      return size;
+    }
+
+    bool interned() const
+    {
+      return isInterned;
+    }
+
+  private:
+    friend class LoxStringRef;
+    friend LoxStringRef operator+(const LoxStringRef &left, const LoxStringRef &right);
+
+    LoxString(std::string chars, bool interned);
+    LoxString(LoxString *left, LoxString *right);
+    LoxString(LoxString *base, size_t offset, size_t size);
+
+    // Empty, with a zero hash, until a rope or slice is flattened.
+    mutable std::string chars;
+    mutable size_t hashCode = 0;
+    // The operands of an unflattened rope, each holding a reference.
+    mutable LoxString *left = nullptr;
+    mutable LoxString *right = nullptr;
+    // The flat string an unflattened slice reads from, holding a reference.
+    mutable LoxString *base = nullptr;
+    const size_t offset = 0;
+    const size_t size;
+    const bool isInterned;
+    // The interpreter is single-threaded, so the count is not atomic.
+    uint32_t refs = 0;
+
+    void flatten() const;
+  };
+
+  // A counted reference to a LoxString. It is one pointer wide, so a
+  // std::any stores it inline rather than on the heap.
+  class LoxStringRef
+  {
+  public:
+    // A fresh string, e.g. the result of a concatenation.
+    explicit LoxStringRef(std::string chars);
+    // The one interned string with these characters.
+    static LoxStringRef intern(std::string_view chars);
+
+    // The characters [offset, offset + length), which must lie in range.
+    // Long substrings share this string's buffer.
+    LoxStringRef slice(size_t offset, size_t length) const;
+
+    LoxStringRef(const LoxStringRef &other) noexcept : string(other.string)
+    {
+      string->refs++;
+    }
+
+    LoxStringRef(LoxStringRef &&other) noexcept : string(other.string)
+    {
+      other.string = nullptr;
+    }
+
+    LoxStringRef &operator=(LoxStringRef other) noexcept
+    {
+      std::swap(string, other.string);
+      return *this;
+    }
+
+    ~LoxStringRef()
+    {
+      if (string != nullptr && --string->refs == 0)
+        release(string);
+    }
+
+    const LoxString *operator->() const
+    {
+      return string;
+    }
+
+    const std::string &str() const
+    {
+      return string->str();
+    }
+
+    bool operator==(const LoxStringRef &other) const
+    {
+      if (string == other.string)
+        return true;
+      if ((string->isInterned && other.string->isInterned) || string->size != other.string->size)
+        return false;
+      // Slices compare in place rather than being copied out to hash.
+      if (string->base == nullptr && other.string->base == nullptr && string->hash() != other.string->hash())
+        return false;
+      return string->view() == other.string->view();
+    }
+
+    bool operator!=(const LoxStringRef &other) const
+    {
+      return !(*this == other);
+    }
+
+    friend LoxStringRef operator+(const LoxStringRef &left, const LoxStringRef &right);
+
+  private:
+    friend class LoxString;
+
+    explicit LoxStringRef(LoxString *string) : string(string)
+    {
+      string->refs++;
+    }
+
+    static void release(LoxString *string);
+
+    LoxString *string;
+  };
+}
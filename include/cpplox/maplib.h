@@ -0,0 +1,17 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "environment.h"
+#include "native.h"
+
+namespace CppLox
+{
+  // Defines Map(), which makes an empty map, and get(m, key) (nil when the
+  // key is missing), set(m, key, value), has(m, key), remove(m, key), and
+  // keys(m) and values(m), which return lists to iterate over. len also
+  // takes maps, and m[key] reads and writes like get and set.
+  void defineMapLibrary(Environment &globals);
+  // Whether name is one of the functions above.
+  bool isMapLibraryFunction(const std::string &name);
+}
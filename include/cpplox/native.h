@@ -0,0 +1,88 @@
+#pragma once
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+#include "loxcallable.h"
+
+namespace CppLox
+{
+  // A bad argument to a native function. Interpreter::call reports it as a
+  // RuntimeError at the call.
+  class NativeError : public std::runtime_error
+  {
+  public:
+    NativeError(const std::string &message) : std::runtime_error(message) {}
+  };
+
+  // A global function implemented in C++.
+  class NativeFunction : public LoxCallable
+  {
+  public:
+    using Body = std::any (*)(const std::vector<std::any> &arguments);
+
+    NativeFunction(const char *name, int parameters, Body body) : name(name), parameters(parameters), body(body) {}
+
+    int arity() const override
+    {
+      return parameters;
+    }
+
+    std::any call(std::shared_ptr<Interpreter> interpreter, const std::vector<std::any> &arguments) override
+    {
+      return body(arguments);
+    }
+
+    std::string toString() const
+    {
+      return "<native fn>";
+    }
+
+    const char *const name;
+
+  private:
+    const int parameters;
+    const Body body;
+  };
+
+  // One row of a library's table. Plain data, so a table is initialized
+  // before any static Interpreter.
+  struct NativeEntry
+  {
+    const char *name;
+    int arity;
+    NativeFunction::Body body;
+  };
+
+  template <size_t N>
+  void defineNatives(Environment &globals, const NativeEntry (&library)[N])
+  {
+    for (const NativeEntry &function : library)
+    {
+      globals.define(function.name, std::make_shared<NativeFunction>(function.name, function.arity, function.body));
+    }
+  }
+
+  template <size_t N>
+  bool definesNative(const NativeEntry (&library)[N], const std::string &name)
+  {
+    for (const NativeEntry &function : library)
+    {
+      if (name == function.name)
+        return true;
+    }
+    return false;
+  }
+
+  // An integer argument: an int64 or an integral double. Throws a
+  // NativeError naming the argument otherwise.
+  int64_t integerArgument(const std::vector<std::any> &arguments, size_t index, const char *function);
+  // An integer argument in [0, limit].
+  size_t indexArgument(const std::vector<std::any> &arguments, size_t index, const char *function, size_t limit);
+  double numberArgument(const std::vector<std::any> &arguments, size_t index, const char *function);
+}
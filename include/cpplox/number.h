@@ -0,0 +1,209 @@
+#pragma once
+#include <any>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+#include "quickening.h"
+#include "token.h"
+#include "tokentype.h"
+
+namespace CppLox
+{
+  // Lox has one number type with two representations. Integral literals,
+  // and the results of integer arithmetic that are exact integers in range,
+  // are int64_t; everything else is a double. An integer result that a
+  // double would give as -0, or that overflows, is a double, so the two
+  // only disagree where doubles round: integers past 2^53 stay exact.
+
+  // any_cast on a pointer compares a function pointer; type() is an
+  // indirect call.
+  inline bool isNumber(const std::any &value)
+  {
+    return std::any_cast<double>(&value) != nullptr || std::any_cast<int64_t>(&value) != nullptr;
+  }
+
+  // Requires isNumber(value).
+  inline double toDouble(const std::any &value)
+  {
+    if (const auto *integer = std::any_cast<int64_t>(&value))
+      return static_cast<double>(*integer);
+    return *std::any_cast<double>(&value);
+  }
+
+  inline bool isNumber(const LiteralType &value)
+  {
+    return std::holds_alternative<double>(value) || std::holds_alternative<int64_t>(value);
+  }
+
+  // Requires isNumber(value).
+  inline double toDouble(const LiteralType &value)
+  {
+    if (const auto *integer = std::get_if<int64_t>(&value))
+      return static_cast<double>(*integer);
+    return std::get<double>(value);
+  }
+
+  // Whether an integer and a double are the same number, without rounding
+  // the integer.
+  inline bool sameNumber(int64_t integer, double number)
+  {
+    return number >= -0x1p63 && number < 0x1p63 && static_cast<int64_t>(number) == integer &&
+           static_cast<double>(static_cast<int64_t>(number)) == number;
+  }
+
+  // Orders an integer against a double exactly, without rounding the
+  // integer: -1, 0 or 1. The double is not NaN.
+  inline int compareMixed(int64_t integer, double number)
+  {
+    if (number >= 0x1p63)
+      return -1;
+    if (number < -0x1p63)
+      return 1;
+    double floor = std::floor(number);
+    int64_t whole = static_cast<int64_t>(floor);
+    if (integer != whole)
+      return integer < whole ? -1 : 1;
+    return floor < number ? -1 : 0;
+  }
+
+  // The order of two numbers, each an integer (i, j) or else a double (a,
+  // b): -1, 0 or 1, or nullopt if either is NaN. An integer and a double
+  // compare exactly, agreeing with sameNumber.
+  inline std::optional<int> compareNumbers(const int64_t *i, double a, const int64_t *j, double b)
+  {
+    if (i != nullptr && j != nullptr)
+      return (*i > *j) - (*i < *j);
+    if ((i == nullptr && std::isnan(a)) || (j == nullptr && std::isnan(b)))
+      return std::nullopt;
+    if (i != nullptr)
+      return compareMixed(*i, b);
+    if (j != nullptr)
+      return -compareMixed(*j, a);
+    return (a > b) - (a < b);
+  }
+
+  // Requires isNumber of both.
+  inline std::optional<int> compareNumbers(const std::any &left, const std::any &right)
+  {
+    const auto *i = std::any_cast<int64_t>(&left);
+    const auto *j = std::any_cast<int64_t>(&right);
+    return compareNumbers(i, i != nullptr ? 0 : *std::any_cast<double>(&left), j, j != nullptr ? 0 : *std::any_cast<double>(&right));
+  }
+
+  inline std::optional<int> compareNumbers(const LiteralType &left, const LiteralType &right)
+  {
+    const auto *i = std::get_if<int64_t>(&left);
+    const auto *j = std::get_if<int64_t>(&right);
+    return compareNumbers(i, i != nullptr ? 0 : std::get<double>(left), j, j != nullptr ? 0 : std::get<double>(right));
+  }
+
+  inline bool isOrderingKind(BinaryKind kind)
+  {
+    return kind >= BinaryKind::LESS_NUMBERS && kind <= BinaryKind::GREATER_EQUAL_NUMBERS;
+  }
+
+  // Whether an ordering kind holds for two numbers in the order
+  // compareNumbers gives. NaN is unordered, so nothing holds.
+  inline bool orderingHolds(BinaryKind kind, std::optional<int> order)
+  {
+    if (!order)
+      return false;
+    switch (kind)
+    {
+    case BinaryKind::LESS_NUMBERS:
+      return *order < 0;
+    case BinaryKind::LESS_EQUAL_NUMBERS:
+      return *order <= 0;
+    case BinaryKind::GREATER_NUMBERS:
+      return *order > 0;
+    default:
+      return *order >= 0;
+    }
+  }
+
+  // The kind a Binary node with this operator takes on two numbers, or
+  // GENERIC.
+  inline BinaryKind numberKind(TokenType op)
+  {
+    switch (op)
+    {
+    case TokenType::PLUS:
+      return BinaryKind::ADD_NUMBERS;
+    case TokenType::MINUS:
+      return BinaryKind::SUBTRACT_NUMBERS;
+    case TokenType::STAR:
+      return BinaryKind::MULTIPLY_NUMBERS;
+    case TokenType::SLASH:
+      return BinaryKind::DIVIDE_NUMBERS;
+    case TokenType::LESS:
+      return BinaryKind::LESS_NUMBERS;
+    case TokenType::LESS_EQUAL:
+      return BinaryKind::LESS_EQUAL_NUMBERS;
+    case TokenType::GREATER:
+      return BinaryKind::GREATER_NUMBERS;
+    case TokenType::GREATER_EQUAL:
+      return BinaryKind::GREATER_EQUAL_NUMBERS;
+    case TokenType::EQUAL_EQUAL:
+      return BinaryKind::EQUAL_NUMBERS;
+    case TokenType::BANG_EQUAL:
+      return BinaryKind::NOT_EQUAL_NUMBERS;
+    default:
+      return BinaryKind::GENERIC;
+    }
+  }
+
+  inline bool isIntegerKind(BinaryKind kind)
+  {
+    return kind >= BinaryKind::ADD_INTEGERS;
+  }
+
+  // ADD_NUMBERS <-> ADD_INTEGERS, and so on.
+  inline BinaryKind integerKind(BinaryKind numbers)
+  {
+    return static_cast<BinaryKind>(static_cast<int>(numbers) - static_cast<int>(BinaryKind::ADD_NUMBERS) + static_cast<int>(BinaryKind::ADD_INTEGERS));
+  }
+
+  inline BinaryKind numbersKind(BinaryKind integers)
+  {
+    return static_cast<BinaryKind>(static_cast<int>(integers) - static_cast<int>(BinaryKind::ADD_INTEGERS) + static_cast<int>(BinaryKind::ADD_NUMBERS));
+  }
+
+  // The integer result of an arithmetic kind, or nullopt where the result
+  // is a double: on overflow, a fractional quotient, division by zero or a
+  // negative zero.
+  inline std::optional<int64_t> integerArithmetic(BinaryKind kind, int64_t a, int64_t b)
+  {
+    int64_t result;
+    switch (kind)
+    {
+    case BinaryKind::ADD_NUMBERS:
+      if (__builtin_add_overflow(a, b, &result))
+        return std::nullopt;
+      return result;
+    case BinaryKind::SUBTRACT_NUMBERS:
+      if (__builtin_sub_overflow(a, b, &result))
+        return std::nullopt;
+      return result;
+    case BinaryKind::MULTIPLY_NUMBERS:
+      if (__builtin_mul_overflow(a, b, &result) || (result == 0 && (a < 0 || b < 0)))
+        return std::nullopt;
+      return result;
+    case BinaryKind::DIVIDE_NUMBERS:
+      if (b == 0 || (a == std::numeric_limits<int64_t>::min() && b == -1) || a % b != 0 || (a == 0 && b < 0))
+        return std::nullopt;
+      return a / b;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  // -value as an integer, or nullopt where it is a double (-0, overflow).
+  inline std::optional<int64_t> integerNegate(int64_t value)
+  {
+    if (value == 0 || value == std::numeric_limits<int64_t>::min())
+      return std::nullopt;
+    return -value;
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace CppLox
+{
+  // Room for any number formatNumber writes.
+  constexpr size_t NUMBER_BUFFER_SIZE = 32;
+
+  // The shortest decimal that reads back as the same double: 3, 0.1,
+  // 123.456. Exponents below -6 or above 20 are written in scientific
+  // notation (1e+21, 1.5e-7); nan, inf and -inf are spelled out. The text
+  // is written into buffer, so printing a number does not allocate.
+  std::string_view formatNumber(double value, char (&buffer)[NUMBER_BUFFER_SIZE]);
+  std::string formatNumber(double value);
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+#include "interpreter.h"
+#include "bindings.h"
+#include "profile.h"
+
+namespace CppLox
+{
+  class Optimizer;
+
+  class OptimizationPass
+  {
+  public:
+    virtual ~OptimizationPass() = default;
+    virtual void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) = 0;
+  };
+
+  // Post-order rewrite of the mutable tree: children are rewritten before
+  // transform() sees their parent. transform() returns the node to keep,
+  // a replacement, or (for statements) nullptr to delete it.
+  class RewritePass : public OptimizationPass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    Optimizer *optimizer = nullptr;
+
+    virtual ExprPtr transform(ExprPtr expr) { return expr; }
+    virtual StmtPtr transform(StmtPtr stmt) { return stmt; }
+    virtual void rewrite(std::vector<StmtPtr> &stmts);
+    virtual void rewrite(StmtPtr &stmt);
+    virtual void rewrite(ExprPtr &expr);
+  };
+
+  // Splices the body of small, non-recursive functions into their call sites.
+  // A candidate is declared once and never assigned, and its body is a chain
+  // of `if (c) return a;` ending in a return whose expressions read only its
+  // parameters and globals. Parameters become ArgRef slots, and the call
+  // keeps a guard that falls back to a real call if the callee differs.
+  // Bodies that return a call are left alone, so it stays a tail call.
+  // Functions a loaded profile saw called often get a larger size budget.
+  class Inliner : public RewritePass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    ExprPtr transform(ExprPtr expr) override;
+
+  private:
+    static const int MAX_INLINE_NODES = 24;
+    static const int HOT_INLINE_NODES = 48;
+    static const uint64_t HOT_CALLS = 1000;
+
+    std::unique_ptr<BindingAnalysis> analysis;
+    std::unordered_map<const Function *, ExprPtr> templates;
+
+    void collect(const std::vector<StmtPtr> &stmts);
+    void collect(const Stmt *stmt);
+    ExprPtr inlineBody(const Function *function, const std::vector<StmtPtr> &stmts, size_t index, int &budget);
+    ExprPtr returnedValue(const Function *function, const Stmt *stmt, int &budget);
+    ExprPtr clone(const Function *function, const Expr *expr, int &budget);
+    ExprPtr copy(const Expr *expr);
+  };
+
+  // Replaces local instances that never escape with one hidden local per
+  // field, named "p.x" after the variable and field. The instance must come
+  // from `var p = C(...)` where C is a top-level class without a superclass,
+  // declared once and never assigned, whose init only copies its parameters
+  // (in order) or literals into fields; and p may only be used to read and
+  // write those fields. The allocation, field map and init call disappear.
+  class ScalarReplacement : public RewritePass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    ExprPtr transform(ExprPtr expr) override;
+    void rewrite(std::vector<StmtPtr> &stmts) override;
+    using RewritePass::rewrite;
+
+  private:
+    // A field's initial value: an init parameter's index, or a literal.
+    struct FieldSource
+    {
+      std::string field;
+      int param;
+      LiteralType literal;
+    };
+
+    struct Candidate
+    {
+      const Class *klass;
+      std::vector<FieldSource> fields;
+    };
+
+    std::unique_ptr<BindingAnalysis> analysis;
+    std::unordered_map<const Binding *, Candidate> candidates;
+    std::unordered_map<const Binding *, int> fieldUses;
+
+    void collect(Stmt *stmt);
+    void collect(Expr *expr);
+    bool describeClass(const Class *klass, std::vector<FieldSource> &fields) const;
+    const Candidate *candidateFor(const Expr *object) const;
+    Token hiddenName(const Token &variable, const Token &field) const;
+  };
+
+  // Evaluates operators whose operands are all literals, drops groupings and
+  // short-circuits logical operators with a literal left operand.
+  class ConstantFolding : public RewritePass
+  {
+  protected:
+    ExprPtr transform(ExprPtr expr) override;
+  };
+
+  // Replaces reads of locals that are initialized with a literal and never
+  // reassigned by that literal, and removes their declarations.
+  class ConstantPropagation : public RewritePass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    ExprPtr transform(ExprPtr expr) override;
+    StmtPtr transform(StmtPtr stmt) override;
+
+  private:
+    std::unique_ptr<BindingAnalysis> analysis;
+    const Literal *constantFor(const Binding *binding) const;
+  };
+
+  // Removes branches and loops with literal conditions, statements after a
+  // return, and expression statements that are a bare literal.
+  class DeadCodeElimination : public RewritePass
+  {
+  protected:
+    StmtPtr transform(StmtPtr stmt) override;
+    void rewrite(std::vector<StmtPtr> &stmts) override;
+    using RewritePass::rewrite;
+  };
+
+  // Replaces common shapes with fused nodes that run in one dispatch:
+  // `x = x op y` (AssignOp), `x < y` against a variable (CompareVariable),
+  // `a.b = a.b op y` (SetFieldOp), and a while loop whose block body ends in
+  // an expression statement, as desugared for loops do (ForLoop). Runs last,
+  // since the other passes only match the unfused shapes.
+  class Superinstructions : public RewritePass
+  {
+  protected:
+    ExprPtr transform(ExprPtr expr) override;
+    StmtPtr transform(StmtPtr stmt) override;
+
+  private:
+    bool sameVariable(const Expr *a, const Expr *b) const;
+  };
+
+  // Runs `for` loops whose variable is stepped by a constant and compared
+  // against a loop-invariant bound with a native counter, writing it back to
+  // the Lox variable only when the body reads it or a closure captures it.
+  // Matches the nodes Superinstructions produces, so runs after it.
+  class CountedLoops : public RewritePass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    StmtPtr transform(StmtPtr stmt) override;
+
+  private:
+    std::unique_ptr<BindingAnalysis> analysis;
+    bool isInvariant(const Expr *limit) const;
+  };
+
+  // Caches pure expressions that cannot change while a loop runs: reads of
+  // variables declared outside it and not assigned in it, property reads
+  // whose field is never written in it, and operators over those. Wrapped
+  // in Invariant nodes, they are evaluated on first use in each run of the
+  // loop rather than up front, so a loop that never enters the body raises
+  // no new errors. Any call the loop makes is assumed to write every field
+  // and every global or captured variable that is ever reassigned.
+  class LoopInvariantCodeMotion : public RewritePass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  protected:
+    StmtPtr transform(StmtPtr stmt) override;
+
+  private:
+    struct LoopEffects
+    {
+      std::unordered_set<const Binding *> assigned;
+      std::unordered_set<std::string> fields;
+      bool calls = false;
+    };
+
+    std::unique_ptr<BindingAnalysis> analysis;
+    LoopEffects effects;
+    const InvariantLoop *loop = nullptr;
+    int hoisted = 0;
+    // For each inlined body being visited, which arguments are invariant.
+    std::vector<std::vector<bool>> argumentFrames;
+
+    void collectEffects(Stmt *stmt);
+    void collectEffects(Expr *expr);
+    void hoist(Stmt *stmt, int scopes);
+    void hoistRoot(ExprPtr &expr, int scopes);
+    bool hoist(ExprPtr &expr, int scopes);
+    bool isInvariantBinding(const Expr *expr, int depth, int scopes) const;
+    bool isWorthHoisting(const Expr *expr) const;
+  };
+
+  // Proves operand types without running the program, and marks Binary
+  // and Unary nodes whose operands are always numbers (or, for `+`, always
+  // strings) so the interpreter skips their checks and guards. Locals no
+  // closure captures are tracked flow-sensitively: assignments set their
+  // type, branches join, and loops iterate to a fixed point. A block that
+  // fails part way leaves its variables in any state reached inside it, so
+  // its exit also joins every type assigned in it. Annotated variables and
+  // parameters have their declared type; otherwise globals, parameters,
+  // captured locals, fields and call results are unknown. Runs last, over
+  // the final tree, and reports its coverage to Optimizer::report.
+  class TypeInference : public OptimizationPass
+  {
+  public:
+    void run(std::vector<StmtPtr> &stmts, Optimizer &optimizer) override;
+
+  private:
+    enum class Type
+    {
+      NONE,
+      NUMBER,
+      STRING,
+      BOOL,
+      NIL,
+      ANY
+    };
+    using State = std::unordered_map<const Binding *, Type>;
+
+    std::unique_ptr<BindingAnalysis> analysis;
+    State state;
+    // Annotated locals and parameters, captured ones included, and annotated
+    // globals of a whole program: every store to them is checked, so every
+    // read has the declared type.
+    State declared;
+    bool wholeProgram = false;
+    // Types assigned inside each enclosing block that recovers from errors.
+    std::vector<State> assigned;
+    // Every operand type seen at each node, over all visits.
+    std::unordered_map<const Binary *, std::pair<Type, Type>> binaryOperands;
+    std::unordered_map<const Unary *, Type> unaryOperands;
+
+    static Type join(Type a, Type b);
+    static void join(State &into, const State &from);
+    static Type binaryType(TokenType op, Type left, Type right);
+    Type read(const Binding *binding) const;
+    void declare(const Binding *binding, Annotation annotation);
+    void write(const Binding *binding, Type type);
+    void recovering(const std::function<void()> &body);
+    void loop(const std::function<void()> &condition, const std::function<void()> &body);
+    void function(const Function *function);
+    void infer(const std::vector<StmtPtr> &stmts);
+    void infer(const Stmt *stmt);
+    Type infer(const Expr *expr);
+    void mark(std::ostream *report);
+  };
+
+  class Optimizer
+  {
+  public:
+    Optimizer(std::shared_ptr<Interpreter> interpreter) : interpreter(interpreter) {}
+    void addPass(std::unique_ptr<OptimizationPass> pass);
+    void addStandardPasses();
+    void optimize(std::vector<StmtPtr> &stmts);
+
+    // Replaced nodes are kept alive rather than freed: the interpreter keys
+    // resolved depths by node address, and a recycled address would pick up
+    // a stale entry.
+    void retire(ExprPtr expr);
+    void retire(StmtPtr stmt);
+
+    std::shared_ptr<Interpreter> interpreter;
+    // Feedback from an earlier run, if one was loaded.
+    std::shared_ptr<const Profile> profile;
+    // Where passes describe what they did, if anywhere.
+    std::ostream *report = nullptr;
+    // The tree is the whole program, as for a script file. A REPL line is
+    // not: later lines can redeclare its globals.
+    bool wholeProgram = false;
+
+  private:
+    std::vector<std::unique_ptr<OptimizationPass>> passes;
+    std::vector<ExprPtr> retiredExprs;
+    std::vector<StmtPtr> retiredStmts;
+  };
+
+  bool isTruthyLiteral(const LiteralType &value);
+  std::optional<LiteralType> foldBinary(TokenType op, const LiteralType &left, const LiteralType &right);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <string_view>
+
+namespace CppLox
+{
+  // The program's standard output. Lines collect in a large buffer that is
+  // written out when it fills and at exit, or after every line when stdout
+  // is a terminal. Diagnostics also go to std::cout, so they stay in order
+  // with what the script printed.
+  class Output
+  {
+  public:
+    // Must run before anything is written.
+    static void init();
+    static void line(std::string_view text);
+
+  private:
+    static bool interactive;
+  };
+}
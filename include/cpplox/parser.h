@@ -1,8 +1,10 @@
 #include <vector>
+#include <memory>
 #include <exception>
 #include "expr.h"
 #include "stmt.h"
 #include "token.h"
+#include "resolver.h"
 
 namespace CppLox
 {
@@ -14,11 +16,18 @@ namespace CppLox
   {
   public:
     Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+    // Fused mode: resolves variables while parsing instead of running a
+    // separate Resolver pass, reporting the same errors the Resolver does.
+    Parser(std::vector<Token> tokens, std::shared_ptr<Interpreter> interpreter) : tokens(std::move(tokens)), interpreter(interpreter) {}
     std::vector<StmtPtr> parse();
 
   private:
     std::vector<Token> tokens;
     int current = 0;
+    std::shared_ptr<Interpreter> interpreter;
+    std::vector<Scope> scopes;
+    FunctionType currentFunction = FunctionType::NONE;
+    ClassType currentClass = ClassType::NONE;
     ExprPtr expression();
     ExprPtr assignment();
     ExprPtr equality();
@@ -27,10 +36,12 @@ namespace CppLox
     ExprPtr factor();
     ExprPtr unary();
     ExprPtr primary();
+    ExprPtr interpolation();
     ExprPtr orExpr();
     ExprPtr andExpr();
     ExprPtr call();
     ExprPtr finishCall(ExprPtr callee);
+    ExprPtr finishIndex(ExprPtr object);
 
     Token advance();
     bool check(TokenType type) const;
@@ -47,11 +58,20 @@ namespace CppLox
     StmtPtr expressionStatement();
     StmtPtr declaration();
     StmtPtr varDeclaration();
+    Annotation typeAnnotation();
     StmtPtr ifStatement();
     StmtPtr whileStatement();
     StmtPtr forStatement();
     std::vector<StmtPtr> block();
     StmtPtr function(std::string kind);
     StmtPtr classDeclaration();
+
+    bool resolving() const;
+    void beginScope();
+    void endScope();
+    void declare(const Token &name);
+    void define(const Token &name);
+    void resolveLocal(const Expr *expr, const Token &name);
+    void skipIncrement();
   };
 }
\ No newline at end of file
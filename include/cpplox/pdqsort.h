@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace CppLox
+{
+  // Pattern-defeating quicksort (Orson Peters): an introsort whose
+  // partitioning notices runs that are already sorted and finishes them
+  // with a bounded insertion sort, groups elements equal to the pivot so
+  // many duplicates sort in linear time, and shuffles a few elements after
+  // an unbalanced partition to break up adversarial patterns. After
+  // log2(n) bad partitions it falls back to heapsort, so the worst case is
+  // O(n log n). Not stable. less must be a strict weak ordering: the inner
+  // loops rely on it to stop without bounds checks.
+  namespace PdqSort
+  {
+    constexpr ptrdiff_t INSERTION_SORT_THRESHOLD = 24;
+    constexpr ptrdiff_t NINTHER_THRESHOLD = 128;
+    constexpr ptrdiff_t PARTIAL_INSERTION_SORT_LIMIT = 8;
+
+    template <typename Iter, typename Less>
+    void insertionSort(Iter begin, Iter end, Less less)
+    {
+      if (begin == end)
+        return;
+      for (Iter current = begin + 1; current != end; ++current)
+      {
+        Iter sift = current;
+        Iter previous = current - 1;
+        if (less(*sift, *previous))
+        {
+          auto value = std::move(*sift);
+          do
+          {
+            *sift-- = std::move(*previous);
+          } while (sift != begin && less(value, *--previous));
+          *sift = std::move(value);
+        }
+      }
+    }
+
+    // Requires an element before begin that is not greater than any in
+    // the range.
+    template <typename Iter, typename Less>
+    void unguardedInsertionSort(Iter begin, Iter end, Less less)
+    {
+      if (begin == end)
+        return;
+      for (Iter current = begin + 1; current != end; ++current)
+      {
+        Iter sift = current;
+        Iter previous = current - 1;
+        if (less(*sift, *previous))
+        {
+          auto value = std::move(*sift);
+          do
+          {
+            *sift-- = std::move(*previous);
+          } while (less(value, *--previous));
+          *sift = std::move(value);
+        }
+      }
+    }
+
+    // Insertion sort that gives up, returning false, once it has moved
+    // more than a few elements.
+    template <typename Iter, typename Less>
+    bool partialInsertionSort(Iter begin, Iter end, Less less)
+    {
+      if (begin == end)
+        return true;
+      ptrdiff_t moved = 0;
+      for (Iter current = begin + 1; current != end; ++current)
+      {
+        Iter sift = current;
+        Iter previous = current - 1;
+        if (less(*sift, *previous))
+        {
+          auto value = std::move(*sift);
+          do
+          {
+            *sift-- = std::move(*previous);
+          } while (sift != begin && less(value, *--previous));
+          *sift = std::move(value);
+          moved += current - sift;
+        }
+        if (moved > PARTIAL_INSERTION_SORT_LIMIT)
+          return false;
+      }
+      return true;
+    }
+
+    template <typename Iter, typename Less>
+    void sort2(Iter a, Iter b, Less less)
+    {
+      if (less(*b, *a))
+        std::iter_swap(a, b);
+    }
+
+    template <typename Iter, typename Less>
+    void sort3(Iter a, Iter b, Iter c, Less less)
+    {
+      sort2(a, b, less);
+      sort2(b, c, less);
+      sort2(a, b, less);
+    }
+
+    // Partitions around the pivot at *begin, with elements equal to it on
+    // the right. Returns where the pivot ends up and whether no element had
+    // to move.
+    template <typename Iter, typename Less>
+    std::pair<Iter, bool> partitionRight(Iter begin, Iter end, Less less)
+    {
+      auto pivot = std::move(*begin);
+      Iter first = begin;
+      Iter last = end;
+      // The median-of-three choice leaves an element not less than the
+      // pivot at the end, so this stops.
+      while (less(*++first, pivot))
+        ;
+      if (first - 1 == begin)
+      {
+        while (first < last && !less(*--last, pivot))
+          ;
+      }
+      else
+      {
+        while (!less(*--last, pivot))
+          ;
+      }
+      bool alreadyPartitioned = first >= last;
+      while (first < last)
+      {
+        std::iter_swap(first, last);
+        while (less(*++first, pivot))
+          ;
+        while (!less(*--last, pivot))
+          ;
+      }
+      Iter position = first - 1;
+      *begin = std::move(*position);
+      *position = std::move(pivot);
+      return std::make_pair(position, alreadyPartitioned);
+    }
+
+    // Partitions with elements equal to the pivot on the left. Used when
+    // the pivot equals the element before the range, so the whole left
+    // side is equal and done.
+    template <typename Iter, typename Less>
+    Iter partitionLeft(Iter begin, Iter end, Less less)
+    {
+      auto pivot = std::move(*begin);
+      Iter first = begin;
+      Iter last = end;
+      while (less(pivot, *--last))
+        ;
+      if (last + 1 == end)
+      {
+        while (first < last && !less(pivot, *++first))
+          ;
+      }
+      else
+      {
+        while (!less(pivot, *++first))
+          ;
+      }
+      while (first < last)
+      {
+        std::iter_swap(first, last);
+        while (less(pivot, *--last))
+          ;
+        while (!less(pivot, *++first))
+          ;
+      }
+      Iter position = last;
+      *begin = std::move(*position);
+      *position = std::move(pivot);
+      return position;
+    }
+
+    template <typename Iter, typename Less>
+    void loop(Iter begin, Iter end, Less less, int badAllowed, bool leftmost)
+    {
+      while (true)
+      {
+        ptrdiff_t size = end - begin;
+        if (size < INSERTION_SORT_THRESHOLD)
+        {
+          if (leftmost)
+            insertionSort(begin, end, less);
+          else
+            unguardedInsertionSort(begin, end, less);
+          return;
+        }
+
+        // The pivot: median of three, or Tukey's ninther for large ranges.
+        ptrdiff_t half = size / 2;
+        if (size > NINTHER_THRESHOLD)
+        {
+          sort3(begin, begin + half, end - 1, less);
+          sort3(begin + 1, begin + (half - 1), end - 2, less);
+          sort3(begin + 2, begin + (half + 1), end - 3, less);
+          sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+          std::iter_swap(begin, begin + half);
+        }
+        else
+        {
+          sort3(begin + half, begin, end - 1, less);
+        }
+
+        if (!leftmost && !less(*(begin - 1), *begin))
+        {
+          begin = partitionLeft(begin, end, less) + 1;
+          continue;
+        }
+
+        auto [pivot, alreadyPartitioned] = partitionRight(begin, end, less);
+        ptrdiff_t leftSize = pivot - begin;
+        ptrdiff_t rightSize = end - (pivot + 1);
+        if (leftSize < size / 8 || rightSize < size / 8)
+        {
+          if (--badAllowed == 0)
+          {
+            std::make_heap(begin, end, less);
+            std::sort_heap(begin, end, less);
+            return;
+          }
+          if (leftSize >= INSERTION_SORT_THRESHOLD)
+          {
+            std::iter_swap(begin, begin + leftSize / 4);
+            std::iter_swap(pivot - 1, pivot - leftSize / 4);
+            if (leftSize > NINTHER_THRESHOLD)
+            {
+              std::iter_swap(begin + 1, begin + (leftSize / 4 + 1));
+              std::iter_swap(begin + 2, begin + (leftSize / 4 + 2));
+              std::iter_swap(pivot - 2, pivot - (leftSize / 4 + 1));
+              std::iter_swap(pivot - 3, pivot - (leftSize / 4 + 2));
+            }
+          }
+          if (rightSize >= INSERTION_SORT_THRESHOLD)
+          {
+            std::iter_swap(pivot + 1, pivot + (1 + rightSize / 4));
+            std::iter_swap(end - 1, end - rightSize / 4);
+            if (rightSize > NINTHER_THRESHOLD)
+            {
+              std::iter_swap(pivot + 2, pivot + (2 + rightSize / 4));
+              std::iter_swap(pivot + 3, pivot + (3 + rightSize / 4));
+              std::iter_swap(end - 2, end - (1 + rightSize / 4));
+              std::iter_swap(end - 3, end - (2 + rightSize / 4));
+            }
+          }
+        }
+        else if (alreadyPartitioned && partialInsertionSort(begin, pivot, less) &&
+                 partialInsertionSort(pivot + 1, end, less))
+        {
+          return;
+        }
+
+        // Recurse into the left part and loop on the right.
+        loop(begin, pivot, less, badAllowed, leftmost);
+        begin = pivot + 1;
+        leftmost = false;
+      }
+    }
+  }
+
+  template <typename Iter, typename Less>
+  void pdqsort(Iter begin, Iter end, Less less)
+  {
+    if (end - begin < 2)
+      return;
+    int log2 = 0;
+    for (auto size = end - begin; size > 1; size >>= 1)
+      log2++;
+    PdqSort::loop(begin, end, less, log2, true);
+  }
+}
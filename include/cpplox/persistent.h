@@ -0,0 +1,151 @@
+#pragma once
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace CppLox
+{
+  // An immutable vector, made by PersistentVector() and read with v[i].
+  // Updates return a new vector that shares all but one path of nodes with
+  // the old one, so each costs O(log32 n) copying and both versions stay
+  // valid. Nodes are never changed once built, but copying a version
+  // bumps the non-atomic counts of the strings it holds, so versions are
+  // only shared within one thread.
+  //
+  // The elements live in a radix-balanced trie: 32-way branch nodes whose
+  // leaves hold 32 elements, with the index's 5-bit groups picking the
+  // path. The last, partly full leaf is kept outside the trie as the tail,
+  // so most appends copy only the tail.
+  class PersistentVector
+  {
+  public:
+    PersistentVector();
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    // Requires index < size().
+    const std::any &at(size_t index) const;
+    PersistentVector push(std::any value) const;
+    // Requires index < size().
+    PersistentVector set(size_t index, std::any value) const;
+    // Requires size() > 0.
+    PersistentVector pop() const;
+
+    template <typename Visit>
+    void forEach(Visit visit) const
+    {
+      size_t offset = tailOffset();
+      for (size_t i = 0; i < offset; i += WIDTH)
+      {
+        for (const std::any &value : leafFor(i)->values)
+          visit(value);
+      }
+      for (const std::any &value : tail->values)
+        visit(value);
+    }
+
+  private:
+    static constexpr unsigned BITS = 5;
+    static constexpr size_t WIDTH = size_t(1) << BITS;
+    static constexpr size_t MASK = WIDTH - 1;
+
+    // A branch's children or a leaf's values, in index order.
+    struct Node
+    {
+      std::vector<std::shared_ptr<const Node>> children;
+      std::vector<std::any> values;
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    size_t count = 0;
+    // The bit position of the root's index group.
+    unsigned shift = BITS;
+    NodePtr root;
+    NodePtr tail;
+
+    size_t tailOffset() const
+    {
+      return count < WIDTH ? 0 : ((count - 1) >> BITS) << BITS;
+    }
+
+    // Requires index < tailOffset().
+    const NodePtr &leafFor(size_t index) const;
+    NodePtr pushTail(unsigned level, const Node &parent, NodePtr leaf) const;
+    NodePtr popTail(unsigned level, const Node &node) const;
+    static NodePtr newPath(unsigned level, NodePtr leaf);
+    static NodePtr assoc(unsigned level, const Node &node, size_t index, std::any value);
+  };
+
+  // An immutable map with LoxMap's keys, made by PersistentMap() and read
+  // with m[key]. Like PersistentVector, updates return a new map sharing
+  // all but one path with the old one.
+  //
+  // The entries live in a hash array mapped trie: each level takes 5 bits
+  // of the key's hash, and a node keeps one bitmap of the positions
+  // holding an entry and one of those holding a subnode, with both arrays
+  // packed so popcount finds a position's slot. A removal that leaves a
+  // subnode with one entry pulls the entry up, so equal maps have the same
+  // shape. Keys whose whole 64-bit hashes collide share a list at the
+  // bottom.
+  class PersistentMap
+  {
+  public:
+    PersistentMap();
+
+    size_t size() const
+    {
+      return count;
+    }
+
+    // The value under key, or nullptr. key must be a valid LoxMap key.
+    const std::any *get(const std::any &key) const;
+    PersistentMap set(const std::any &key, std::any value) const;
+    PersistentMap remove(const std::any &key) const;
+
+    template <typename Visit>
+    void forEach(Visit visit) const
+    {
+      forEach(*root, visit);
+    }
+
+  private:
+    struct Entry
+    {
+      uint64_t hash;
+      std::any key;
+      std::any value;
+    };
+
+    struct Node
+    {
+      uint32_t entryMap = 0;
+      uint32_t nodeMap = 0;
+      std::vector<Entry> entries;
+      std::vector<std::shared_ptr<const Node>> children;
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    size_t count = 0;
+    NodePtr root;
+
+    PersistentMap(size_t count, NodePtr root) : count(count), root(std::move(root)) {}
+
+    static NodePtr set(const NodePtr &node, Entry entry, unsigned shift, bool &added);
+    static NodePtr remove(const NodePtr &node, const std::any &key, uint64_t hash, unsigned shift, bool &removed);
+    static NodePtr merge(Entry a, Entry b, unsigned shift);
+
+    template <typename Visit>
+    static void forEach(const Node &node, Visit &visit)
+    {
+      for (const Entry &entry : node.entries)
+        visit(entry.key, entry.value);
+      for (const NodePtr &child : node.children)
+        forEach(*child, visit);
+    }
+  };
+}
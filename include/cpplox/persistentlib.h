@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "environment.h"
+#include "native.h"
+
+namespace CppLox
+{
+  // Defines PersistentVector() and PersistentMap(), which make empty
+  // immutable collections, toPersistent(c), which copies a list or a map
+  // into one, and the updates, which return a new collection and leave
+  // their argument as it was: conj(v, value) appends, assoc(c, key, value)
+  // replaces an element (or appends, at index len(v)) or sets a key,
+  // dissoc(m, key) drops a key and dropLast(v) drops the last element.
+  // c[key] reads, and len, get, has, keys and values also take persistent
+  // maps.
+  void definePersistentLibrary(Environment &globals);
+  // Whether name is one of the functions above.
+  bool isPersistentLibraryFunction(const std::string &name);
+}
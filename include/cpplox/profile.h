@@ -0,0 +1,91 @@
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+
+namespace CppLox
+{
+  // Type and call feedback of one run, written by --profile-out and read
+  // back by --profile-in so a short run starts from where an earlier one
+  // warmed up: the specialization each Binary node settled on, and how
+  // often each function was called. Nodes are numbered in source order over
+  // the tree the front end produces, before the optimizer rewrites it, and
+  // the file is keyed by a hash of the source, so a profile of another
+  // version of the script is ignored.
+  //
+  // Nothing else is recorded: not receiver classes at Get or Call, and not
+  // how often If and While branches go each way. Nothing here could use
+  // them, since there are no inline caches and no code layout to order.
+  class Profile : public ExprVisitor<std::any>, public StmtVisitor<std::any>
+  {
+  public:
+    std::any visitBinaryExpr(const Binary *expr) override;
+    std::any visitGroupingExpr(const Grouping *expr) override;
+    std::any visitLiteralExpr(const Literal *expr) override;
+    std::any visitUnaryExpr(const Unary *expr) override;
+    std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
+    std::any visitExpressionStmt(const Expression *stmt) override;
+    std::any visitPrintStmt(const Print *stmt) override;
+    std::any visitVariableExpr(const Variable *expr) override;
+    std::any visitVarStmt(const Var *stmt) override;
+    std::any visitAssignExpr(const Assign *expr) override;
+    std::any visitBlockStmt(const Block *stmt) override;
+    std::any visitIfStmt(const If *stmt) override;
+    std::any visitWhileStmt(const While *stmt) override;
+    std::any visitCallExpr(const Call *expr) override;
+    std::any visitFunctionStmt(const Function *stmt) override;
+    std::any visitReturnStmt(const Return *stmt) override;
+    std::any visitClassStmt(const Class *stmt) override;
+    std::any visitGetExpr(const Get *expr) override;
+    std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
+    std::any visitThisExpr(const This *expr) override;
+    std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
+
+    // Numbers the nodes of a program fresh from the front end.
+    void index(const std::vector<StmtPtr> &stmts);
+    // Presets the recorded specializations and call counts. Returns false,
+    // leaving the program untouched, if the file is missing, malformed or
+    // recorded from a different source.
+    bool load(const std::string &path, const std::string &source);
+    void save(const std::string &path, const std::string &source) const;
+
+    void countCall(const Function *function)
+    {
+      calls[function]++;
+    }
+
+    uint64_t callsTo(const Function *function) const;
+    const std::unordered_map<const Function *, uint64_t> &callCounts() const
+    {
+      return calls;
+    }
+
+  private:
+    std::vector<const Binary *> binaries;
+    std::vector<const Function *> functions;
+    std::unordered_map<const Function *, uint64_t> calls;
+
+    void index(const Stmt *stmt);
+    void index(const Expr *expr);
+  };
+}
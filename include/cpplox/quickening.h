@@ -0,0 +1,37 @@
+#pragma once
+
+namespace CppLox
+{
+  // The specialization a Binary node has rewritten itself to. A node starts
+  // UNINITIALIZED, picks a type-specialized kind from the operands seen on
+  // its first execution, and drops to GENERIC for good when a guard fails.
+  // An _INTEGERS kind widens to its _NUMBERS kind when an operand is not an
+  // integer.
+  enum class BinaryKind
+  {
+    UNINITIALIZED,
+    GENERIC,
+    ADD_NUMBERS,
+    SUBTRACT_NUMBERS,
+    MULTIPLY_NUMBERS,
+    DIVIDE_NUMBERS,
+    LESS_NUMBERS,
+    LESS_EQUAL_NUMBERS,
+    GREATER_NUMBERS,
+    GREATER_EQUAL_NUMBERS,
+    EQUAL_NUMBERS,
+    NOT_EQUAL_NUMBERS,
+    CONCAT_STRINGS,
+    // In the order of the _NUMBERS kinds.
+    ADD_INTEGERS,
+    SUBTRACT_INTEGERS,
+    MULTIPLY_INTEGERS,
+    DIVIDE_INTEGERS,
+    LESS_INTEGERS,
+    LESS_EQUAL_INTEGERS,
+    GREATER_INTEGERS,
+    GREATER_EQUAL_INTEGERS,
+    EQUAL_INTEGERS,
+    NOT_EQUAL_INTEGERS
+  };
+}
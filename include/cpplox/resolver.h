@@ -7,6 +7,7 @@
 #include "expr.h"
 #include "stmt.h"
 #include "interpreter.h"
+#include "bindings.h"
 
 namespace CppLox
 {
@@ -41,6 +42,7 @@ namespace CppLox
     std::any visitLiteralExpr(const Literal *expr) override;
     std::any visitUnaryExpr(const Unary *expr) override;
     std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
     std::any visitExpressionStmt(const Expression *stmt) override;
     std::any visitPrintStmt(const Print *stmt) override;
     std::any visitVariableExpr(const Variable *expr) override;
@@ -55,8 +57,21 @@ namespace CppLox
     std::any visitClassStmt(const Class *stmt) override;
     std::any visitGetExpr(const Get *expr) override;
     std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
     std::any visitThisExpr(const This *expr) override;
     std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
     void resolve(const std::vector<StmtPtr> &stmts);
 
   private:
@@ -74,4 +89,66 @@ namespace CppLox
     template <typename T>
     static void printUniquePtrType(const std::unique_ptr<T> &ptr);
   };
+
+  // Checks type annotations once the program is resolved: values whose type
+  // is evident from the source (literals, operators, annotated locals) must
+  // match the annotation they are stored under or returned through, and
+  // annotated variables need an initializer. Marks each Assign to an
+  // annotated local with its type so the interpreter checks the values it
+  // cannot prove; annotated globals are checked by their Environment.
+  class TypeChecker : public ExprVisitor<std::any>, public StmtVisitor<std::any>
+  {
+  public:
+    TypeChecker(std::shared_ptr<Interpreter> interpreter) : analysis(*interpreter) {}
+    std::any visitBinaryExpr(const Binary *expr) override;
+    std::any visitGroupingExpr(const Grouping *expr) override;
+    std::any visitLiteralExpr(const Literal *expr) override;
+    std::any visitUnaryExpr(const Unary *expr) override;
+    std::any visitLogicalExpr(const Logical *expr) override;
+    std::any visitInterpolationExpr(const Interpolation *expr) override;
+    std::any visitExpressionStmt(const Expression *stmt) override;
+    std::any visitPrintStmt(const Print *stmt) override;
+    std::any visitVariableExpr(const Variable *expr) override;
+    std::any visitVarStmt(const Var *stmt) override;
+    std::any visitAssignExpr(const Assign *expr) override;
+    std::any visitBlockStmt(const Block *stmt) override;
+    std::any visitIfStmt(const If *stmt) override;
+    std::any visitWhileStmt(const While *stmt) override;
+    std::any visitCallExpr(const Call *expr) override;
+    std::any visitFunctionStmt(const Function *stmt) override;
+    std::any visitReturnStmt(const Return *stmt) override;
+    std::any visitClassStmt(const Class *stmt) override;
+    std::any visitGetExpr(const Get *expr) override;
+    std::any visitSetExpr(const Set *expr) override;
+    std::any visitIndexExpr(const Index *expr) override;
+    std::any visitSetIndexExpr(const SetIndex *expr) override;
+    std::any visitSliceExpr(const Slice *expr) override;
+    std::any visitThisExpr(const This *expr) override;
+    std::any visitSuperExpr(const Super *expr) override;
+    std::any visitAssignOpExpr(const AssignOp *expr) override;
+    std::any visitCompareVariableExpr(const CompareVariable *expr) override;
+    std::any visitSetFieldOpExpr(const SetFieldOp *expr) override;
+    std::any visitInlinedCallExpr(const InlinedCall *expr) override;
+    std::any visitArgRefExpr(const ArgRef *expr) override;
+    std::any visitConditionalExpr(const Conditional *expr) override;
+    std::any visitInvariantExpr(const Invariant *expr) override;
+    std::any visitForLoopStmt(const ForLoop *stmt) override;
+    std::any visitCountedLoopStmt(const CountedLoop *stmt) override;
+    std::any visitInvariantLoopStmt(const InvariantLoop *stmt) override;
+    // Returns false if an annotation is violated.
+    bool check(const std::vector<StmtPtr> &stmts);
+
+  private:
+    BindingAnalysis analysis;
+    std::unordered_map<const Binding *, Annotation> annotations;
+    // Return types of the functions being checked, innermost last.
+    std::vector<Annotation> returnTypes;
+    bool valid = true;
+
+    // The type the expression evidently has, "" when it is not evident.
+    std::string typeOf(const ExprPtr &expr);
+    void check(const StmtPtr &stmt);
+    void expect(Annotation annotation, const std::string &type, const Token &where);
+    void checkFunction(const Function *function);
+  };
 }
\ No newline at end of file
@@ -40,6 +40,8 @@ namespace CppLox
     int start = 0;
     int current = 0;
     int line = 1;
+    // For each `${` still open, the braces opened inside it.
+    std::vector<int> interpolations;
 
     bool isAtEnd();
     void scanToken();
@@ -21,6 +21,9 @@ namespace CppLox
   class Function;
   class If;
   class While;
+  class ForLoop;
+  class CountedLoop;
+  class InvariantLoop;
 
   class BaseStmtVisitor
   {
@@ -41,6 +44,9 @@ namespace CppLox
     virtual R visitFunctionStmt(const Function *stmt) = 0;
     virtual R visitIfStmt(const If *stmt) = 0;
     virtual R visitWhileStmt(const While *stmt) = 0;
+    virtual R visitForLoopStmt(const ForLoop *stmt) = 0;
+    virtual R visitCountedLoopStmt(const CountedLoop *stmt) = 0;
+    virtual R visitInvariantLoopStmt(const InvariantLoop *stmt) = 0;
   };
 
   class Stmt
@@ -148,7 +154,7 @@ namespace CppLox
   struct Var : public Stmt
   {
 
-    Var(Token name, ExprPtr initializer) : name(std::move(name)), initializer(std::move(initializer)) {}
+    Var(Token name, ExprPtr initializer, Annotation annotation = Annotation::NONE) : name(std::move(name)), initializer(std::move(initializer)), annotation(annotation) {}
 
     std::any accept(BaseStmtVisitor &visitor) const override
     {
@@ -160,6 +166,7 @@ namespace CppLox
 
     Token name;
     ExprPtr initializer;
+    Annotation annotation;
   };
 
   using VarPtr = std::unique_ptr<Var>;
@@ -167,7 +174,9 @@ namespace CppLox
   struct Function : public Stmt
   {
 
-    Function(Token name, vector<Token> params, vector<StmtPtr> body) : name(std::move(name)), params(std::move(params)), body(std::move(body)) {}
+    // paramTypes is empty when no parameter is annotated.
+    Function(Token name, vector<Token> params, vector<StmtPtr> body, vector<Annotation> paramTypes = {}, Annotation returnType = Annotation::NONE)
+        : name(std::move(name)), params(std::move(params)), body(std::move(body)), paramTypes(std::move(paramTypes)), returnType(returnType) {}
 
     std::any accept(BaseStmtVisitor &visitor) const override
     {
@@ -180,6 +189,13 @@ namespace CppLox
     Token name;
     vector<Token> params;
     vector<StmtPtr> body;
+    vector<Annotation> paramTypes;
+    Annotation returnType;
+
+    bool annotated() const
+    {
+      return !paramTypes.empty() || returnType != Annotation::NONE;
+    }
   };
 
   using FunctionPtr = std::unique_ptr<Function>;
@@ -223,4 +239,68 @@ namespace CppLox
 
   using WhilePtr = std::unique_ptr<While>;
 
+  struct ForLoop : public Stmt
+  {
+
+    ForLoop(ExprPtr condition, vector<StmtPtr> body, ExprPtr increment) : condition(std::move(condition)), body(std::move(body)), increment(std::move(increment)) {}
+
+    std::any accept(BaseStmtVisitor &visitor) const override
+    {
+      auto visitor_ptr = dynamic_cast<StmtVisitor<std::any> *>(&visitor);
+      if (visitor_ptr)
+        return std::any(visitor_ptr->visitForLoopStmt(this));
+      return std::any();
+    }
+
+    ExprPtr condition;
+    vector<StmtPtr> body;
+    ExprPtr increment;
+  };
+
+  using ForLoopPtr = std::unique_ptr<ForLoop>;
+
+  struct CountedLoop : public Stmt
+  {
+
+    CountedLoop(Token name, ExprPtr start, Token op, ExprPtr limit, Token stepOp, double step, vector<StmtPtr> body, bool materialize) : name(std::move(name)), start(std::move(start)), op(std::move(op)), limit(std::move(limit)), stepOp(std::move(stepOp)), step(std::move(step)), body(std::move(body)), materialize(std::move(materialize)) {}
+
+    std::any accept(BaseStmtVisitor &visitor) const override
+    {
+      auto visitor_ptr = dynamic_cast<StmtVisitor<std::any> *>(&visitor);
+      if (visitor_ptr)
+        return std::any(visitor_ptr->visitCountedLoopStmt(this));
+      return std::any();
+    }
+
+    Token name;
+    ExprPtr start;
+    Token op;
+    ExprPtr limit;
+    Token stepOp;
+    double step;
+    vector<StmtPtr> body;
+    bool materialize;
+  };
+
+  using CountedLoopPtr = std::unique_ptr<CountedLoop>;
+
+  struct InvariantLoop : public Stmt
+  {
+
+    InvariantLoop(StmtPtr loop) : loop(std::move(loop)) {}
+
+    std::any accept(BaseStmtVisitor &visitor) const override
+    {
+      auto visitor_ptr = dynamic_cast<StmtVisitor<std::any> *>(&visitor);
+      if (visitor_ptr)
+        return std::any(visitor_ptr->visitInvariantLoopStmt(this));
+      return std::any();
+    }
+
+    StmtPtr loop;
+    mutable uint64_t activation = 0;
+  };
+
+  using InvariantLoopPtr = std::unique_ptr<InvariantLoop>;
+
 }
@@ -0,0 +1,19 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "environment.h"
+#include "native.h"
+
+namespace CppLox
+{
+  // Defines len, substr, indexOf, replace, startsWith, endsWith, toUpper,
+  // toLower, trim, split and join. Indices count bytes from 0. Searches and
+  // comparisons run on the string's characters in place through
+  // std::string_view, and substr, trim and split return slices of long
+  // strings rather than copies. len also gives the size of a list, an
+  // array, a map or a persistent collection.
+  void defineStringLibrary(Environment &globals);
+  // Whether name is one of the functions above.
+  bool isStringLibraryFunction(const std::string &name);
+}
@@ -1,15 +1,18 @@
 #pragma once
 
 #include <any>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <variant>
 #include <utility>
 
+#include "loxstring.h"
 #include "tokentype.h"
 
 namespace CppLox
 {
-  using LiteralType = std::variant<std::nullptr_t, int, double, std::string>;
+  using LiteralType = std::variant<std::nullptr_t, bool, int64_t, double, std::string>;
 
   struct ToStringVisitor
   {
@@ -17,7 +20,11 @@ namespace CppLox
     {
       return "nullptr";
     }
-    std::string operator()(int value) const
+    std::string operator()(bool value) const
+    {
+      return value ? "true" : "false";
+    }
+    std::string operator()(int64_t value) const
     {
       return std::to_string(value);
     }
@@ -31,11 +38,16 @@ namespace CppLox
     }
   };
 
-  // Function to convert LiteralType to std::any
+  // Function to convert LiteralType to std::any. String literals are
+  // interned.
   inline std::any toAny(const LiteralType &literal)
   {
     return std::visit([](auto &&arg) -> std::any
-                      { return std::any(arg); }, literal);
+                      {
+                        if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, std::string>)
+                          return std::any(LoxStringRef::intern(arg));
+                        else
+                          return std::any(arg); }, literal);
   }
 
   inline std::string literal_to_string(const LiteralType &var)
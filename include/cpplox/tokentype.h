@@ -14,6 +14,8 @@ namespace CppLox
     RIGHT_PAREN,
     LEFT_BRACE,
     RIGHT_BRACE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
     COMMA,
     DOT,
     MINUS,
@@ -21,6 +23,7 @@ namespace CppLox
     SEMICOLON,
     SLASH,
     STAR,
+    COLON,
 
     // One or two character tokens.
     BANG,
@@ -35,6 +38,9 @@ namespace CppLox
     // Literals.
     IDENTIFIER,
     STRING,
+    // The text of a string up to a `${`; the string goes on after the
+    // matching `}`.
+    INTERPOLATION,
     NUMBER,
 
     // Keywords.
@@ -63,6 +69,8 @@ namespace CppLox
       "RIGHT_PAREN",
       "LEFT_BRACE",
       "RIGHT_BRACE",
+      "LEFT_BRACKET",
+      "RIGHT_BRACKET",
       "COMMA",
       "DOT",
       "MINUS",
@@ -70,6 +78,7 @@ namespace CppLox
       "SEMICOLON",
       "SLASH",
       "STAR",
+      "COLON",
 
       // One or two character tokens.
       "BANG",
@@ -84,6 +93,7 @@ namespace CppLox
       // Literals.
       "IDENTIFIER",
       "STRING",
+      "INTERPOLATION",
       "NUMBER",
 
       // Keywords.
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "cpplox/arraylib.h"
+#include "cpplox/loxarray.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/numberformat.h"
+#include "cpplox/pdqsort.h"
+
+namespace CppLox
+{
+  std::string Float64Array::toString() const
+  {
+    std::string result = "[";
+    char buffer[NUMBER_BUFFER_SIZE];
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+      if (i != 0)
+        result += ", ";
+      result += formatNumber(elements[i], buffer);
+    }
+    return result + "]";
+  }
+
+  // Two doubles: an SSE2 or NEON register, so the kernels need no -m
+  // flags. Each loop keeps two of them in flight to hide the add latency.
+  typedef double Lanes __attribute__((vector_size(2 * sizeof(double))));
+  static const size_t LANES = 2;
+  static const size_t STRIDE = 2 * LANES;
+
+  // memcpy, because the elements of a std::vector<double> are only
+  // aligned to a double.
+  static inline Lanes load(const double *address)
+  {
+    Lanes lanes;
+    std::memcpy(&lanes, address, sizeof lanes);
+    return lanes;
+  }
+
+  static inline void store(double *address, Lanes lanes)
+  {
+    std::memcpy(address, &lanes, sizeof lanes);
+  }
+
+  static inline Lanes broadcast(double value)
+  {
+    return Lanes{value, value};
+  }
+
+  // Sums and dot products add in four interleaved partial sums, so they
+  // can differ from a left-to-right loop in the last bits.
+  static double sumKernel(const double *x, size_t n)
+  {
+    Lanes a = broadcast(0), b = broadcast(0);
+    size_t i = 0;
+    for (; i + STRIDE <= n; i += STRIDE)
+    {
+      a += load(x + i);
+      b += load(x + i + LANES);
+    }
+    a += b;
+    double total = a[0] + a[1];
+    for (; i < n; i++)
+      total += x[i];
+    return total;
+  }
+
+  static double dotKernel(const double *x, const double *y, size_t n)
+  {
+    Lanes a = broadcast(0), b = broadcast(0);
+    size_t i = 0;
+    for (; i + STRIDE <= n; i += STRIDE)
+    {
+      a += load(x + i) * load(y + i);
+      b += load(x + i + LANES) * load(y + i + LANES);
+    }
+    a += b;
+    double total = a[0] + a[1];
+    for (; i < n; i++)
+      total += x[i] * y[i];
+    return total;
+  }
+
+  // y += alpha * x.
+  static void axpyKernel(double alpha, const double *x, double *y, size_t n)
+  {
+    Lanes scale = broadcast(alpha);
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+      store(y + i, load(y + i) + scale * load(x + i));
+    for (; i < n; i++)
+      y[i] += alpha * x[i];
+  }
+
+  static void scaleKernel(double *x, double factor, size_t n)
+  {
+    Lanes scale = broadcast(factor);
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+      store(x + i, load(x + i) * scale);
+    for (; i < n; i++)
+      x[i] *= factor;
+  }
+
+  template <typename Op>
+  static void elementwiseKernel(const double *x, const double *y, double *out, size_t n, Op op)
+  {
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+      store(out + i, op(load(x + i), load(y + i)));
+    for (; i < n; i++)
+      out[i] = op(x[i], y[i]);
+  }
+
+  // The smallest (or, with Greater, largest) element, or NaN if there is
+  // one. The selects have no branches, so they become minpd/maxpd.
+  template <bool Greater>
+  static double extremumKernel(const double *x, size_t n)
+  {
+    double a = x[0], b = x[0];
+    bool unordered = false;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      a = (Greater ? x[i] > a : x[i] < a) ? x[i] : a;
+      b = (Greater ? x[i + 1] > b : x[i + 1] < b) ? x[i + 1] : b;
+      unordered |= (x[i] != x[i]) | (x[i + 1] != x[i + 1]);
+    }
+    for (; i < n; i++)
+    {
+      a = (Greater ? x[i] > a : x[i] < a) ? x[i] : a;
+      unordered |= x[i] != x[i];
+    }
+    if (unordered)
+      return std::numeric_limits<double>::quiet_NaN();
+    return (Greater ? b > a : b < a) ? b : a;
+  }
+
+  static Float64Array &arrayArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *array = std::any_cast<std::shared_ptr<Float64Array>>(&arguments[index]);
+    if (array == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a Float64Array.");
+    return **array;
+  }
+
+  static void checkLengths(const Float64Array &x, const Float64Array &y, const char *function)
+  {
+    if (x.elements.size() != y.elements.size())
+      throw NativeError(std::string("Arrays passed to '") + function + "' must have the same length.");
+  }
+
+  static std::any makeArray(const std::vector<std::any> &arguments)
+  {
+    int64_t length = integerArgument(arguments, 0, "Float64Array");
+    if (length < 0 || length > (int64_t(1) << 32))
+      throw NativeError("Length " + std::to_string(length) + " is out of range for 'Float64Array'.");
+    return std::make_shared<Float64Array>(static_cast<size_t>(length));
+  }
+
+  static std::any sum(const std::vector<std::any> &arguments)
+  {
+    const Float64Array &x = arrayArgument(arguments, 0, "sum");
+    return sumKernel(x.elements.data(), x.elements.size());
+  }
+
+  static std::any dot(const std::vector<std::any> &arguments)
+  {
+    const Float64Array &x = arrayArgument(arguments, 0, "dot");
+    const Float64Array &y = arrayArgument(arguments, 1, "dot");
+    checkLengths(x, y, "dot");
+    return dotKernel(x.elements.data(), y.elements.data(), x.elements.size());
+  }
+
+  static std::any axpy(const std::vector<std::any> &arguments)
+  {
+    double alpha = numberArgument(arguments, 0, "axpy");
+    const Float64Array &x = arrayArgument(arguments, 1, "axpy");
+    Float64Array &y = arrayArgument(arguments, 2, "axpy");
+    checkLengths(x, y, "axpy");
+    axpyKernel(alpha, x.elements.data(), y.elements.data(), y.elements.size());
+    return std::any();
+  }
+
+  static std::any scale(const std::vector<std::any> &arguments)
+  {
+    Float64Array &x = arrayArgument(arguments, 0, "scale");
+    scaleKernel(x.elements.data(), numberArgument(arguments, 1, "scale"), x.elements.size());
+    return std::any();
+  }
+
+  template <bool Greater>
+  static std::any extremum(const std::vector<std::any> &arguments)
+  {
+    const char *function = Greater ? "max" : "min";
+    const Float64Array &x = arrayArgument(arguments, 0, function);
+    if (x.elements.empty())
+      throw NativeError(std::string("Cannot take the ") + function + " of an empty array.");
+    return extremumKernel<Greater>(x.elements.data(), x.elements.size());
+  }
+
+  template <typename Op>
+  static std::any elementwise(const std::vector<std::any> &arguments, const char *function, Op op)
+  {
+    const Float64Array &x = arrayArgument(arguments, 0, function);
+    const Float64Array &y = arrayArgument(arguments, 1, function);
+    checkLengths(x, y, function);
+    auto result = std::make_shared<Float64Array>(x.elements.size());
+    elementwiseKernel(x.elements.data(), y.elements.data(), result->elements.data(), x.elements.size(), op);
+    return result;
+  }
+
+  static std::any add(const std::vector<std::any> &arguments)
+  {
+    return elementwise(arguments, "add", [](auto a, auto b)
+                       { return a + b; });
+  }
+
+  static std::any mul(const std::vector<std::any> &arguments)
+  {
+    return elementwise(arguments, "mul", [](auto a, auto b)
+                       { return a * b; });
+  }
+
+  // Sorts a list or an array in place.
+  static std::any sort(const std::vector<std::any> &arguments)
+  {
+    if (const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&arguments[0]))
+    {
+      (*list)->sort();
+      return std::any();
+    }
+    const auto *array = std::any_cast<std::shared_ptr<Float64Array>>(&arguments[0]);
+    if (array == nullptr)
+      throw NativeError("Argument 1 of 'sort' must be a list or a Float64Array.");
+    std::vector<double> &elements = (*array)->elements;
+    auto numbers = std::partition(elements.begin(), elements.end(), [](double value)
+                                  { return !std::isnan(value); });
+    pdqsort(elements.begin(), numbers, std::less<double>());
+    return std::any();
+  }
+
+  static const NativeEntry ARRAY_LIBRARY[] = {
+      {"Float64Array", 1, makeArray},
+      {"sum", 1, sum},
+      {"dot", 2, dot},
+      {"axpy", 3, axpy},
+      {"scale", 2, scale},
+      {"min", 1, extremum<false>},
+      {"max", 1, extremum<true>},
+      {"add", 2, add},
+      {"mul", 2, mul},
+      {"sort", 1, sort},
+  };
+
+  void defineArrayLibrary(Environment &globals)
+  {
+    defineNatives(globals, ARRAY_LIBRARY);
+  }
+
+  bool isArrayLibraryFunction(const std::string &name)
+  {
+    return definesNative(ARRAY_LIBRARY, name);
+  }
+}
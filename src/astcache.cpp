@@ -0,0 +1,872 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <sstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpplox/astcache.h"
+
+namespace CppLox
+{
+  // Bump whenever the node layout below changes so stale files are ignored.
+  static const uint64_t FORMAT_VERSION = 12;
+  static const char MAGIC[4] = {'L', 'O', 'X', 'C'};
+
+  class MappedFile
+  {
+  public:
+    MappedFile(const std::string &path)
+    {
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+        return;
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+        void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+          data = static_cast<const char *>(mapped);
+          size = st.st_size;
+        }
+      }
+      close(fd);
+    }
+
+    ~MappedFile()
+    {
+      if (data != nullptr)
+        munmap(const_cast<char *>(data), size);
+    }
+
+    const char *data = nullptr;
+    size_t size = 0;
+  };
+
+  uint64_t AstCache::hash(const std::string &source)
+  {
+    return hash(source.data(), source.size());
+  }
+
+  uint64_t AstCache::hash(const char *data, size_t size)
+  {
+    // 64-bit FNV-1a.
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+      h ^= static_cast<unsigned char>(data[i]);
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  std::string AstCache::pathFor(const std::string &source) const
+  {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash(source) << ".loxc";
+    return (std::filesystem::path(directory) / name.str()).string();
+  }
+
+  bool AstCache::load(const std::string &source, std::vector<StmtPtr> &stmts)
+  {
+    MappedFile file(pathFor(source));
+    if (file.data == nullptr)
+      return false;
+
+    try
+    {
+      AstReader reader(*interpreter, file.data, file.size);
+      stmts = reader.readProgram(source.size());
+      return true;
+    }
+    catch (const std::exception &)
+    {
+      return false;
+    }
+  }
+
+  void AstCache::store(const std::string &source, const std::vector<StmtPtr> &stmts)
+  {
+    std::string out;
+    AstWriter writer(*interpreter, out);
+    writer.writeProgram(source.size(), stmts);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::string path = pathFor(source);
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    {
+      std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+      if (!file.is_open())
+        return;
+      file.write(out.data(), out.size());
+      if (!file)
+      {
+        std::remove(tmp.c_str());
+        return;
+      }
+    }
+    std::rename(tmp.c_str(), path.c_str());
+  }
+
+  // The header: magic, format version, source length, and a checksum of
+  // the tree that follows, patched in once the tree is written.
+  void AstWriter::writeProgram(size_t sourceSize, const std::vector<StmtPtr> &stmts)
+  {
+    out.append(MAGIC, sizeof(MAGIC));
+    writeVarint(FORMAT_VERSION);
+    writeVarint(sourceSize);
+    size_t checksum = out.size();
+    out.append(sizeof(uint64_t), '\0');
+    write(stmts);
+    size_t payload = checksum + sizeof(uint64_t);
+    uint64_t sum = AstCache::hash(out.data() + payload, out.size() - payload);
+    for (size_t i = 0; i < sizeof(uint64_t); i++)
+    {
+      out[checksum + i] = static_cast<char>(sum >> (8 * i));
+    }
+  }
+
+  void AstWriter::write(const std::vector<StmtPtr> &stmts)
+  {
+    writeVarint(stmts.size());
+    for (const auto &stmt : stmts)
+    {
+      write(stmt);
+    }
+  }
+
+  void AstWriter::write(const StmtPtr &stmt)
+  {
+    if (stmt == nullptr)
+    {
+      writeTag(NodeTag::NULL_NODE);
+      return;
+    }
+    stmt->accept(*this);
+  }
+
+  void AstWriter::write(const ExprPtr &expr)
+  {
+    if (expr == nullptr)
+    {
+      writeTag(NodeTag::NULL_NODE);
+      return;
+    }
+    expr->accept(*this);
+  }
+
+  void AstWriter::writeTag(NodeTag tag)
+  {
+    out.push_back(static_cast<char>(tag));
+  }
+
+  void AstWriter::writeVarint(uint64_t value)
+  {
+    while (value >= 0x80)
+    {
+      out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+  }
+
+  void AstWriter::writeString(const std::string &value)
+  {
+    writeVarint(value.size());
+    out.append(value);
+  }
+
+  void AstWriter::writeLiteral(const LiteralType &value)
+  {
+    writeVarint(value.index());
+    std::visit([this](const auto &arg)
+               {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, std::string>)
+        {
+          writeString(arg);
+        }
+        else if constexpr (!std::is_same_v<T, std::nullptr_t>)
+        {
+          char bytes[sizeof(T)];
+          std::memcpy(bytes, &arg, sizeof(T));
+          out.append(bytes, sizeof(T));
+        } }, value);
+  }
+
+  void AstWriter::writeToken(const Token &token)
+  {
+    writeVarint(token.type);
+    writeVarint(token.line);
+    writeString(token.lexeme);
+    writeLiteral(token.literal);
+  }
+
+  void AstWriter::writeAnnotation(Annotation annotation)
+  {
+    writeVarint(static_cast<uint64_t>(annotation));
+  }
+
+  void AstWriter::writeDepth(const Expr *expr)
+  {
+    writeVarint(interpreter.resolvedDepth(expr) + 1);
+  }
+
+  std::any AstWriter::visitBinaryExpr(const Binary *expr)
+  {
+    writeTag(NodeTag::BINARY);
+    write(expr->left);
+    writeToken(expr->op);
+    write(expr->right);
+    return std::any();
+  }
+
+  std::any AstWriter::visitCallExpr(const Call *expr)
+  {
+    writeTag(NodeTag::CALL);
+    write(expr->callee);
+    writeToken(expr->paren);
+    writeVarint(expr->arguments.size());
+    for (const auto &argument : expr->arguments)
+    {
+      write(argument);
+    }
+    return std::any();
+  }
+
+  std::any AstWriter::visitGetExpr(const Get *expr)
+  {
+    writeTag(NodeTag::GET);
+    write(expr->object);
+    writeToken(expr->name);
+    return std::any();
+  }
+
+  std::any AstWriter::visitSetExpr(const Set *expr)
+  {
+    writeTag(NodeTag::SET);
+    write(expr->object);
+    writeToken(expr->name);
+    write(expr->value);
+    return std::any();
+  }
+
+  std::any AstWriter::visitIndexExpr(const Index *expr)
+  {
+    writeTag(NodeTag::INDEX);
+    write(expr->object);
+    writeToken(expr->bracket);
+    write(expr->index);
+    return std::any();
+  }
+
+  std::any AstWriter::visitSetIndexExpr(const SetIndex *expr)
+  {
+    writeTag(NodeTag::SET_INDEX);
+    write(expr->object);
+    writeToken(expr->bracket);
+    write(expr->index);
+    write(expr->value);
+    return std::any();
+  }
+
+  std::any AstWriter::visitSliceExpr(const Slice *expr)
+  {
+    writeTag(NodeTag::SLICE);
+    write(expr->object);
+    writeToken(expr->bracket);
+    write(expr->start);
+    write(expr->end);
+    return std::any();
+  }
+
+  std::any AstWriter::visitSuperExpr(const Super *expr)
+  {
+    writeTag(NodeTag::SUPER);
+    writeToken(expr->keyword);
+    writeToken(expr->method);
+    writeDepth(expr);
+    return std::any();
+  }
+
+  std::any AstWriter::visitGroupingExpr(const Grouping *expr)
+  {
+    writeTag(NodeTag::GROUPING);
+    write(expr->expression);
+    return std::any();
+  }
+
+  std::any AstWriter::visitLiteralExpr(const Literal *expr)
+  {
+    writeTag(NodeTag::LITERAL);
+    writeLiteral(expr->value);
+    return std::any();
+  }
+
+  std::any AstWriter::visitThisExpr(const This *expr)
+  {
+    writeTag(NodeTag::THIS);
+    writeToken(expr->keyword);
+    writeDepth(expr);
+    return std::any();
+  }
+
+  std::any AstWriter::visitUnaryExpr(const Unary *expr)
+  {
+    writeTag(NodeTag::UNARY);
+    writeToken(expr->op);
+    write(expr->right);
+    return std::any();
+  }
+
+  std::any AstWriter::visitVariableExpr(const Variable *expr)
+  {
+    writeTag(NodeTag::VARIABLE);
+    writeToken(expr->name);
+    writeDepth(expr);
+    return std::any();
+  }
+
+  std::any AstWriter::visitAssignExpr(const Assign *expr)
+  {
+    writeTag(NodeTag::ASSIGN);
+    writeToken(expr->name);
+    write(expr->value);
+    writeDepth(expr);
+    return std::any();
+  }
+
+  std::any AstWriter::visitLogicalExpr(const Logical *expr)
+  {
+    writeTag(NodeTag::LOGICAL);
+    write(expr->left);
+    writeToken(expr->op);
+    write(expr->right);
+    return std::any();
+  }
+
+  std::any AstWriter::visitInterpolationExpr(const Interpolation *expr)
+  {
+    writeTag(NodeTag::INTERPOLATION);
+    writeToken(expr->quote);
+    writeVarint(expr->parts.size());
+    for (const auto &part : expr->parts)
+    {
+      write(part);
+    }
+    return std::any();
+  }
+
+  std::any AstWriter::visitBlockStmt(const Block *stmt)
+  {
+    writeTag(NodeTag::BLOCK);
+    write(stmt->statements);
+    return std::any();
+  }
+
+  std::any AstWriter::visitClassStmt(const Class *stmt)
+  {
+    writeTag(NodeTag::CLASS);
+    writeToken(stmt->name);
+    write(stmt->superclass);
+    write(stmt->methods);
+    return std::any();
+  }
+
+  std::any AstWriter::visitExpressionStmt(const Expression *stmt)
+  {
+    writeTag(NodeTag::EXPRESSION);
+    write(stmt->expression);
+    return std::any();
+  }
+
+  std::any AstWriter::visitPrintStmt(const Print *stmt)
+  {
+    writeTag(NodeTag::PRINT);
+    write(stmt->expression);
+    return std::any();
+  }
+
+  std::any AstWriter::visitReturnStmt(const Return *stmt)
+  {
+    writeTag(NodeTag::RETURN);
+    writeToken(stmt->keyword);
+    write(stmt->value);
+    return std::any();
+  }
+
+  std::any AstWriter::visitVarStmt(const Var *stmt)
+  {
+    writeTag(NodeTag::VAR);
+    writeToken(stmt->name);
+    write(stmt->initializer);
+    writeAnnotation(stmt->annotation);
+    return std::any();
+  }
+
+  std::any AstWriter::visitFunctionStmt(const Function *stmt)
+  {
+    writeTag(NodeTag::FUNCTION);
+    writeToken(stmt->name);
+    writeVarint(stmt->params.size());
+    for (const auto &param : stmt->params)
+    {
+      writeToken(param);
+    }
+    write(stmt->body);
+    writeVarint(stmt->paramTypes.size());
+    for (Annotation annotation : stmt->paramTypes)
+    {
+      writeAnnotation(annotation);
+    }
+    writeAnnotation(stmt->returnType);
+    return std::any();
+  }
+
+  std::any AstWriter::visitIfStmt(const If *stmt)
+  {
+    writeTag(NodeTag::IF);
+    write(stmt->condition);
+    write(stmt->thenBranch);
+    write(stmt->elseBranch);
+    return std::any();
+  }
+
+  std::any AstWriter::visitWhileStmt(const While *stmt)
+  {
+    writeTag(NodeTag::WHILE);
+    write(stmt->condition);
+    write(stmt->body);
+    return std::any();
+  }
+
+  // The cache stores the tree as the front end left it, before the optimizer
+  // runs, so the nodes only the optimizer builds never reach the writer.
+  static std::any optimizedNode(const char *name)
+  {
+    throw std::logic_error(std::string("Cannot cache an optimized ") + name + " node.");
+  }
+
+  std::any AstWriter::visitAssignOpExpr(const AssignOp *)
+  {
+    return optimizedNode("AssignOp");
+  }
+
+  std::any AstWriter::visitCompareVariableExpr(const CompareVariable *)
+  {
+    return optimizedNode("CompareVariable");
+  }
+
+  std::any AstWriter::visitSetFieldOpExpr(const SetFieldOp *)
+  {
+    return optimizedNode("SetFieldOp");
+  }
+
+  std::any AstWriter::visitInlinedCallExpr(const InlinedCall *)
+  {
+    return optimizedNode("InlinedCall");
+  }
+
+  std::any AstWriter::visitArgRefExpr(const ArgRef *)
+  {
+    return optimizedNode("ArgRef");
+  }
+
+  std::any AstWriter::visitConditionalExpr(const Conditional *)
+  {
+    return optimizedNode("Conditional");
+  }
+
+  std::any AstWriter::visitInvariantExpr(const Invariant *)
+  {
+    return optimizedNode("Invariant");
+  }
+
+  std::any AstWriter::visitInvariantLoopStmt(const InvariantLoop *)
+  {
+    return optimizedNode("InvariantLoop");
+  }
+
+  std::any AstWriter::visitForLoopStmt(const ForLoop *)
+  {
+    return optimizedNode("ForLoop");
+  }
+
+  std::any AstWriter::visitCountedLoopStmt(const CountedLoop *)
+  {
+    return optimizedNode("CountedLoop");
+  }
+
+  std::vector<StmtPtr> AstReader::readProgram(size_t sourceSize)
+  {
+    if (size < sizeof(MAGIC) || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    {
+      throw std::runtime_error("Not a cache file.");
+    }
+    pos = sizeof(MAGIC);
+    if (readVarint() != FORMAT_VERSION)
+    {
+      throw std::runtime_error("Cache format version mismatch.");
+    }
+    if (readVarint() != sourceSize)
+    {
+      throw std::runtime_error("Cache file belongs to a different source.");
+    }
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++)
+    {
+      checksum |= static_cast<uint64_t>(readByte()) << (8 * i);
+    }
+    if (AstCache::hash(data + pos, size - pos) != checksum)
+    {
+      throw std::runtime_error("Corrupt cache file.");
+    }
+    std::vector<StmtPtr> stmts = readStmts();
+    if (pos != size)
+    {
+      throw std::runtime_error("Trailing bytes in cache file.");
+    }
+
+    // Only hand depths to the interpreter once the whole tree is known good.
+    for (const auto &[expr, depth] : depths)
+    {
+      interpreter.resolve(expr, depth);
+    }
+    return stmts;
+  }
+
+  NodeTag AstReader::readTag()
+  {
+    return static_cast<NodeTag>(readByte());
+  }
+
+  uint8_t AstReader::readByte()
+  {
+    if (pos >= size)
+    {
+      throw std::runtime_error("Truncated cache file.");
+    }
+    return static_cast<uint8_t>(data[pos++]);
+  }
+
+  uint64_t AstReader::readVarint()
+  {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+      uint8_t byte = readByte();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+    throw std::runtime_error("Malformed varint in cache file.");
+  }
+
+  std::string AstReader::readString()
+  {
+    uint64_t length = readVarint();
+    if (length > size - pos)
+    {
+      throw std::runtime_error("Truncated cache file.");
+    }
+    std::string value(data + pos, length);
+    pos += length;
+    return value;
+  }
+
+  LiteralType AstReader::readLiteral()
+  {
+    uint64_t index = readVarint();
+    LiteralType value;
+    auto readRaw = [this](auto &arg)
+    {
+      if (sizeof(arg) > size - pos)
+      {
+        throw std::runtime_error("Truncated cache file.");
+      }
+      std::memcpy(&arg, data + pos, sizeof(arg));
+      pos += sizeof(arg);
+    };
+    switch (index)
+    {
+    case 0:
+      value = nullptr;
+      break;
+    case 1:
+    {
+      bool arg;
+      readRaw(arg);
+      value = arg;
+      break;
+    }
+    case 2:
+    {
+      int64_t arg;
+      readRaw(arg);
+      value = arg;
+      break;
+    }
+    case 3:
+    {
+      double arg;
+      readRaw(arg);
+      value = arg;
+      break;
+    }
+    case 4:
+      value = readString();
+      break;
+    default:
+      throw std::runtime_error("Unknown literal kind in cache file.");
+    }
+    return value;
+  }
+
+  Token AstReader::readToken()
+  {
+    uint64_t type = readVarint();
+    if (type >= TOKEN_TYPE_COUNT)
+    {
+      throw std::runtime_error("Unknown token type in cache file.");
+    }
+    int line = readVarint();
+    std::string lexeme = readString();
+    LiteralType literal = readLiteral();
+    return Token(static_cast<TokenType>(type), std::move(lexeme), std::move(literal), line);
+  }
+
+  Annotation AstReader::readAnnotation()
+  {
+    uint64_t annotation = readVarint();
+    if (annotation > static_cast<uint64_t>(Annotation::BOOL))
+    {
+      throw std::runtime_error("Unknown type annotation in cache file.");
+    }
+    return static_cast<Annotation>(annotation);
+  }
+
+  void AstReader::readDepth(const Expr *expr)
+  {
+    int depth = static_cast<int>(readVarint()) - 1;
+    if (depth > -1)
+    {
+      depths.emplace_back(expr, depth);
+    }
+  }
+
+  std::vector<StmtPtr> AstReader::readStmts()
+  {
+    uint64_t count = readVarint();
+    std::vector<StmtPtr> stmts;
+    for (uint64_t i = 0; i < count; i++)
+    {
+      stmts.push_back(readStmt());
+    }
+    return stmts;
+  }
+
+  ExprPtr AstReader::readExpr()
+  {
+    switch (readTag())
+    {
+    case NodeTag::NULL_NODE:
+      return nullptr;
+    case NodeTag::BINARY:
+    {
+      ExprPtr left = readExpr();
+      Token op = readToken();
+      ExprPtr right = readExpr();
+      return std::make_unique<Binary>(std::move(left), std::move(op), std::move(right));
+    }
+    case NodeTag::CALL:
+    {
+      ExprPtr callee = readExpr();
+      Token paren = readToken();
+      uint64_t count = readVarint();
+      std::vector<ExprPtr> arguments;
+      for (uint64_t i = 0; i < count; i++)
+      {
+        arguments.push_back(readExpr());
+      }
+      return std::make_unique<Call>(std::move(callee), std::move(paren), std::move(arguments));
+    }
+    case NodeTag::GET:
+    {
+      ExprPtr object = readExpr();
+      Token name = readToken();
+      return std::make_unique<Get>(std::move(object), std::move(name));
+    }
+    case NodeTag::SET:
+    {
+      ExprPtr object = readExpr();
+      Token name = readToken();
+      ExprPtr value = readExpr();
+      return std::make_unique<Set>(std::move(object), std::move(name), std::move(value));
+    }
+    case NodeTag::INDEX:
+    {
+      ExprPtr object = readExpr();
+      Token bracket = readToken();
+      ExprPtr index = readExpr();
+      return std::make_unique<Index>(std::move(object), std::move(bracket), std::move(index));
+    }
+    case NodeTag::SET_INDEX:
+    {
+      ExprPtr object = readExpr();
+      Token bracket = readToken();
+      ExprPtr index = readExpr();
+      ExprPtr value = readExpr();
+      return std::make_unique<SetIndex>(std::move(object), std::move(bracket), std::move(index), std::move(value));
+    }
+    case NodeTag::SLICE:
+    {
+      ExprPtr object = readExpr();
+      Token bracket = readToken();
+      ExprPtr start = readExpr();
+      ExprPtr end = readExpr();
+      return std::make_unique<Slice>(std::move(object), std::move(bracket), std::move(start), std::move(end));
+    }
+    case NodeTag::SUPER:
+    {
+      Token keyword = readToken();
+      Token method = readToken();
+      ExprPtr expr = std::make_unique<Super>(std::move(keyword), std::move(method));
+      readDepth(expr.get());
+      return expr;
+    }
+    case NodeTag::GROUPING:
+      return std::make_unique<Grouping>(readExpr());
+    case NodeTag::LITERAL:
+      return std::make_unique<Literal>(readLiteral());
+    case NodeTag::THIS:
+    {
+      ExprPtr expr = std::make_unique<This>(readToken());
+      readDepth(expr.get());
+      return expr;
+    }
+    case NodeTag::UNARY:
+    {
+      Token op = readToken();
+      ExprPtr right = readExpr();
+      return std::make_unique<Unary>(std::move(op), std::move(right));
+    }
+    case NodeTag::VARIABLE:
+    {
+      ExprPtr expr = std::make_unique<Variable>(readToken());
+      readDepth(expr.get());
+      return expr;
+    }
+    case NodeTag::ASSIGN:
+    {
+      Token name = readToken();
+      ExprPtr value = readExpr();
+      ExprPtr expr = std::make_unique<Assign>(std::move(name), std::move(value));
+      readDepth(expr.get());
+      return expr;
+    }
+    case NodeTag::LOGICAL:
+    {
+      ExprPtr left = readExpr();
+      Token op = readToken();
+      ExprPtr right = readExpr();
+      return std::make_unique<Logical>(std::move(left), std::move(op), std::move(right));
+    }
+    case NodeTag::INTERPOLATION:
+    {
+      Token quote = readToken();
+      uint64_t count = readVarint();
+      std::vector<ExprPtr> parts;
+      for (uint64_t i = 0; i < count; i++)
+      {
+        parts.push_back(readExpr());
+      }
+      return std::make_unique<Interpolation>(std::move(quote), std::move(parts));
+    }
+    default:
+      throw std::runtime_error("Unexpected expression tag in cache file.");
+    }
+  }
+
+  StmtPtr AstReader::readStmt()
+  {
+    switch (readTag())
+    {
+    case NodeTag::NULL_NODE:
+      return nullptr;
+    case NodeTag::BLOCK:
+      return std::make_unique<Block>(readStmts());
+    case NodeTag::CLASS:
+    {
+      Token name = readToken();
+      ExprPtr superclass = readExpr();
+      std::vector<StmtPtr> methods = readStmts();
+      return std::make_unique<Class>(std::move(name), std::move(superclass), std::move(methods));
+    }
+    case NodeTag::EXPRESSION:
+      return std::make_unique<Expression>(readExpr());
+    case NodeTag::PRINT:
+      return std::make_unique<Print>(readExpr());
+    case NodeTag::RETURN:
+    {
+      Token keyword = readToken();
+      ExprPtr value = readExpr();
+      return std::make_unique<Return>(std::move(keyword), std::move(value));
+    }
+    case NodeTag::VAR:
+    {
+      Token name = readToken();
+      ExprPtr initializer = readExpr();
+      Annotation annotation = readAnnotation();
+      return std::make_unique<Var>(std::move(name), std::move(initializer), annotation);
+    }
+    case NodeTag::FUNCTION:
+    {
+      Token name = readToken();
+      uint64_t count = readVarint();
+      std::vector<Token> params;
+      for (uint64_t i = 0; i < count; i++)
+      {
+        params.push_back(readToken());
+      }
+      std::vector<StmtPtr> body = readStmts();
+      uint64_t annotated = readVarint();
+      if (annotated != 0 && annotated != count)
+      {
+        throw std::runtime_error("Malformed parameter types in cache file.");
+      }
+      std::vector<Annotation> paramTypes;
+      for (uint64_t i = 0; i < annotated; i++)
+      {
+        paramTypes.push_back(readAnnotation());
+      }
+      Annotation returnType = readAnnotation();
+      return std::make_unique<Function>(std::move(name), std::move(params), std::move(body), std::move(paramTypes), returnType);
+    }
+    case NodeTag::IF:
+    {
+      ExprPtr condition = readExpr();
+      StmtPtr thenBranch = readStmt();
+      StmtPtr elseBranch = readStmt();
+      return std::make_unique<If>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    }
+    case NodeTag::WHILE:
+    {
+      ExprPtr condition = readExpr();
+      StmtPtr body = readStmt();
+      return std::make_unique<While>(std::move(condition), std::move(body));
+    }
+    default:
+      throw std::runtime_error("Unexpected statement tag in cache file.");
+    }
+  }
+}
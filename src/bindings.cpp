@@ -0,0 +1,449 @@
+#include "cpplox/bindings.h"
+
+namespace CppLox
+{
+  void BindingAnalysis::analyze(const std::vector<StmtPtr> &stmts)
+  {
+    for (const auto &stmt : stmts)
+    {
+      analyze(stmt);
+    }
+  }
+
+  void BindingAnalysis::analyze(const StmtPtr &stmt)
+  {
+    if (stmt != nullptr)
+    {
+      stmt->accept(*this);
+    }
+  }
+
+  void BindingAnalysis::analyze(const ExprPtr &expr)
+  {
+    if (expr != nullptr)
+    {
+      expr->accept(*this);
+    }
+  }
+
+  Binding *BindingAnalysis::bindingFor(const Expr *expr) const
+  {
+    auto it = references.find(expr);
+    return it != references.end() ? it->second : nullptr;
+  }
+
+  Binding *BindingAnalysis::bindingFor(const Stmt *declaration) const
+  {
+    auto it = declarations.find(declaration);
+    return it != declarations.end() ? it->second : nullptr;
+  }
+
+  Binding *BindingAnalysis::bindingFor(const Token *param) const
+  {
+    auto it = params.find(param);
+    return it != params.end() ? it->second : nullptr;
+  }
+
+  const Function *BindingAnalysis::currentFunction() const
+  {
+    return functions.empty() ? nullptr : functions.back();
+  }
+
+  Binding *BindingAnalysis::declare(const std::string &name, const Stmt *declaration)
+  {
+    Binding *binding;
+    if (scopes.empty())
+    {
+      auto it = globals.find(name);
+      if (it == globals.end())
+      {
+        bindings.push_back(std::make_unique<Binding>());
+        binding = bindings.back().get();
+        binding->name = name;
+        binding->global = true;
+        globals[name] = binding;
+      }
+      else
+      {
+        binding = it->second;
+      }
+      // Top-level redeclarations rebind the same global name.
+      if (binding->declaration == nullptr)
+      {
+        binding->declaration = declaration;
+      }
+    }
+    else
+    {
+      bindings.push_back(std::make_unique<Binding>());
+      binding = bindings.back().get();
+      binding->name = name;
+      binding->declaration = declaration;
+      binding->function = currentFunction();
+      scopes.back()[name] = binding;
+    }
+    binding->declarations++;
+    return binding;
+  }
+
+  Binding *BindingAnalysis::lookup(const Expr *expr, const std::string &name)
+  {
+    return lookup(expr, name, interpreter.resolvedDepth(expr));
+  }
+
+  Binding *BindingAnalysis::lookup(const Expr *expr, const std::string &name, int depth)
+  {
+    Binding *binding = nullptr;
+    if (depth > -1)
+    {
+      int index = static_cast<int>(scopes.size()) - 1 - depth;
+      if (index >= 0)
+      {
+        auto it = scopes[index].find(name);
+        if (it != scopes[index].end())
+        {
+          binding = it->second;
+        }
+      }
+    }
+    else
+    {
+      auto it = globals.find(name);
+      if (it == globals.end())
+      {
+        // Natives and globals declared later in the script.
+        bindings.push_back(std::make_unique<Binding>());
+        binding = bindings.back().get();
+        binding->name = name;
+        binding->global = true;
+        globals[name] = binding;
+      }
+      else
+      {
+        binding = it->second;
+      }
+    }
+
+    if (binding != nullptr)
+    {
+      references[expr] = binding;
+      if (!binding->global && binding->function != currentFunction())
+      {
+        binding->captured = true;
+      }
+    }
+    return binding;
+  }
+
+  std::any BindingAnalysis::visitBlockStmt(const Block *stmt)
+  {
+    scopes.push_back(BindingScope());
+    analyze(stmt->statements);
+    scopes.pop_back();
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitClassStmt(const Class *stmt)
+  {
+    declarations[stmt] = declare(stmt->name.lexeme, stmt);
+    analyze(stmt->superclass);
+    if (stmt->superclass != nullptr)
+    {
+      scopes.push_back(BindingScope());
+      declare("super", stmt);
+    }
+    scopes.push_back(BindingScope());
+    declare("this", stmt);
+    for (const auto &method : stmt->methods)
+    {
+      analyzeFunction(dynamic_cast<const Function *>(method.get()));
+    }
+    scopes.pop_back();
+    if (stmt->superclass != nullptr)
+    {
+      scopes.pop_back();
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitFunctionStmt(const Function *stmt)
+  {
+    declarations[stmt] = declare(stmt->name.lexeme, stmt);
+    analyzeFunction(stmt);
+    return std::any();
+  }
+
+  void BindingAnalysis::analyzeFunction(const Function *stmt)
+  {
+    functions.push_back(stmt);
+    scopes.push_back(BindingScope());
+    for (const auto &param : stmt->params)
+    {
+      params[&param] = declare(param.lexeme, stmt);
+    }
+    analyze(stmt->body);
+    scopes.pop_back();
+    functions.pop_back();
+  }
+
+  std::any BindingAnalysis::visitVarStmt(const Var *stmt)
+  {
+    analyze(stmt->initializer);
+    declarations[stmt] = declare(stmt->name.lexeme, stmt);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitVariableExpr(const Variable *expr)
+  {
+    Binding *binding = lookup(expr, expr->name.lexeme);
+    if (binding != nullptr)
+    {
+      binding->reads++;
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitAssignExpr(const Assign *expr)
+  {
+    analyze(expr->value);
+    Binding *binding = lookup(expr, expr->name.lexeme);
+    if (binding != nullptr)
+    {
+      binding->assignments++;
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitThisExpr(const This *expr)
+  {
+    Binding *binding = lookup(expr, expr->keyword.lexeme);
+    if (binding != nullptr)
+    {
+      binding->reads++;
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitSuperExpr(const Super *expr)
+  {
+    Binding *binding = lookup(expr, expr->keyword.lexeme);
+    if (binding != nullptr)
+    {
+      binding->reads++;
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitAssignOpExpr(const AssignOp *expr)
+  {
+    analyze(expr->value);
+    Binding *binding = lookup(expr, expr->name.lexeme, expr->depth);
+    if (binding != nullptr)
+    {
+      binding->reads++;
+      binding->assignments++;
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    Binding *binding = lookup(expr, expr->name.lexeme, expr->depth);
+    if (binding != nullptr)
+    {
+      binding->reads++;
+    }
+    analyze(expr->right);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitExpressionStmt(const Expression *stmt)
+  {
+    analyze(stmt->expression);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitPrintStmt(const Print *stmt)
+  {
+    analyze(stmt->expression);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitReturnStmt(const Return *stmt)
+  {
+    analyze(stmt->value);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitIfStmt(const If *stmt)
+  {
+    analyze(stmt->condition);
+    analyze(stmt->thenBranch);
+    analyze(stmt->elseBranch);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitWhileStmt(const While *stmt)
+  {
+    analyze(stmt->condition);
+    analyze(stmt->body);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitForLoopStmt(const ForLoop *stmt)
+  {
+    analyze(stmt->condition);
+    scopes.push_back(BindingScope());
+    analyze(stmt->body);
+    analyze(stmt->increment);
+    scopes.pop_back();
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    scopes.push_back(BindingScope());
+    analyze(stmt->start);
+    Binding *counter = declare(stmt->name.lexeme, stmt);
+    declarations[stmt] = counter;
+    // The bound check and the step.
+    counter->reads += 2;
+    counter->assignments++;
+    analyze(stmt->limit);
+    scopes.push_back(BindingScope());
+    analyze(stmt->body);
+    scopes.pop_back();
+    scopes.pop_back();
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    analyze(stmt->loop);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitInvariantExpr(const Invariant *expr)
+  {
+    analyze(expr->expression);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitBinaryExpr(const Binary *expr)
+  {
+    analyze(expr->left);
+    analyze(expr->right);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitCallExpr(const Call *expr)
+  {
+    analyze(expr->callee);
+    for (const auto &argument : expr->arguments)
+    {
+      analyze(argument);
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitGetExpr(const Get *expr)
+  {
+    analyze(expr->object);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitSetExpr(const Set *expr)
+  {
+    analyze(expr->value);
+    analyze(expr->object);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitIndexExpr(const Index *expr)
+  {
+    analyze(expr->object);
+    analyze(expr->index);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitSetIndexExpr(const SetIndex *expr)
+  {
+    analyze(expr->value);
+    analyze(expr->object);
+    analyze(expr->index);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitSliceExpr(const Slice *expr)
+  {
+    analyze(expr->object);
+    analyze(expr->start);
+    analyze(expr->end);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    analyze(expr->value);
+    analyze(expr->object);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    analyze(expr->callee);
+    for (const auto &argument : expr->arguments)
+    {
+      analyze(argument);
+    }
+    // Only globals and arguments are left in an inlined body.
+    analyze(expr->body);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitArgRefExpr(const ArgRef *expr)
+  {
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitConditionalExpr(const Conditional *expr)
+  {
+    analyze(expr->condition);
+    analyze(expr->thenBranch);
+    analyze(expr->elseBranch);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitGroupingExpr(const Grouping *expr)
+  {
+    analyze(expr->expression);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitLiteralExpr(const Literal *expr)
+  {
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitLogicalExpr(const Logical *expr)
+  {
+    analyze(expr->left);
+    analyze(expr->right);
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitInterpolationExpr(const Interpolation *expr)
+  {
+    for (const auto &part : expr->parts)
+    {
+      analyze(part);
+    }
+    return std::any();
+  }
+
+  std::any BindingAnalysis::visitUnaryExpr(const Unary *expr)
+  {
+    analyze(expr->right);
+    return std::any();
+  }
+}
@@ -0,0 +1,733 @@
+#include <cstdio>
+
+#include "cpplox/cemitter.h"
+#include "cpplox/number.h"
+
+namespace CppLox
+{
+  // Whether a scope holding these statements can be captured: only a
+  // nested function or class can outlive it and read its variables.
+  static bool declaresFunction(const Stmt *stmt)
+  {
+    if (dynamic_cast<const Function *>(stmt) != nullptr || dynamic_cast<const Class *>(stmt) != nullptr)
+      return true;
+    if (auto *block = dynamic_cast<const Block *>(stmt))
+    {
+      for (const auto &inner : block->statements)
+      {
+        if (declaresFunction(inner.get()))
+          return true;
+      }
+    }
+    if (auto *ifStmt = dynamic_cast<const If *>(stmt))
+      return declaresFunction(ifStmt->thenBranch.get()) ||
+             (ifStmt->elseBranch != nullptr && declaresFunction(ifStmt->elseBranch.get()));
+    if (auto *whileStmt = dynamic_cast<const While *>(stmt))
+      return declaresFunction(whileStmt->body.get());
+    return false;
+  }
+
+  static bool declaresFunction(const std::vector<StmtPtr> &stmts)
+  {
+    for (const auto &stmt : stmts)
+    {
+      if (declaresFunction(stmt.get()))
+        return true;
+    }
+    return false;
+  }
+
+  static const char *valueType(Annotation annotation)
+  {
+    switch (annotation)
+    {
+    case Annotation::NUM:
+      return "V_NUMBER";
+    case Annotation::STR:
+      return "V_STRING";
+    case Annotation::BOOL:
+      return "V_BOOL";
+    default:
+      return "V_UNDEFINED";
+    }
+  }
+
+  static int countDeclarations(const std::vector<StmtPtr> &stmts)
+  {
+    int count = 0;
+    for (const auto &stmt : stmts)
+    {
+      if (dynamic_cast<const Var *>(stmt.get()) != nullptr || dynamic_cast<const Function *>(stmt.get()) != nullptr ||
+          dynamic_cast<const Class *>(stmt.get()) != nullptr)
+        count++;
+    }
+    return count;
+  }
+
+  bool CEmitter::emit(const std::vector<StmtPtr> &stmts, std::ostream &out)
+  {
+    symbol("init");
+    symbol("clock");
+    for (const auto &stmt : stmts)
+    {
+      if (auto *var = dynamic_cast<const Var *>(stmt.get()))
+        scriptGlobals.insert(var->name.lexeme);
+      else if (auto *function = dynamic_cast<const Function *>(stmt.get()))
+        scriptGlobals.insert(function->name.lexeme);
+      else if (auto *klass = dynamic_cast<const Class *>(stmt.get()))
+        scriptGlobals.insert(klass->name.lexeme);
+    }
+    frames.push_back(std::make_unique<Frame>());
+    frames.back()->indent = 2;
+    for (const auto &stmt : stmts)
+    {
+      statement(*stmt);
+    }
+    if (!supported)
+      return false;
+
+    out << "/* Generated by cpplox --emit-c. */\n";
+    out << "#define RT_SYMBOL_COUNT " << symbolNames.size() << "\n";
+    out << "#define RT_SYMBOL_INIT 0\n";
+    out << "#define RT_SYMBOL_CLOCK 1\n";
+    out << "static const char *const rt_symbols[] = {";
+    for (size_t i = 0; i < symbolNames.size(); i++)
+    {
+      out << (i == 0 ? "" : ", ") << literalString(symbolNames[i]);
+    }
+    out << "};\n";
+    out << C_RUNTIME << "\n";
+    out << "static LoxString *rt_strings[" << std::max<size_t>(strings.size(), 1) << "];\n\n";
+    out << prototypes.str() << "\n";
+    out << functions.str();
+    out << "int main(void)\n{\n";
+    out << "  rt_init();\n";
+    for (size_t i = 0; i < strings.size(); i++)
+    {
+      out << "  rt_strings[" << i << "] = rt_new_string(" << literalString(strings[i]) << ", " << strings[i].size() << ");\n";
+    }
+    out << "  Env *env = NULL;\n";
+    out << "  Handler top;\n";
+    out << "  top.prev = NULL;\n";
+    out << "  rt_handler = &top;\n";
+    out << "  if (!setjmp(top.buf))\n  {\n";
+    out << frames.back()->body.str();
+    out << "  }\n";
+    out << "  (void)env;\n";
+    out << "  return 0;\n}\n";
+    return true;
+  }
+
+  std::string CEmitter::expression(const Expr &expr)
+  {
+    return std::any_cast<std::string>(expr.accept(*this));
+  }
+
+  void CEmitter::statement(const Stmt &stmt)
+  {
+    stmt.accept(*this);
+  }
+
+  void CEmitter::line(const std::string &code)
+  {
+    Frame &frame = *frames.back();
+    frame.body << std::string(frame.indent * 2, ' ') << code << "\n";
+  }
+
+  std::string CEmitter::temporary()
+  {
+    return "t" + std::to_string(temporaries++);
+  }
+
+  int CEmitter::symbol(const std::string &name)
+  {
+    auto it = symbols.find(name);
+    if (it != symbols.end())
+      return it->second;
+    symbolNames.push_back(name);
+    return symbols[name] = static_cast<int>(symbolNames.size()) - 1;
+  }
+
+  // A C string literal; octal escapes cannot swallow following digits the
+  // way hex escapes do.
+  std::string CEmitter::literalString(const std::string &value) const
+  {
+    std::string out = "\"";
+    for (unsigned char c : value)
+    {
+      if (c == '"' || c == '\\')
+      {
+        out += '\\';
+        out += static_cast<char>(c);
+      }
+      else if (c < 0x20 || c >= 0x7F || c == '?')
+      {
+        char escaped[5];
+        std::snprintf(escaped, sizeof escaped, "\\%03o", c);
+        out += escaped;
+      }
+      else
+      {
+        out += static_cast<char>(c);
+      }
+    }
+    return out + "\"";
+  }
+  // Wraps a value stored under an annotation in the check the interpreter
+  // makes there.
+  std::string CEmitter::expect(const std::string &value, Annotation annotation, const std::string &what, const Token &name) const
+  {
+    if (annotation == Annotation::NONE)
+      return value;
+    std::string message = std::string("Expected a ") + annotationName(annotation) + " " + what + " for '" + name.lexeme + "'.";
+    return "rt_expect(" + value + ", " + valueType(annotation) + ", " + literalString(message) + ", " + std::to_string(name.line) + ")";
+  }
+
+
+  // A global the script does not declare that names a native function.
+  bool CEmitter::native(const std::string &name) const
+  {
+    if (scriptGlobals.count(name) != 0)
+      return false;
+    return isStringLibraryFunction(name) || isArrayLibraryFunction(name) || isListLibraryFunction(name) ||
+           isMapLibraryFunction(name) || isPersistentLibraryFunction(name);
+  }
+
+  std::any CEmitter::unsupported()
+  {
+    supported = false;
+    return std::any(std::string("rt_nil()"));
+  }
+
+  void CEmitter::beginScope(bool heap, int slots)
+  {
+    scopes.push_back(Scope{heap});
+    if (heap)
+    {
+      line("env = rt_env_new(env, " + std::to_string(slots) + ");");
+    }
+  }
+
+  // Names a new variable in the innermost scope and returns its storage.
+  std::string CEmitter::declare(const std::string &name)
+  {
+    Scope &scope = scopes.back();
+    std::string storage = scope.heap ? "slots[" + std::to_string(scope.slots++) + "]" : "v" + std::to_string(temporaries++);
+    scope.names[name] = storage;
+    return storage;
+  }
+
+  void CEmitter::define(const std::string &name, const std::string &value, Annotation annotation)
+  {
+    if (scopes.empty())
+    {
+      line("rt_global_define(" + std::to_string(symbol(name)) + ", " + value + ", " + valueType(annotation) + ");");
+      return;
+    }
+    bool heap = scopes.back().heap;
+    std::string storage = declare(name);
+    line(heap ? "env->" + storage + " = " + value + ";" : "volatile Value " + storage + " = " + value + ";");
+  }
+
+  // The storage a resolved local refers to, or "" for a global.
+  std::string CEmitter::variable(const std::string &name, const Expr *expr)
+  {
+    int depth = interpreter->resolvedDepth(expr);
+    if (depth < 0)
+      return "";
+    int index = static_cast<int>(scopes.size()) - 1 - depth;
+    auto it = scopes[index].names.find(name);
+    if (it == scopes[index].names.end())
+    {
+      supported = false;
+      return "rt_nil()";
+    }
+    if (!scopes[index].heap)
+      return it->second;
+
+    std::string env = "env";
+    for (size_t i = index + 1; i < scopes.size(); i++)
+    {
+      if (scopes[i].heap)
+        env += "->enclosing";
+    }
+    return env + "->" + it->second;
+  }
+
+  std::string CEmitter::binary(const std::string &function, const Expr &left, const Expr &right, int line)
+  {
+    std::string l = temporary();
+    std::string r = temporary();
+    std::string call = function == "rt_equal" || function == "!rt_equal"
+                           ? "rt_bool(" + function + "(" + l + ", " + r + "))"
+                           : function + "(" + l + ", " + r + ", " + std::to_string(line) + ")";
+    return "({ Value " + l + " = " + expression(left) + "; Value " + r + " = " + expression(right) + "; " + call + "; })";
+  }
+
+  std::string CEmitter::call(const char *function, const Expr &callee, const std::vector<ExprPtr> &arguments, int line)
+  {
+    std::string c = temporary();
+    std::string code = "({ Value " + c + " = " + expression(callee) + "; ";
+    std::string args = "NULL";
+    if (!arguments.empty())
+    {
+      args = temporary();
+      code += "Value " + args + "[" + std::to_string(arguments.size()) + "]; ";
+      for (size_t i = 0; i < arguments.size(); i++)
+      {
+        code += args + "[" + std::to_string(i) + "] = " + expression(*arguments[i]) + "; ";
+      }
+    }
+    return code + function + "(" + c + ", " + std::to_string(arguments.size()) + ", " + args + ", " + std::to_string(line) + "); })";
+  }
+
+  // Writes the C function for a Lox function and returns the expression
+  // that makes its closure over the current environment.
+  std::string CEmitter::function(const Function *stmt, bool initializer)
+  {
+    std::string name = "fn" + std::to_string(functionCount++) + "_" + stmt->name.lexeme;
+    prototypes << "static Value " << name << "(Closure *self, Value *args);\n";
+    prototypes << "static const Proto " << name << "_proto = {" << stmt->params.size() << ", " << name << ", "
+               << valueType(stmt->returnType) << ", " << literalString(stmt->name.lexeme) << ", " << stmt->name.line << "};\n";
+
+    frames.push_back(std::make_unique<Frame>());
+    frames.back()->initializer = initializer;
+    line("Env *env = self->env;");
+    line("Handler *outer = rt_handler;");
+    line("(void)args;");
+    beginScope(declaresFunction(stmt->body), static_cast<int>(stmt->params.size()) + countDeclarations(stmt->body));
+    // Before the handler: a bad argument is the caller's error.
+    for (size_t i = 0; i < stmt->params.size(); i++)
+    {
+      std::string argument = "args[" + std::to_string(i) + "]";
+      if (i < stmt->paramTypes.size())
+        argument = expect(argument, stmt->paramTypes[i], "argument", stmt->params[i]);
+      define(stmt->params[i].lexeme, argument);
+    }
+    line("Handler h;");
+    line("h.prev = outer;");
+    line("rt_handler = &h;");
+    line("if (!setjmp(h.buf))");
+    line("{");
+    frames.back()->indent++;
+    for (const auto &inner : stmt->body)
+    {
+      statement(*inner);
+    }
+    frames.back()->indent--;
+    line("}");
+    line("rt_handler = outer;");
+    line("(void)env;");
+    line(initializer ? "return self->env->slots[0];" : "return rt_empty();");
+    scopes.pop_back();
+
+    functions << "static Value " << name << "(Closure *self, Value *args)\n{\n"
+              << frames.back()->body.str() << "}\n\n";
+    frames.pop_back();
+    return "rt_function(&" + name + "_proto, env, " + (initializer ? "1" : "0") + ")";
+  }
+
+  std::any CEmitter::visitBlockStmt(const Block *stmt)
+  {
+    bool heap = declaresFunction(stmt->statements);
+    std::string handler = temporary();
+    std::string saved = temporary();
+    line("{");
+    frames.back()->indent++;
+    line("Handler " + handler + ";");
+    line(handler + ".prev = rt_handler;");
+    line("rt_handler = &" + handler + ";");
+    if (heap)
+    {
+      line("Env *" + saved + " = env;");
+    }
+    line("if (!setjmp(" + handler + ".buf))");
+    line("{");
+    frames.back()->indent++;
+    beginScope(heap, countDeclarations(stmt->statements));
+    for (const auto &inner : stmt->statements)
+    {
+      statement(*inner);
+    }
+    scopes.pop_back();
+    frames.back()->indent--;
+    line("}");
+    line("rt_handler = " + handler + ".prev;");
+    if (heap)
+    {
+      line("env = " + saved + ";");
+    }
+    frames.back()->indent--;
+    line("}");
+    return std::any();
+  }
+
+  std::any CEmitter::visitClassStmt(const Class *stmt)
+  {
+    std::string superclass = "rt_nil()";
+    if (stmt->superclass != nullptr)
+    {
+      superclass = temporary();
+      auto *name = dynamic_cast<const Variable *>(stmt->superclass.get());
+      line("Value " + superclass + " = " + expression(*stmt->superclass) + ";");
+      line("if (" + superclass + ".type != V_CLASS)");
+      line("  rt_error(" + std::to_string(name->name.line) + ", \"Superclass must be a class.\");");
+    }
+
+    define(stmt->name.lexeme, "rt_empty()");
+
+    if (stmt->superclass != nullptr)
+    {
+      line("env = rt_env_new(env, 1);");
+      line("env->slots[0] = " + superclass + ";");
+      scopes.push_back(Scope{true});
+      declare("super");
+    }
+
+    std::string klass = temporary();
+    line("Class *" + klass + " = rt_class(" + literalString(stmt->name.lexeme) + ", " + superclass + ");");
+    // Bound methods add the environment holding "this".
+    scopes.push_back(Scope{true});
+    declare("this");
+    for (const auto &method : stmt->methods)
+    {
+      auto *function = dynamic_cast<const Function *>(method.get());
+      std::string closure = this->function(function, function->name.lexeme == "init");
+      line("rt_table_set(&" + klass + "->methods, " + std::to_string(symbol(function->name.lexeme)) + ", " + closure + ");");
+    }
+    scopes.pop_back();
+
+    if (stmt->superclass != nullptr)
+    {
+      scopes.pop_back();
+      line("env = env->enclosing;");
+    }
+
+    std::string value = "rt_class_value(" + klass + ")";
+    if (scopes.empty())
+    {
+      line("rt_global_define(" + std::to_string(symbol(stmt->name.lexeme)) + ", " + value + ", V_UNDEFINED);");
+    }
+    else
+    {
+      const Scope &scope = scopes.back();
+      std::string storage = scope.names.at(stmt->name.lexeme);
+      line((scope.heap ? "env->" + storage : storage) + " = " + value + ";");
+    }
+    return std::any();
+  }
+
+  std::any CEmitter::visitFunctionStmt(const Function *stmt)
+  {
+    define(stmt->name.lexeme, function(stmt, false));
+    return std::any();
+  }
+
+  std::any CEmitter::visitVarStmt(const Var *stmt)
+  {
+    std::string value = stmt->initializer != nullptr ? expression(*stmt->initializer) : "rt_empty()";
+    define(stmt->name.lexeme, expect(value, stmt->annotation, "value", stmt->name), stmt->annotation);
+    return std::any();
+  }
+
+  std::any CEmitter::visitExpressionStmt(const Expression *stmt)
+  {
+    line("(void)" + expression(*stmt->expression) + ";");
+    return std::any();
+  }
+
+  std::any CEmitter::visitPrintStmt(const Print *stmt)
+  {
+    line("rt_print(" + expression(*stmt->expression) + ");");
+    return std::any();
+  }
+
+  std::any CEmitter::visitReturnStmt(const Return *stmt)
+  {
+    std::string value;
+    if (frames.back()->initializer || stmt->value == nullptr)
+    {
+      value = frames.back()->initializer ? "self->env->slots[0]" : "rt_empty()";
+    }
+    else if (auto *tail = dynamic_cast<const Call *>(stmt->value.get()))
+    {
+      value = call("rt_tail_call", *tail->callee, tail->arguments, tail->paren.line);
+    }
+    else
+    {
+      value = expression(*stmt->value);
+    }
+    std::string result = temporary();
+    line("{");
+    line("  Value " + result + " = " + value + ";");
+    line("  rt_handler = outer;");
+    line("  return " + result + ";");
+    line("}");
+    return std::any();
+  }
+
+  std::any CEmitter::visitIfStmt(const If *stmt)
+  {
+    line("if (rt_truthy(" + expression(*stmt->condition) + "))");
+    line("{");
+    frames.back()->indent++;
+    statement(*stmt->thenBranch);
+    frames.back()->indent--;
+    line("}");
+    if (stmt->elseBranch != nullptr)
+    {
+      line("else");
+      line("{");
+      frames.back()->indent++;
+      statement(*stmt->elseBranch);
+      frames.back()->indent--;
+      line("}");
+    }
+    return std::any();
+  }
+
+  std::any CEmitter::visitWhileStmt(const While *stmt)
+  {
+    line("while (rt_truthy(" + expression(*stmt->condition) + "))");
+    line("{");
+    frames.back()->indent++;
+    statement(*stmt->body);
+    frames.back()->indent--;
+    line("}");
+    return std::any();
+  }
+
+  std::any CEmitter::visitBinaryExpr(const Binary *expr)
+  {
+    std::string function;
+    switch (expr->op.type)
+    {
+    case TokenType::PLUS:
+      function = "rt_add";
+      break;
+    case TokenType::MINUS:
+      function = "rt_subtract";
+      break;
+    case TokenType::STAR:
+      function = "rt_multiply";
+      break;
+    case TokenType::SLASH:
+      function = "rt_divide";
+      break;
+    case TokenType::GREATER:
+      function = "rt_greater";
+      break;
+    case TokenType::GREATER_EQUAL:
+      function = "rt_greater_equal";
+      break;
+    case TokenType::LESS:
+      function = "rt_less";
+      break;
+    case TokenType::LESS_EQUAL:
+      function = "rt_less_equal";
+      break;
+    case TokenType::EQUAL_EQUAL:
+      function = "rt_equal";
+      break;
+    case TokenType::BANG_EQUAL:
+      function = "!rt_equal";
+      break;
+    default:
+      return unsupported();
+    }
+    return std::any(binary(function, *expr->left, *expr->right, expr->op.line));
+  }
+
+  std::any CEmitter::visitGroupingExpr(const Grouping *expr)
+  {
+    return std::any(expression(*expr->expression));
+  }
+
+  std::any CEmitter::visitLiteralExpr(const Literal *expr)
+  {
+    if (std::holds_alternative<std::nullptr_t>(expr->value))
+      return std::any(std::string("rt_nil()"));
+    if (auto *boolean = std::get_if<bool>(&expr->value))
+      return std::any(std::string(*boolean ? "rt_bool(1)" : "rt_bool(0)"));
+    if (auto *integer = std::get_if<int64_t>(&expr->value))
+      return std::any("rt_integer(INT64_C(" + std::to_string(*integer) + "))");
+    if (isNumber(expr->value))
+    {
+      // Hex floats round-trip exactly.
+      char text[64];
+      std::snprintf(text, sizeof text, "%a", toDouble(expr->value));
+      return std::any("rt_number(" + std::string(text) + ")");
+    }
+    if (auto *string = std::get_if<std::string>(&expr->value))
+    {
+      size_t index = 0;
+      while (index < strings.size() && strings[index] != *string)
+        index++;
+      if (index == strings.size())
+        strings.push_back(*string);
+      return std::any("rt_string(rt_strings[" + std::to_string(index) + "])");
+    }
+    return unsupported();
+  }
+
+  std::any CEmitter::visitUnaryExpr(const Unary *expr)
+  {
+    std::string right = expression(*expr->right);
+    if (expr->op.type == TokenType::BANG)
+      return std::any("rt_bool(!rt_truthy(" + right + "))");
+    return std::any("rt_negate(" + right + ", " + std::to_string(expr->op.line) + ")");
+  }
+
+  std::any CEmitter::visitLogicalExpr(const Logical *expr)
+  {
+    std::string left = temporary();
+    std::string test = expr->op.type == TokenType::OR ? "rt_truthy(" + left + ")" : "!rt_truthy(" + left + ")";
+    return std::any("({ Value " + left + " = " + expression(*expr->left) + "; " + test + " ? " + left + " : " +
+                    expression(*expr->right) + "; })");
+  }
+
+  std::any CEmitter::visitInterpolationExpr(const Interpolation *expr)
+  {
+    std::string parts = temporary();
+    std::string code = "({ Value " + parts + "[" + std::to_string(expr->parts.size()) + "]; ";
+    for (size_t i = 0; i < expr->parts.size(); i++)
+    {
+      code += parts + "[" + std::to_string(i) + "] = " + expression(*expr->parts[i]) + "; ";
+    }
+    return std::any(code + "rt_interpolate(" + std::to_string(expr->parts.size()) + ", " + parts + "); })");
+  }
+
+  std::any CEmitter::visitVariableExpr(const Variable *expr)
+  {
+    std::string storage = variable(expr->name.lexeme, expr);
+    // The C runtime has no native libraries.
+    if (storage.empty() && native(expr->name.lexeme))
+      return unsupported();
+    if (storage.empty())
+      return std::any("rt_global_get(" + std::to_string(symbol(expr->name.lexeme)) + ", " + std::to_string(expr->name.line) + ")");
+    return std::any(storage);
+  }
+
+  std::any CEmitter::visitAssignExpr(const Assign *expr)
+  {
+    std::string value = expression(*expr->value);
+    std::string storage = variable(expr->name.lexeme, expr);
+    if (!storage.empty())
+      value = expect(value, expr->annotation, "value", expr->name);
+    if (storage.empty() && native(expr->name.lexeme))
+      return unsupported();
+    if (storage.empty())
+      return std::any("rt_global_assign(" + std::to_string(symbol(expr->name.lexeme)) + ", " + value + ", " + std::to_string(expr->name.line) + ")");
+    std::string result = temporary();
+    return std::any("({ Value " + result + " = " + value + "; " + storage + " = " + result + "; " + result + "; })");
+  }
+
+  std::any CEmitter::visitCallExpr(const Call *expr)
+  {
+    return std::any(call("rt_call", *expr->callee, expr->arguments, expr->paren.line));
+  }
+
+  std::any CEmitter::visitGetExpr(const Get *expr)
+  {
+    return std::any("rt_get(" + expression(*expr->object) + ", " + std::to_string(symbol(expr->name.lexeme)) + ", " +
+                    std::to_string(expr->name.line) + ")");
+  }
+
+  std::any CEmitter::visitSetExpr(const Set *expr)
+  {
+    std::string object = temporary();
+    std::string value = temporary();
+    return std::any("({ Value " + object + " = " + expression(*expr->object) + "; rt_check_fields(" + object + ", " +
+                    std::to_string(expr->name.line) + "); Value " + value + " = " + expression(*expr->value) + "; rt_set(" +
+                    object + ", " + std::to_string(symbol(expr->name.lexeme)) + ", " + value + "); })");
+  }
+
+  std::any CEmitter::visitIndexExpr(const Index *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitSetIndexExpr(const SetIndex *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitSliceExpr(const Slice *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitThisExpr(const This *expr)
+  {
+    return std::any(variable("this", expr));
+  }
+
+  std::any CEmitter::visitSuperExpr(const Super *expr)
+  {
+    int depth = interpreter->resolvedDepth(expr);
+    int index = static_cast<int>(scopes.size()) - 1 - depth;
+    std::string env = "env";
+    for (size_t i = index + 1; i < scopes.size(); i++)
+    {
+      if (scopes[i].heap)
+        env += "->enclosing";
+    }
+    // "this" lives in the scope just inside "super".
+    return std::any("rt_super(" + env + "->slots[0], " + env.substr(0, env.size() - std::string("->enclosing").size()) +
+                    "->slots[0], " + std::to_string(symbol(expr->method.lexeme)) + ", " + std::to_string(expr->method.line) + ")");
+  }
+
+  // The optimizer's nodes: --emit-c translates the tree before optimizing.
+  std::any CEmitter::visitAssignOpExpr(const AssignOp *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitArgRefExpr(const ArgRef *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitConditionalExpr(const Conditional *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitInvariantExpr(const Invariant *expr)
+  {
+    return unsupported();
+  }
+
+  std::any CEmitter::visitForLoopStmt(const ForLoop *stmt)
+  {
+    unsupported();
+    return std::any();
+  }
+
+  std::any CEmitter::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    unsupported();
+    return std::any();
+  }
+
+  std::any CEmitter::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    unsupported();
+    return std::any();
+  }
+}
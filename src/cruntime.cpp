@@ -0,0 +1,805 @@
+#include "cpplox/cemitter.h"
+
+namespace CppLox
+{
+  // The runtime every emitted program starts with, after its symbol table.
+  // It mirrors the interpreter: values, strings, environments, closures,
+  // classes and instances, the same error messages, and errors that unwind
+  // to the innermost block and are reported there. Memory is never freed.
+  const char *const C_RUNTIME = R"RUNTIME(
+#include <setjmp.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+typedef enum
+{
+  V_UNDEFINED,
+  V_EMPTY,
+  V_NIL,
+  V_BOOL,
+  V_NUMBER,
+  V_STRING,
+  V_FUNCTION,
+  V_NATIVE,
+  V_CLASS,
+  V_INSTANCE,
+  V_TAIL
+} VType;
+
+typedef struct LoxString LoxString;
+typedef struct Env Env;
+typedef struct Closure Closure;
+typedef struct Class Class;
+typedef struct Instance Instance;
+
+/* A number is, as in the interpreter, an int64 or a double; isInteger
+   tells which. */
+typedef struct
+{
+  VType type;
+  int isInteger;
+  union
+  {
+    int boolean;
+    int64_t integer;
+    double number;
+    LoxString *string;
+    Closure *closure;
+    Class *klass;
+    Instance *instance;
+  } as;
+} Value;
+
+struct LoxString
+{
+  size_t length;
+  char chars[];
+};
+
+struct Env
+{
+  Env *enclosing;
+  Value slots[];
+};
+
+typedef Value (*LoxFn)(Closure *self, Value *args);
+
+typedef struct
+{
+  int arity;
+  LoxFn fn;
+  /* The declared return type, V_UNDEFINED if none. */
+  VType returnType;
+  const char *name;
+  int line;
+} Proto;
+
+struct Closure
+{
+  const Proto *proto;
+  Env *env;
+  int isInitializer;
+};
+
+typedef struct
+{
+  int key;
+  Value value;
+} Entry;
+
+typedef struct
+{
+  int count;
+  int capacity;
+  Entry *entries;
+} Table;
+
+struct Class
+{
+  const char *name;
+  Class *superclass;
+  Table methods;
+};
+
+struct Instance
+{
+  Class *klass;
+  Table fields;
+};
+
+typedef struct Handler
+{
+  jmp_buf buf;
+  struct Handler *prev;
+} Handler;
+
+static Handler *rt_handler;
+static Value rt_globals[RT_SYMBOL_COUNT];
+/* Declared types of annotated globals, V_UNDEFINED for the others. */
+static VType rt_global_types[RT_SYMBOL_COUNT];
+static Closure *rt_tail_closure;
+static Value rt_tail_args[256];
+
+static void rt_error(int line, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  fputs("Runtime error: ", stdout);
+  vprintf(format, args);
+  printf("[line %d]\n", line);
+  va_end(args);
+  longjmp(rt_handler->buf, 1);
+}
+
+static void *rt_alloc(size_t size)
+{
+  void *memory = calloc(1, size);
+  if (memory == NULL)
+  {
+    fputs("Out of memory.\n", stderr);
+    exit(70);
+  }
+  return memory;
+}
+
+static inline Value rt_empty(void)
+{
+  Value value;
+  value.type = V_EMPTY;
+  return value;
+}
+
+static inline Value rt_nil(void)
+{
+  Value value;
+  value.type = V_NIL;
+  return value;
+}
+
+static inline Value rt_bool(int boolean)
+{
+  Value value;
+  value.type = V_BOOL;
+  value.as.boolean = boolean;
+  return value;
+}
+
+static inline Value rt_number(double number)
+{
+  Value value;
+  value.type = V_NUMBER;
+  value.isInteger = 0;
+  value.as.number = number;
+  return value;
+}
+
+static inline Value rt_integer(int64_t integer)
+{
+  Value value;
+  value.type = V_NUMBER;
+  value.isInteger = 1;
+  value.as.integer = integer;
+  return value;
+}
+
+static inline double rt_to_double(Value number)
+{
+  return number.isInteger ? (double)number.as.integer : number.as.number;
+}
+
+static Value rt_string(LoxString *string)
+{
+  Value value;
+  value.type = V_STRING;
+  value.as.string = string;
+  return value;
+}
+
+static LoxString *rt_new_string(const char *chars, size_t length)
+{
+  LoxString *string = rt_alloc(sizeof(LoxString) + length + 1);
+  string->length = length;
+  memcpy(string->chars, chars, length);
+  return string;
+}
+
+/* formatNumber in the interpreter: the fewest significant digits that read
+   back as the same double, laid out the same way. */
+static int rt_format_number(double value, char *buffer)
+{
+  if (isnan(value))
+    return sprintf(buffer, "nan");
+  if (isinf(value))
+    return sprintf(buffer, value > 0 ? "inf" : "-inf");
+
+  char scientific[32];
+  for (int precision = 0; precision < 17; precision++)
+  {
+    snprintf(scientific, sizeof scientific, "%.*e", precision, value);
+    if (strtod(scientific, NULL) == value)
+      break;
+  }
+  char *at = buffer;
+  const char *digits = scientific;
+  if (*digits == '-')
+    *at++ = *digits++;
+  const char *mark = strchr(digits, 'e');
+  int exponent = atoi(mark + 1);
+  char significand[32];
+  int count = 0;
+  for (const char *digit = digits; digit < mark; digit++)
+  {
+    if (*digit != '.')
+      significand[count++] = *digit;
+  }
+  /* %e keeps zeros the shortest form drops. */
+  while (count > 1 && significand[count - 1] == '0')
+    count--;
+
+  if (exponent < -6 || exponent > 20)
+  {
+    *at++ = significand[0];
+    if (count > 1)
+    {
+      *at++ = '.';
+      memcpy(at, significand + 1, (size_t)count - 1);
+      at += count - 1;
+    }
+    at += sprintf(at, "e%c%d", exponent < 0 ? '-' : '+', abs(exponent));
+  }
+  else if (exponent < 0)
+  {
+    *at++ = '0';
+    *at++ = '.';
+    for (int i = -1; i > exponent; i--)
+      *at++ = '0';
+    memcpy(at, significand, (size_t)count);
+    at += count;
+  }
+  else
+  {
+    int whole = exponent + 1;
+    for (int i = 0; i < whole; i++)
+      *at++ = i < count ? significand[i] : '0';
+    if (count > whole)
+    {
+      *at++ = '.';
+      memcpy(at, significand + whole, (size_t)(count - whole));
+      at += count - whole;
+    }
+  }
+  *at = '\0';
+  return (int)(at - buffer);
+}
+
+static int rt_format(Value number, char *buffer)
+{
+  if (number.isInteger)
+    return sprintf(buffer, "%lld", (long long)number.as.integer);
+  return rt_format_number(number.as.number, buffer);
+}
+
+/* The text print shows for a value. */
+static LoxString *rt_to_string(Value value)
+{
+  char number[32];
+  switch (value.type)
+  {
+  case V_NIL:
+    return rt_new_string("nil", 3);
+  case V_BOOL:
+    return value.as.boolean ? rt_new_string("true", 4) : rt_new_string("false", 5);
+  case V_NUMBER:
+    return rt_new_string(number, (size_t)rt_format(value, number));
+  case V_STRING:
+    return value.as.string;
+  case V_CLASS:
+    return rt_new_string(value.as.klass->name, strlen(value.as.klass->name));
+  case V_INSTANCE:
+  {
+    const char *name = value.as.instance->klass->name;
+    LoxString *string = rt_alloc(sizeof(LoxString) + strlen(name) + sizeof " instance");
+    string->length = (size_t)sprintf(string->chars, "%s instance", name);
+    return string;
+  }
+  default:
+    return rt_new_string("Unknown type", 12);
+  }
+}
+
+/* Sizes the result once and copies every part into it. */
+static Value rt_interpolate(int count, Value *parts)
+{
+  size_t length = 0;
+  for (int i = 0; i < count; i++)
+  {
+    parts[i] = rt_string(rt_to_string(parts[i]));
+    length += parts[i].as.string->length;
+  }
+  LoxString *result = rt_alloc(sizeof(LoxString) + length + 1);
+  result->length = length;
+  char *at = result->chars;
+  for (int i = 0; i < count; i++)
+  {
+    memcpy(at, parts[i].as.string->chars, parts[i].as.string->length);
+    at += parts[i].as.string->length;
+  }
+  return rt_string(result);
+}
+
+static inline int rt_truthy(Value value)
+{
+  if (value.type == V_NIL)
+    return 0;
+  if (value.type == V_BOOL)
+    return value.as.boolean;
+  return 1;
+}
+
+/* sameNumber in the interpreter: an integer and a double are equal only
+   when the double is exactly that integer. */
+static int rt_same_number(int64_t integer, double number)
+{
+  return number >= -0x1p63 && number < 0x1p63 && (int64_t)number == integer && (double)(int64_t)number == number;
+}
+
+static int rt_equal(Value a, Value b)
+{
+  if (a.type != b.type)
+    return 0;
+  switch (a.type)
+  {
+  case V_NIL:
+    return 1;
+  case V_BOOL:
+    return a.as.boolean == b.as.boolean;
+  case V_NUMBER:
+    if (a.isInteger && b.isInteger)
+      return a.as.integer == b.as.integer;
+    if (a.isInteger)
+      return rt_same_number(a.as.integer, b.as.number);
+    if (b.isInteger)
+      return rt_same_number(b.as.integer, a.as.number);
+    return a.as.number == b.as.number;
+  case V_STRING:
+    return a.as.string->length == b.as.string->length &&
+           memcmp(a.as.string->chars, b.as.string->chars, a.as.string->length) == 0;
+  default:
+    return 0;
+  }
+}
+
+static inline void rt_check_numbers(Value a, Value b, int line)
+{
+  if (a.type != V_NUMBER || b.type != V_NUMBER)
+    rt_error(line, "Both Operands must be a number.");
+}
+
+/* compareMixed in the interpreter: orders an integer against a double,
+   which is not NaN, without rounding the integer. */
+static int rt_compare_mixed(int64_t integer, double number)
+{
+  if (number >= 0x1p63)
+    return -1;
+  if (number < -0x1p63)
+    return 1;
+  double whole = floor(number);
+  if (integer != (int64_t)whole)
+    return integer < (int64_t)whole ? -1 : 1;
+  return whole < number ? -1 : 0;
+}
+
+/* -1, 0 or 1, or 2 if either number is NaN. */
+static int rt_compare(Value a, Value b)
+{
+  if (a.isInteger && b.isInteger)
+    return (a.as.integer > b.as.integer) - (a.as.integer < b.as.integer);
+  if ((!a.isInteger && isnan(a.as.number)) || (!b.isInteger && isnan(b.as.number)))
+    return 2;
+  if (a.isInteger)
+    return rt_compare_mixed(a.as.integer, b.as.number);
+  if (b.isInteger)
+    return -rt_compare_mixed(b.as.integer, a.as.number);
+  return (a.as.number > b.as.number) - (a.as.number < b.as.number);
+}
+
+/* integerArithmetic in the interpreter: whether two integers have an
+   integer result, which is not so on overflow, a fractional quotient,
+   division by zero or a negative zero. */
+static inline int rt_integer_add(int64_t a, int64_t b, int64_t *result)
+{
+  return !__builtin_add_overflow(a, b, result);
+}
+
+static inline int rt_integer_subtract(int64_t a, int64_t b, int64_t *result)
+{
+  return !__builtin_sub_overflow(a, b, result);
+}
+
+static inline int rt_integer_multiply(int64_t a, int64_t b, int64_t *result)
+{
+  return !__builtin_mul_overflow(a, b, result) && (*result != 0 || (a >= 0 && b >= 0));
+}
+
+static inline int rt_integer_divide(int64_t a, int64_t b, int64_t *result)
+{
+  if (b == 0 || (a == INT64_MIN && b == -1) || a % b != 0 || (a == 0 && b < 0))
+    return 0;
+  *result = a / b;
+  return 1;
+}
+
+static inline Value rt_add(Value a, Value b, int line)
+{
+  int64_t result;
+  if (a.type == V_NUMBER && b.type == V_NUMBER)
+  {
+    if (a.isInteger && b.isInteger && rt_integer_add(a.as.integer, b.as.integer, &result))
+      return rt_integer(result);
+    return rt_number(rt_to_double(a) + rt_to_double(b));
+  }
+  if (a.type == V_STRING && b.type == V_STRING)
+  {
+    size_t length = a.as.string->length + b.as.string->length;
+    LoxString *string = rt_alloc(sizeof(LoxString) + length + 1);
+    string->length = length;
+    memcpy(string->chars, a.as.string->chars, a.as.string->length);
+    memcpy(string->chars + a.as.string->length, b.as.string->chars, b.as.string->length);
+    return rt_string(string);
+  }
+  rt_error(line, "Operands must be two numbers or two strings.");
+  return rt_nil();
+}
+
+#define RT_ARITHMETIC(name, op, exact)                                           \
+  static inline Value name(Value a, Value b, int line)                           \
+  {                                                                              \
+    int64_t result;                                                              \
+    rt_check_numbers(a, b, line);                                                \
+    if (a.isInteger && b.isInteger && exact(a.as.integer, b.as.integer, &result)) \
+      return rt_integer(result);                                                 \
+    return rt_number(rt_to_double(a) op rt_to_double(b));                        \
+  }
+
+#define RT_COMPARISON(name, op)                          \
+  static inline Value name(Value a, Value b, int line)   \
+  {                                                      \
+    rt_check_numbers(a, b, line);                        \
+    int order = rt_compare(a, b);                        \
+    return rt_bool(order != 2 && order op 0);            \
+  }
+
+RT_ARITHMETIC(rt_subtract, -, rt_integer_subtract)
+RT_ARITHMETIC(rt_multiply, *, rt_integer_multiply)
+RT_ARITHMETIC(rt_divide, /, rt_integer_divide)
+RT_COMPARISON(rt_greater, >)
+RT_COMPARISON(rt_greater_equal, >=)
+RT_COMPARISON(rt_less, <)
+RT_COMPARISON(rt_less_equal, <=)
+
+static inline Value rt_negate(Value value, int line)
+{
+  if (value.type != V_NUMBER)
+    rt_error(line, "Operand must be a number.");
+  /* Negating integer 0 gives -0, a double. */
+  if (value.isInteger && value.as.integer != 0 && value.as.integer != INT64_MIN)
+    return rt_integer(-value.as.integer);
+  return rt_number(-rt_to_double(value));
+}
+
+static void rt_print(Value value)
+{
+  switch (value.type)
+  {
+  case V_NIL:
+    puts("nil");
+    break;
+  case V_BOOL:
+    puts(value.as.boolean ? "true" : "false");
+    break;
+  case V_NUMBER:
+  {
+    char number[32];
+    rt_format(value, number);
+    puts(number);
+    break;
+  }
+  case V_STRING:
+    fwrite(value.as.string->chars, 1, value.as.string->length, stdout);
+    putchar('\n');
+    break;
+  case V_CLASS:
+    puts(value.as.klass->name);
+    break;
+  case V_INSTANCE:
+    printf("%s instance\n", value.as.instance->klass->name);
+    break;
+  default:
+    puts("Unknown type");
+    break;
+  }
+}
+
+// Open addressing keyed by symbol + 1, so zeroed entries are empty.
+static Entry *rt_table_find(Entry *entries, int capacity, int symbol)
+{
+  unsigned index = (unsigned)symbol & (unsigned)(capacity - 1);
+  for (;;)
+  {
+    Entry *entry = &entries[index];
+    if (entry->key == 0 || entry->key == symbol + 1)
+      return entry;
+    index = (index + 1) & (unsigned)(capacity - 1);
+  }
+}
+
+static int rt_table_get(const Table *table, int symbol, Value *value)
+{
+  if (table->count == 0)
+    return 0;
+  Entry *entry = rt_table_find(table->entries, table->capacity, symbol);
+  if (entry->key == 0)
+    return 0;
+  *value = entry->value;
+  return 1;
+}
+
+static void rt_table_set(Table *table, int symbol, Value value)
+{
+  if ((table->count + 1) * 4 > table->capacity * 3)
+  {
+    int capacity = table->capacity < 8 ? 8 : table->capacity * 2;
+    Entry *entries = rt_alloc(sizeof(Entry) * capacity);
+    for (int i = 0; i < table->capacity; i++)
+    {
+      if (table->entries[i].key != 0)
+        *rt_table_find(entries, capacity, table->entries[i].key - 1) = table->entries[i];
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+  }
+  Entry *entry = rt_table_find(table->entries, table->capacity, symbol);
+  if (entry->key == 0)
+    table->count++;
+  entry->key = symbol + 1;
+  entry->value = value;
+}
+
+static inline Value rt_global_get(int symbol, int line)
+{
+  if (rt_globals[symbol].type == V_UNDEFINED)
+    rt_error(line, "get - Undefined variable '%s'.", rt_symbols[symbol]);
+  return rt_globals[symbol];
+}
+
+static const char *rt_type_name(VType type)
+{
+  switch (type)
+  {
+  case V_NUMBER:
+    return "num";
+  case V_STRING:
+    return "str";
+  default:
+    return "bool";
+  }
+}
+
+static inline Value rt_expect(Value value, VType type, const char *message, int line)
+{
+  if (value.type != type)
+    rt_error(line, "%s", message);
+  return value;
+}
+
+static inline Value rt_global_assign(int symbol, Value value, int line)
+{
+  if (rt_globals[symbol].type == V_UNDEFINED)
+    rt_error(line, "assign - Undefined variable '%s'.", rt_symbols[symbol]);
+  VType type = rt_global_types[symbol];
+  if (type != V_UNDEFINED && value.type != type)
+    rt_error(line, "Expected a %s value for '%s'.", rt_type_name(type), rt_symbols[symbol]);
+  rt_globals[symbol] = value;
+  return value;
+}
+
+static inline void rt_global_define(int symbol, Value value, VType type)
+{
+  rt_globals[symbol] = value;
+  rt_global_types[symbol] = type;
+}
+
+static Env *rt_env_new(Env *enclosing, int count)
+{
+  Env *env = rt_alloc(sizeof(Env) + sizeof(Value) * count);
+  env->enclosing = enclosing;
+  for (int i = 0; i < count; i++)
+    env->slots[i] = rt_empty();
+  return env;
+}
+
+static Value rt_function(const Proto *proto, Env *env, int isInitializer)
+{
+  Closure *closure = rt_alloc(sizeof(Closure));
+  closure->proto = proto;
+  closure->env = env;
+  closure->isInitializer = isInitializer;
+  Value value;
+  value.type = V_FUNCTION;
+  value.as.closure = closure;
+  return value;
+}
+
+static Value rt_bind(Closure *method, Instance *instance)
+{
+  Env *env = rt_env_new(method->env, 1);
+  env->slots[0].type = V_INSTANCE;
+  env->slots[0].as.instance = instance;
+  return rt_function(method->proto, env, method->isInitializer);
+}
+
+static Class *rt_class(const char *name, Value superclass)
+{
+  Class *klass = rt_alloc(sizeof(Class));
+  klass->name = name;
+  klass->superclass = superclass.type == V_CLASS ? superclass.as.klass : NULL;
+  return klass;
+}
+
+static Value rt_class_value(Class *klass)
+{
+  Value value;
+  value.type = V_CLASS;
+  value.as.klass = klass;
+  return value;
+}
+
+static Closure *rt_find_method(Class *klass, int symbol)
+{
+  Value method;
+  for (; klass != NULL; klass = klass->superclass)
+  {
+    if (rt_table_get(&klass->methods, symbol, &method))
+      return method.as.closure;
+  }
+  return NULL;
+}
+
+static Value rt_get(Value object, int symbol, int line)
+{
+  if (object.type != V_INSTANCE)
+    rt_error(line, "Only instances have properties.");
+  Value value;
+  if (rt_table_get(&object.as.instance->fields, symbol, &value))
+    return value;
+  Closure *method = rt_find_method(object.as.instance->klass, symbol);
+  if (method != NULL)
+    return rt_bind(method, object.as.instance);
+  rt_error(line, "Undefined property '%s'.", rt_symbols[symbol]);
+  return rt_nil();
+}
+
+static inline void rt_check_fields(Value object, int line)
+{
+  if (object.type != V_INSTANCE)
+    rt_error(line, "Only instances have fields.");
+}
+
+static inline Value rt_set(Value object, int symbol, Value value)
+{
+  rt_table_set(&object.as.instance->fields, symbol, value);
+  return value;
+}
+
+static Value rt_super(Value superclass, Value object, int symbol, int line)
+{
+  Closure *method = rt_find_method(superclass.as.klass, symbol);
+  if (method == NULL)
+    rt_error(line, "Undefined property '%s'.", rt_symbols[symbol]);
+  return rt_bind(method, object.as.instance);
+}
+
+// Runs a closure, then any tail calls it returns instead of making.
+static Value rt_invoke(Closure *closure, Value *args)
+{
+  /* The first function of each declared return type along the tail-call
+     chain: the result is returned through all of them. */
+  const Proto *typed[3];
+  int count = 0;
+  for (;;)
+  {
+    const Proto *proto = closure->proto;
+    if (proto->returnType != V_UNDEFINED)
+    {
+      int i = 0;
+      while (i < count && typed[i]->returnType != proto->returnType)
+        i++;
+      if (i == count)
+        typed[count++] = proto;
+    }
+    Value result = proto->fn(closure, args);
+    if (result.type != V_TAIL)
+    {
+      for (int i = 0; i < count; i++)
+      {
+        if (result.type != typed[i]->returnType)
+          rt_error(typed[i]->line, "Expected a %s return value from '%s'.", rt_type_name(typed[i]->returnType), typed[i]->name);
+      }
+      return result;
+    }
+    closure = rt_tail_closure;
+    args = rt_tail_args;
+  }
+}
+
+static int rt_arity(Value callee)
+{
+  if (callee.type == V_FUNCTION)
+    return callee.as.closure->proto->arity;
+  if (callee.type == V_CLASS)
+  {
+    Closure *initializer = rt_find_method(callee.as.klass, RT_SYMBOL_INIT);
+    return initializer != NULL ? initializer->proto->arity : 0;
+  }
+  return 0;
+}
+
+static Value rt_call(Value callee, int argc, Value *args, int line)
+{
+  if (callee.type != V_FUNCTION && callee.type != V_NATIVE && callee.type != V_CLASS)
+    rt_error(line, "Can only call functions and classes.");
+  int arity = rt_arity(callee);
+  if (argc != arity)
+    rt_error(line, "Expected %d arguments but got %d.", arity, argc);
+
+  switch (callee.type)
+  {
+  case V_FUNCTION:
+    return rt_invoke(callee.as.closure, args);
+  case V_NATIVE:
+  {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long long milliseconds = (long long)now.tv_sec * 1000 + now.tv_usec / 1000;
+    return rt_number(milliseconds / 1000.0);
+  }
+  default:
+  {
+    Instance *instance = rt_alloc(sizeof(Instance));
+    instance->klass = callee.as.klass;
+    Closure *initializer = rt_find_method(callee.as.klass, RT_SYMBOL_INIT);
+    if (initializer != NULL)
+      rt_invoke(rt_bind(initializer, instance).as.closure, args);
+    Value value;
+    value.type = V_INSTANCE;
+    value.as.instance = instance;
+    return value;
+  }
+  }
+}
+
+// `return f(...)`: hands the call to rt_invoke in the caller's frame.
+static Value rt_tail_call(Value callee, int argc, Value *args, int line)
+{
+  if (callee.type != V_FUNCTION || callee.as.closure->isInitializer || callee.as.closure->proto->arity != argc)
+    return rt_call(callee, argc, args, line);
+  if (argc > 0)
+    memcpy(rt_tail_args, args, sizeof(Value) * argc);
+  rt_tail_closure = callee.as.closure;
+  Value value;
+  value.type = V_TAIL;
+  return value;
+}
+
+static void rt_init(void)
+{
+  rt_globals[RT_SYMBOL_CLOCK].type = V_NATIVE;
+}
+)RUNTIME";
+}
@@ -1,5 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <any>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <functional>
@@ -15,27 +19,38 @@
 #include "cpplox/loxreturn.h"
 #include "cpplox/loxclass.h"
 #include "cpplox/loxinstance.h"
+#include "cpplox/loxarray.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/loxmap.h"
+#include "cpplox/persistent.h"
 #include "cpplox/runtime_error.h"
 #include "cpplox/environment.h"
 #include "cpplox/lox.h"
+#include "cpplox/jit.h"
+#include "cpplox/profile.h"
+#include "cpplox/number.h"
+#include "cpplox/numberformat.h"
+#include "cpplox/output.h"
 
 namespace CppLox
 {
   class LoxClass;
 
-  // Helper function to try casting to multiple types
+  // Helper function to try casting to multiple types. Casts through a
+  // pointer, which fails without throwing: a bad_any_cast per miss made
+  // every native call cost microseconds.
   template <typename... Ts>
   std::shared_ptr<LoxCallable> try_cast(const std::any &value)
   {
     std::shared_ptr<LoxCallable> result;
     (... || [&]()
      {
-        try {
-            result = std::any_cast<std::shared_ptr<Ts>>(value);
+        if (const auto *callable = std::any_cast<std::shared_ptr<Ts>>(&value))
+        {
+            result = *callable;
             return true;
-        } catch (const std::bad_any_cast&) {
-            return false;
-        } }());
+        }
+        return false; }());
     return result;
   }
 
@@ -44,46 +59,182 @@ namespace CppLox
     std::any left = evaluate(*expr->left);
     std::any right = evaluate(*expr->right);
 
-    switch (expr->op.type)
+    // TypeInference proved the operand types, so there is nothing to guard.
+    // The kind only says which number representation to try first: it
+    // starts on integers and moves to doubles the first time that misses.
+    if (expr->proven)
+    {
+      if (expr->kind == BinaryKind::CONCAT_STRINGS)
+        return std::any(*std::any_cast<LoxStringRef>(&left) + *std::any_cast<LoxStringRef>(&right));
+      if (isIntegerKind(expr->kind))
+      {
+        const int64_t *i = std::any_cast<int64_t>(&left);
+        const int64_t *j = std::any_cast<int64_t>(&right);
+        if (i != nullptr && j != nullptr)
+          return integerOperation(numbersKind(expr->kind), *i, *j);
+        expr->kind = numbersKind(expr->kind);
+      }
+      return numberOperation(expr->kind, left, right);
+    }
+
+    if (expr->kind == BinaryKind::CONCAT_STRINGS)
+    {
+      const LoxStringRef *a = std::any_cast<LoxStringRef>(&left);
+      const LoxStringRef *b = std::any_cast<LoxStringRef>(&right);
+      if (a != nullptr && b != nullptr)
+        return std::any(*a + *b);
+      expr->kind = BinaryKind::GENERIC;
+    }
+    else if (isIntegerKind(expr->kind))
+    {
+      const int64_t *i = std::any_cast<int64_t>(&left);
+      const int64_t *j = std::any_cast<int64_t>(&right);
+      if (i != nullptr && j != nullptr)
+      {
+        return integerOperation(numbersKind(expr->kind), *i, *j);
+      }
+      expr->kind = numbersKind(expr->kind);
+      if (isNumber(left) && isNumber(right))
+      {
+        return numberOperation(expr->kind, left, right);
+      }
+      expr->kind = BinaryKind::GENERIC;
+    }
+    else if (expr->kind != BinaryKind::GENERIC && expr->kind != BinaryKind::UNINITIALIZED)
+    {
+      const double *a = std::any_cast<double>(&left);
+      const double *b = std::any_cast<double>(&right);
+      if (a != nullptr && b != nullptr)
+      {
+        return numericOperation(expr->kind, *a, *b);
+      }
+      if (isNumber(left) && isNumber(right))
+      {
+        return numberOperation(expr->kind, left, right);
+      }
+      // Guard failed: fall back to the generic node permanently.
+      expr->kind = BinaryKind::GENERIC;
+    }
+    else if (expr->kind == BinaryKind::UNINITIALIZED)
+    {
+      expr->kind = specialize(expr->op.type, left, right);
+    }
+
+    return binaryOperation(expr->op, left, right);
+  }
+
+  std::any Interpreter::numericOperation(BinaryKind kind, double a, double b)
+  {
+    switch (kind)
+    {
+    case BinaryKind::ADD_NUMBERS:
+      return std::any(a + b);
+    case BinaryKind::SUBTRACT_NUMBERS:
+      return std::any(a - b);
+    case BinaryKind::MULTIPLY_NUMBERS:
+      return std::any(a * b);
+    case BinaryKind::DIVIDE_NUMBERS:
+      return std::any(a / b);
+    case BinaryKind::LESS_NUMBERS:
+      return std::any(a < b);
+    case BinaryKind::LESS_EQUAL_NUMBERS:
+      return std::any(a <= b);
+    case BinaryKind::GREATER_NUMBERS:
+      return std::any(a > b);
+    case BinaryKind::GREATER_EQUAL_NUMBERS:
+      return std::any(a >= b);
+    case BinaryKind::EQUAL_NUMBERS:
+      return std::any(a == b);
+    default:
+      return std::any(a != b);
+    }
+  }
+
+  std::any Interpreter::integerOperation(BinaryKind kind, int64_t a, int64_t b)
+  {
+    switch (kind)
+    {
+    case BinaryKind::LESS_NUMBERS:
+      return std::any(a < b);
+    case BinaryKind::LESS_EQUAL_NUMBERS:
+      return std::any(a <= b);
+    case BinaryKind::GREATER_NUMBERS:
+      return std::any(a > b);
+    case BinaryKind::GREATER_EQUAL_NUMBERS:
+      return std::any(a >= b);
+    case BinaryKind::EQUAL_NUMBERS:
+      return std::any(a == b);
+    case BinaryKind::NOT_EQUAL_NUMBERS:
+      return std::any(a != b);
+    default:
+      break;
+    }
+    if (std::optional<int64_t> result = integerArithmetic(kind, a, b))
+      return std::any(*result);
+    return numericOperation(kind, static_cast<double>(a), static_cast<double>(b));
+  }
+
+  // Both operands are numbers, in either representation.
+  std::any Interpreter::numberOperation(BinaryKind kind, const std::any &left, const std::any &right)
+  {
+    // A failed any_cast costs a virtual call, so test the right operand
+    // only when the left one matches.
+    if (const double *a = std::any_cast<double>(&left))
+    {
+      if (const double *b = std::any_cast<double>(&right))
+        return numericOperation(kind, *a, *b);
+    }
+    else if (const int64_t *i = std::any_cast<int64_t>(&left))
+    {
+      if (const int64_t *j = std::any_cast<int64_t>(&right))
+        return integerOperation(kind, *i, *j);
+    }
+    if (kind == BinaryKind::EQUAL_NUMBERS || kind == BinaryKind::NOT_EQUAL_NUMBERS)
+      return std::any(isEqual(left, right) == (kind == BinaryKind::EQUAL_NUMBERS));
+    // An integer and a double order exactly, as == compares them.
+    if (isOrderingKind(kind))
+      return std::any(orderingHolds(kind, compareNumbers(left, right)));
+    return numericOperation(kind, toDouble(left), toDouble(right));
+  }
+
+  std::any Interpreter::binaryOperation(const Token &op, const std::any &left, const std::any &right)
+  {
+    switch (op.type)
     {
     case TokenType::GREATER:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) > std::any_cast<double>(right));
     case TokenType::GREATER_EQUAL:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) >= std::any_cast<double>(right));
     case TokenType::LESS:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) < std::any_cast<double>(right));
     case TokenType::LESS_EQUAL:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) <= std::any_cast<double>(right));
     case TokenType::MINUS:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) - std::any_cast<double>(right));
     case TokenType::SLASH:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) / std::any_cast<double>(right));
     case TokenType::STAR:
-      checkNumberOperands(expr->op, left, right);
-      return std::any(std::any_cast<double>(left) * std::any_cast<double>(right));
+      checkNumberOperands(op, left, right);
+      return numberOperation(numberKind(op.type), left, right);
     case TokenType::PLUS:
     {
-      auto &leftType = left.type();
-      auto &rightType = right.type();
-
-      if ((leftType == typeid(int) || leftType == typeid(double)) && ((right.type() == typeid(int) || rightType == typeid(double))))
-        return std::any(std::any_cast<double>(left) + std::any_cast<double>(right));
-      if (left.type() == typeid(std::string) && right.type() == typeid(std::string))
-        return std::any(std::any_cast<std::string>(left) + std::any_cast<std::string>(right));
+      if (isNumber(left) && isNumber(right))
+        return numberOperation(BinaryKind::ADD_NUMBERS, left, right);
+      if (left.type() == typeid(LoxStringRef) && right.type() == typeid(LoxStringRef))
+        return std::any(*std::any_cast<LoxStringRef>(&left) + *std::any_cast<LoxStringRef>(&right));
       break;
     }
     case TokenType::BANG_EQUAL:
-      return std::any(isEqual(left, right));
-    case TokenType::EQUAL_EQUAL:
       return std::any(!isEqual(left, right));
+    case TokenType::EQUAL_EQUAL:
+      return std::any(isEqual(left, right));
     }
-    throw RuntimeError(expr->op, "Operands must be two numbers or two strings.");
+    throw RuntimeError(op, "Operands must be two numbers or two strings.");
+  }
+
+  BinaryKind Interpreter::specialize(TokenType op, const std::any &left, const std::any &right)
+  {
+    if (left.type() == typeid(LoxStringRef) && right.type() == typeid(LoxStringRef))
+      return op == TokenType::PLUS ? BinaryKind::CONCAT_STRINGS : BinaryKind::GENERIC;
+    if (!isNumber(left) || !isNumber(right) || numberKind(op) == BinaryKind::GENERIC)
+      return BinaryKind::GENERIC;
+    if (left.type() == typeid(int64_t) && right.type() == typeid(int64_t))
+      return integerKind(numberKind(op));
+    return numberKind(op);
   }
 
   std::any Interpreter::visitGroupingExpr(const Grouping *expr)
@@ -93,7 +244,7 @@ namespace CppLox
 
   std::any Interpreter::visitLiteralExpr(const Literal *expr)
   {
-    return toAny(expr->value);
+    return expr->materialized;
   }
 
   std::any Interpreter::visitUnaryExpr(const Unary *expr)
@@ -105,8 +256,13 @@ namespace CppLox
     case TokenType::BANG:
       return std::any(!isTruthy(right));
     case TokenType::MINUS:
-      checkNumberOperand(expr->op, right);
-      return std::any(-std::any_cast<double>(right));
+      if (const auto *number = std::any_cast<double>(&right))
+        return std::any(-*number);
+      if (!expr->proven)
+        checkNumberOperand(expr->op, right);
+      if (std::optional<int64_t> negated = integerNegate(*std::any_cast<int64_t>(&right)))
+        return std::any(*negated);
+      return std::any(-toDouble(right));
     }
     // Unreachable.
     std::cout << "Unreachable code reached" << std::endl;
@@ -130,30 +286,37 @@ namespace CppLox
   bool Interpreter::isEqual(const std::any &left, const std::any &right)
   {
     if (left.type() != right.type())
+    {
+      // An integer and a double can be the same number.
+      if (const auto *integer = std::any_cast<int64_t>(&left))
+        return right.type() == typeid(double) && sameNumber(*integer, *std::any_cast<double>(&right));
+      if (const auto *integer = std::any_cast<int64_t>(&right))
+        return left.type() == typeid(double) && sameNumber(*integer, *std::any_cast<double>(&left));
       return false;
+    }
     if (left.type() == typeid(std::nullptr_t))
       return true;
     if (left.type() == typeid(double))
       return std::any_cast<double>(left) == std::any_cast<double>(right);
     if (left.type() == typeid(bool))
       return std::any_cast<bool>(left) == std::any_cast<bool>(right);
-    if (left.type() == typeid(std::string))
-      return std::any_cast<std::string>(left) == std::any_cast<std::string>(right);
-    if (left.type() == typeid(int))
-      return std::any_cast<int>(left) == std::any_cast<int>(right);
+    if (left.type() == typeid(LoxStringRef))
+      return *std::any_cast<LoxStringRef>(&left) == *std::any_cast<LoxStringRef>(&right);
+    if (left.type() == typeid(int64_t))
+      return *std::any_cast<int64_t>(&left) == *std::any_cast<int64_t>(&right);
     return false;
   }
 
   void Interpreter::checkNumberOperand(const Token &op, const std::any &operand)
   {
-    if (operand.type() == typeid(double))
+    if (isNumber(operand))
       return;
     throw RuntimeError(op, "Operand must be a number.");
   }
 
   void Interpreter::checkNumberOperands(const Token &op, const std::any &left, const std::any &right)
   {
-    if (left.type() == typeid(double) && right.type() == typeid(double))
+    if (isNumber(left) && isNumber(right))
       return;
     throw RuntimeError(op, "Both Operands must be a number.");
   }
@@ -178,15 +341,67 @@ namespace CppLox
     if (obj.type() == typeid(std::nullptr_t))
       return "nil";
     if (obj.type() == typeid(double))
-      return std::to_string(std::any_cast<double>(obj));
+      return formatNumber(std::any_cast<double>(obj));
+    if (obj.type() == typeid(int64_t))
+      return std::to_string(std::any_cast<int64_t>(obj));
     if (obj.type() == typeid(bool))
       return std::any_cast<bool>(obj) ? "true" : "false";
-    if (obj.type() == typeid(std::string))
-      return std::any_cast<std::string>(obj);
+    if (obj.type() == typeid(LoxStringRef))
+      return std::any_cast<LoxStringRef>(&obj)->str();
     if (obj.type() == typeid(std::shared_ptr<LoxInstance>))
       return std::any_cast<std::shared_ptr<LoxInstance>>(obj)->toString();
     if (obj.type() == typeid(std::shared_ptr<LoxClass>))
       return std::any_cast<std::shared_ptr<LoxClass>>(obj)->toString();
+    if (const auto *array = std::any_cast<std::shared_ptr<Float64Array>>(&obj))
+      return (*array)->toString();
+    // A list or map inside itself prints as [...] or {...}.
+    if (const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&obj))
+    {
+      if (std::find(printing.begin(), printing.end(), list->get()) != printing.end())
+        return "[...]";
+      printing.push_back(list->get());
+      std::string result = "[";
+      std::vector<std::any> &elements = (*list)->elements;
+      for (size_t i = 0; i < elements.size(); i++)
+      {
+        result += (i == 0 ? "" : ", ") + stringify(elements[i]);
+      }
+      printing.pop_back();
+      return result + "]";
+    }
+    if (const auto *map = std::any_cast<std::shared_ptr<LoxMap>>(&obj))
+    {
+      if (std::find(printing.begin(), printing.end(), map->get()) != printing.end())
+        return "{...}";
+      printing.push_back(map->get());
+      std::string result = "{";
+      (*map)->forEach([this, &result](const std::any &key, std::any &value)
+                      {
+                        std::any copy = key;
+                        result += (result.size() == 1 ? "" : ", ") + stringify(copy) + ": " + stringify(value); });
+      printing.pop_back();
+      return result + "}";
+    }
+    // Persistent collections cannot hold themselves, so they need no
+    // guard of their own.
+    if (const auto *vector = std::any_cast<std::shared_ptr<PersistentVector>>(&obj))
+    {
+      std::string result = "[";
+      (*vector)->forEach([this, &result](const std::any &value)
+                         {
+                           std::any copy = value;
+                           result += (result.size() == 1 ? "" : ", ") + stringify(copy); });
+      return result + "]";
+    }
+    if (const auto *map = std::any_cast<std::shared_ptr<PersistentMap>>(&obj))
+    {
+      std::string result = "{";
+      (*map)->forEach([this, &result](const std::any &key, const std::any &value)
+                      {
+                        std::any keyCopy = key, valueCopy = value;
+                        result += (result.size() == 1 ? "" : ", ") + stringify(keyCopy) + ": " + stringify(valueCopy); });
+      return result + "}";
+    }
     return "Unknown type";
   }
 
@@ -199,7 +414,25 @@ namespace CppLox
   std::any Interpreter::visitPrintStmt(const Print *stmt)
   {
     std::any value = evaluate(*stmt->expression);
-    std::cout << stringify(value) << std::endl;
+    // Strings and numbers are written without building a std::string.
+    if (const auto *string = std::any_cast<LoxStringRef>(&value))
+    {
+      Output::line((*string)->view());
+    }
+    else if (const auto *number = std::any_cast<double>(&value))
+    {
+      char buffer[NUMBER_BUFFER_SIZE];
+      Output::line(formatNumber(*number, buffer));
+    }
+    else if (const auto *integer = std::any_cast<int64_t>(&value))
+    {
+      char buffer[NUMBER_BUFFER_SIZE];
+      Output::line(std::string_view(buffer, std::to_chars(buffer, buffer + sizeof buffer, *integer).ptr - buffer));
+    }
+    else
+    {
+      Output::line(stringify(value));
+    }
     return std::any();
   }
 
@@ -215,7 +448,18 @@ namespace CppLox
     {
       value = evaluate(*stmt->initializer.get());
     }
-    environment->define(stmt->name.lexeme, value);
+    if (stmt->annotation == Annotation::NONE)
+    {
+      environment->define(stmt->name.lexeme, value);
+      return std::any();
+    }
+    if (!hasType(value, stmt->annotation))
+    {
+      throw RuntimeError(stmt->name, std::string("Expected a ") + annotationName(stmt->annotation) + " value for '" + stmt->name.lexeme + "'.");
+    }
+    // Later assignments to a global are checked by its environment, to a
+    // local at the Assign nodes the TypeChecker marked.
+    environment->define(stmt->name.lexeme, value, environment == globals ? stmt->annotation : Annotation::NONE);
     return std::any();
   }
 
@@ -231,6 +475,10 @@ namespace CppLox
     int distance = locals.find(expr) != locals.end() ? locals[expr] : -1;
     if (distance > -1)
     {
+      if (!hasType(value, expr->annotation))
+      {
+        throw RuntimeError(expr->name, std::string("Expected a ") + annotationName(expr->annotation) + " value for '" + expr->name.lexeme + "'.");
+      }
       environment->assignAt(distance, expr->name, value);
     }
     else
@@ -276,6 +524,40 @@ namespace CppLox
     return std::any();
   }
 
+  // Sizes the result once and copies every part into it, rather than
+  // concatenating pairwise through intermediate strings.
+  std::any Interpreter::visitInterpolationExpr(const Interpolation *expr)
+  {
+    std::vector<std::any> values;
+    values.reserve(expr->parts.size());
+    size_t length = 0;
+    for (const auto &part : expr->parts)
+    {
+      values.push_back(evaluate(*part));
+      std::any &value = values.back();
+      if (auto *string = std::any_cast<LoxStringRef>(&value))
+      {
+        length += string->str().size();
+      }
+      else
+      {
+        value = stringify(value);
+        length += std::any_cast<std::string>(&value)->size();
+      }
+    }
+
+    std::string chars;
+    chars.reserve(length);
+    for (const auto &value : values)
+    {
+      if (auto *string = std::any_cast<LoxStringRef>(&value))
+        chars += string->str();
+      else
+        chars += *std::any_cast<std::string>(&value);
+    }
+    return std::any(LoxStringRef(std::move(chars)));
+  }
+
   std::any Interpreter::visitLogicalExpr(const Logical *expr)
   {
     std::any left = evaluate(*expr->left);
@@ -310,22 +592,33 @@ namespace CppLox
     {
       arguments.push_back(evaluate(*argument));
     }
+    return call(expr->paren, callee, std::move(arguments));
+  }
 
-    std::shared_ptr<LoxCallable> function = try_cast<LoxFunction, LoxClass, ClockCallable>(callee);
+  std::any Interpreter::call(const Token &paren, const std::any &callee, std::vector<std::any> arguments)
+  {
+    std::shared_ptr<LoxCallable> function = try_cast<LoxFunction, LoxClass, ClockCallable, NativeFunction>(callee);
     if (!function)
     {
-      throw RuntimeError(expr->paren, "Can only call functions and classes.");
+      throw RuntimeError(paren, "Can only call functions and classes.");
     }
 
     if (arguments.size() != function->arity())
     {
       throw RuntimeError(
-          expr->paren,
+          paren,
           "Expected " + std::to_string(function->arity()) +
               " arguments but got " + std::to_string(arguments.size()) + ".");
     }
 
-    return function->call(shared_from_this(), std::move(arguments));
+    try
+    {
+      return function->call(shared_from_this(), std::move(arguments));
+    }
+    catch (NativeError &error)
+    {
+      throw RuntimeError(paren, error.what());
+    }
   }
 
   std::any Interpreter::visitFunctionStmt(const Function *stmt)
@@ -337,6 +630,26 @@ namespace CppLox
 
   std::any Interpreter::visitReturnStmt(const Return *stmt)
   {
+    if (auto *tail = dynamic_cast<const Call *>(stmt->value.get()))
+    {
+      std::any callee = evaluate(*tail->callee);
+      std::vector<std::any> arguments;
+      for (const auto &argument : tail->arguments)
+      {
+        arguments.push_back(evaluate(*argument));
+      }
+      if (callee.type() == typeid(std::shared_ptr<LoxFunction>))
+      {
+        auto function = std::any_cast<std::shared_ptr<LoxFunction>>(callee);
+        if (!function->initializer() && arguments.size() == function->arity())
+        {
+          throw LoxReturn(std::move(function), std::move(arguments));
+        }
+      }
+      // Classes, natives and bad calls raise and report here as before.
+      throw LoxReturn(call(tail->paren, callee, std::move(arguments)));
+    }
+
     std::any value;
     if (stmt->value != nullptr)
     {
@@ -350,6 +663,32 @@ namespace CppLox
     locals[expr] = depth;
   }
 
+  void Interpreter::enableJit()
+  {
+    jit = std::make_shared<Jit>(*this, globals);
+  }
+
+  void Interpreter::recordProfile(std::shared_ptr<Profile> profile)
+  {
+    this->profile = profile;
+  }
+
+  void Interpreter::applyProfile(const Profile &profile)
+  {
+    if (jit == nullptr)
+      return;
+    for (const auto &count : profile.callCounts())
+    {
+      jit->seed(count.first, count.second);
+    }
+  }
+
+  int Interpreter::resolvedDepth(const Expr *expr) const
+  {
+    auto it = locals.find(expr);
+    return it != locals.end() ? it->second : -1;
+  }
+
   std::any Interpreter::lookupVariable(const Token &name, const Expr *expr)
   {
     int distance = locals.find(expr) != locals.end() ? locals[expr] : -1;
@@ -427,6 +766,143 @@ namespace CppLox
     return value;
   }
 
+  // The element of a length-element collection an index selects.
+  static size_t elementIndex(const Token &bracket, const std::any &index, size_t length)
+  {
+    int64_t integer;
+    const auto *number = std::any_cast<double>(&index);
+    if (const auto *value = std::any_cast<int64_t>(&index))
+      integer = *value;
+    else if (number != nullptr && *number == std::floor(*number) && std::fabs(*number) < 0x1p62)
+      integer = static_cast<int64_t>(*number);
+    else
+      throw RuntimeError(bracket, "Index must be an integer.");
+    if (integer < 0 || static_cast<uint64_t>(integer) >= length)
+      throw RuntimeError(bracket, "Index " + std::to_string(integer) + " is out of range.");
+    return static_cast<size_t>(integer);
+  }
+
+  // A slice bound: nil for the start or end of the collection.
+  static size_t sliceBound(const Token &bracket, const std::any &bound, size_t length, size_t missing)
+  {
+    if (bound.type() == typeid(std::nullptr_t))
+      return missing;
+    return elementIndex(bracket, bound, length + 1);
+  }
+
+  // The key a map is indexed with.
+  static const std::any &mapKey(const Token &bracket, const std::any &key)
+  {
+    if (const char *error = LoxMap::keyError(key))
+      throw RuntimeError(bracket, error);
+    return key;
+  }
+
+  // Whether object[index] reads an element.
+  static bool indexable(const std::any &object)
+  {
+    const std::type_info &type = object.type();
+    return type == typeid(std::shared_ptr<LoxList>) || type == typeid(std::shared_ptr<Float64Array>) ||
+           type == typeid(std::shared_ptr<LoxMap>) || type == typeid(std::shared_ptr<PersistentVector>) ||
+           type == typeid(std::shared_ptr<PersistentMap>);
+  }
+
+  std::any Interpreter::visitIndexExpr(const Index *expr)
+  {
+    std::any object = evaluate(*expr->object);
+    if (!indexable(object))
+    {
+      throw RuntimeError(expr->bracket, "Only lists, arrays and maps can be indexed.");
+    }
+    std::any index = evaluate(*expr->index);
+    if (const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&object))
+    {
+      std::vector<std::any> &elements = (*list)->elements;
+      return elements[elementIndex(expr->bracket, index, elements.size())];
+    }
+    if (const auto *array = std::any_cast<std::shared_ptr<Float64Array>>(&object))
+    {
+      std::vector<double> &elements = (*array)->elements;
+      return elements[elementIndex(expr->bracket, index, elements.size())];
+    }
+    if (const auto *vector = std::any_cast<std::shared_ptr<PersistentVector>>(&object))
+    {
+      return (*vector)->at(elementIndex(expr->bracket, index, (*vector)->size()));
+    }
+    // A missing key reads as nil, as with get.
+    const std::any *value;
+    if (const auto *map = std::any_cast<std::shared_ptr<LoxMap>>(&object))
+      value = (*map)->get(mapKey(expr->bracket, index));
+    else
+      value = (*std::any_cast<std::shared_ptr<PersistentMap>>(&object))->get(mapKey(expr->bracket, index));
+    return value != nullptr ? *value : std::any(nullptr);
+  }
+
+  std::any Interpreter::visitSetIndexExpr(const SetIndex *expr)
+  {
+    std::any object = evaluate(*expr->object);
+    const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&object);
+    const auto *array = list == nullptr ? std::any_cast<std::shared_ptr<Float64Array>>(&object) : nullptr;
+    const auto *map = list == nullptr && array == nullptr ? std::any_cast<std::shared_ptr<LoxMap>>(&object) : nullptr;
+    if (list == nullptr && array == nullptr && map == nullptr)
+    {
+      if (indexable(object))
+        throw RuntimeError(expr->bracket, "Persistent collections cannot be changed; use assoc.");
+      throw RuntimeError(expr->bracket, "Only lists, arrays and maps can be indexed.");
+    }
+    std::any index = evaluate(*expr->index);
+    std::any value = evaluate(*expr->value);
+    if (map != nullptr)
+    {
+      (*map)->set(mapKey(expr->bracket, index), value);
+      return value;
+    }
+    // The index and value may have grown the list, so its storage is only
+    // looked up now.
+    if (list != nullptr)
+    {
+      std::vector<std::any> &elements = (*list)->elements;
+      elements[elementIndex(expr->bracket, index, elements.size())] = value;
+      return value;
+    }
+    std::vector<double> &elements = (*array)->elements;
+    size_t element = elementIndex(expr->bracket, index, elements.size());
+    if (!isNumber(value))
+    {
+      throw RuntimeError(expr->bracket, "Array elements must be numbers.");
+    }
+    elements[element] = toDouble(value);
+    return value;
+  }
+
+  // A copy of the elements from start up to, not including, end.
+  std::any Interpreter::visitSliceExpr(const Slice *expr)
+  {
+    std::any object = evaluate(*expr->object);
+    const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&object);
+    const auto *array = list == nullptr ? std::any_cast<std::shared_ptr<Float64Array>>(&object) : nullptr;
+    if (list == nullptr && array == nullptr)
+    {
+      throw RuntimeError(expr->bracket, "Only lists and arrays can be sliced.");
+    }
+    std::any start = evaluate(*expr->start);
+    std::any end = evaluate(*expr->end);
+    size_t length = list != nullptr ? (*list)->elements.size() : (*array)->elements.size();
+    size_t first = sliceBound(expr->bracket, start, length, 0);
+    size_t last = sliceBound(expr->bracket, end, length, length);
+    if (last < first)
+    {
+      throw RuntimeError(expr->bracket, "Slice end is before its start.");
+    }
+    if (list != nullptr)
+    {
+      const std::vector<std::any> &elements = (*list)->elements;
+      return std::make_shared<LoxList>(std::vector<std::any>(elements.begin() + first, elements.begin() + last));
+    }
+    const std::vector<double> &elements = (*array)->elements;
+    return std::make_shared<Float64Array>(std::vector<double>(elements.begin() + first, elements.begin() + last));
+  }
+
   std::any Interpreter::visitThisExpr(const This *expr)
   {
     return lookupVariable(expr->keyword, expr);
@@ -446,4 +922,336 @@ namespace CppLox
     return method->bind(object);
   }
 
+  bool Interpreter::applyInPlace(TokenType op, std::any &target, const std::any &operand)
+  {
+    if (int64_t *i = std::any_cast<int64_t>(&target))
+    {
+      const int64_t *j = std::any_cast<int64_t>(&operand);
+      std::optional<int64_t> result = j != nullptr ? integerArithmetic(numberKind(op), *i, *j) : std::nullopt;
+      if (!result)
+        return false;
+      *i = *result;
+      return true;
+    }
+
+    double *a = std::any_cast<double>(&target);
+    const double *b = std::any_cast<double>(&operand);
+    if (a == nullptr || b == nullptr)
+      return false;
+
+    switch (op)
+    {
+    case TokenType::PLUS:
+      *a += *b;
+      return true;
+    case TokenType::MINUS:
+      *a -= *b;
+      return true;
+    case TokenType::STAR:
+      *a *= *b;
+      return true;
+    case TokenType::SLASH:
+      *a /= *b;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  std::any Interpreter::visitAssignOpExpr(const AssignOp *expr)
+  {
+    if (expr->depth < 0)
+    {
+      std::any current = globals->get(expr->name);
+      std::any operand = evaluate(*expr->value);
+      if (!applyInPlace(expr->op.type, current, operand))
+      {
+        current = binaryOperation(expr->op, current, operand);
+      }
+      globals->assign(expr->name, current);
+      return current;
+    }
+
+    // The operand is a literal or a variable, so reading it before the
+    // target is unobservable.
+    std::any operand = evaluate(*expr->value);
+    std::any &slot = environment->slotAt(expr->depth, expr->name.lexeme);
+    if (!applyInPlace(expr->op.type, slot, operand))
+    {
+      slot = binaryOperation(expr->op, slot, operand);
+    }
+    return slot;
+  }
+
+  std::any Interpreter::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    std::any global;
+    const std::any &left = expr->depth > -1 ? environment->slotAt(expr->depth, expr->name.lexeme) : (global = globals->get(expr->name));
+    std::any right = evaluate(*expr->right);
+
+    // Loop conditions usually compare integer counters.
+    const int64_t *i = std::any_cast<int64_t>(&left);
+    const int64_t *j = i != nullptr ? std::any_cast<int64_t>(&right) : nullptr;
+    if (j != nullptr)
+    {
+      return integerOperation(numberKind(expr->op.type), *i, *j);
+    }
+    const double *a = std::any_cast<double>(&left);
+    const double *b = std::any_cast<double>(&right);
+    if (a != nullptr && b != nullptr)
+    {
+      switch (expr->op.type)
+      {
+      case TokenType::LESS:
+        return std::any(*a < *b);
+      case TokenType::LESS_EQUAL:
+        return std::any(*a <= *b);
+      case TokenType::GREATER:
+        return std::any(*a > *b);
+      case TokenType::GREATER_EQUAL:
+        return std::any(*a >= *b);
+      case TokenType::EQUAL_EQUAL:
+        return std::any(*a == *b);
+      case TokenType::BANG_EQUAL:
+        return std::any(*a != *b);
+      default:
+        break;
+      }
+    }
+    return binaryOperation(expr->op, left, right);
+  }
+
+  std::any Interpreter::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    std::any object = evaluate(*expr->object);
+    auto *instance = std::any_cast<std::shared_ptr<LoxInstance>>(&object);
+    if (instance == nullptr)
+    {
+      throw RuntimeError(expr->name, "Only instances have fields.");
+    }
+
+    std::any operand = evaluate(*expr->value);
+    if (std::any *field = (*instance)->field(expr->name.lexeme))
+    {
+      if (!applyInPlace(expr->op.type, *field, operand))
+      {
+        *field = binaryOperation(expr->op, *field, operand);
+      }
+      return *field;
+    }
+
+    // Not a field yet: reading it binds a method or reports the error.
+    std::any value = binaryOperation(expr->op, (*instance)->get(expr->name), operand);
+    return (*instance)->set(expr->name, value);
+  }
+
+  std::any Interpreter::visitForLoopStmt(const ForLoop *stmt)
+  {
+    while (isTruthy(evaluate(*stmt->condition)))
+    {
+      executeIteration(stmt->body, stmt->increment.get());
+    }
+    return std::any();
+  }
+
+  // Runs one loop body, then the increment if any, in a fresh scope with the
+  // same recovery as the block it was lowered from: a runtime error is
+  // reported and ends the iteration. Returns whether the body completed.
+  bool Interpreter::executeIteration(const std::vector<StmtPtr> &body, Expr *increment)
+  {
+    std::shared_ptr<Environment> new_env = std::make_shared<Environment>(this->environment);
+    InterpreterBlockManager blockManager(*this, new_env);
+    try
+    {
+      for (const auto &stmt : body)
+      {
+        execute(*stmt);
+      }
+      if (increment != nullptr)
+      {
+        evaluate(*increment);
+      }
+      return true;
+    }
+    catch (const RuntimeError &error)
+    {
+      lox::runtimeError(error);
+      return false;
+    }
+  }
+
+  // Whether a number converts to a double without rounding.
+  static bool exactDouble(const std::any &number)
+  {
+    const auto *integer = std::any_cast<int64_t>(&number);
+    return integer == nullptr || (*integer >= -(int64_t(1) << 53) && *integer <= (int64_t(1) << 53));
+  }
+
+  std::any Interpreter::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    std::shared_ptr<Environment> loopEnv = std::make_shared<Environment>(this->environment);
+    InterpreterBlockManager blockManager(*this, loopEnv);
+    try
+    {
+      std::any start = stmt->start != nullptr ? evaluate(*stmt->start) : std::any(nullptr);
+      loopEnv->define(stmt->name.lexeme, start);
+      std::any &variable = loopEnv->slotAt(0, stmt->name.lexeme);
+      std::any limit = evaluate(*stmt->limit);
+
+      // Integer bounds and step keep an integer counter; the bound's margin
+      // keeps the last step from overflowing.
+      const int64_t *firstInteger = std::any_cast<int64_t>(&start);
+      const int64_t *boundInteger = std::any_cast<int64_t>(&limit);
+      if (firstInteger != nullptr && boundInteger != nullptr && stmt->step == std::floor(stmt->step) &&
+          std::fabs(stmt->step) < 0x1p31 && std::llabs(*firstInteger) < (int64_t(1) << 62) && std::llabs(*boundInteger) < (int64_t(1) << 62))
+      {
+        int64_t step = static_cast<int64_t>(stmt->step);
+        runCountedLoop<int64_t>(stmt, *firstInteger, *boundInteger, stmt->stepOp.type == TokenType::MINUS ? -step : step, variable);
+        return std::any();
+      }
+      // Past 2^53 an integer bound would round, so such loops run as
+      // written.
+      if (isNumber(start) && isNumber(limit) && exactDouble(start) && exactDouble(limit))
+      {
+        double step = stmt->stepOp.type == TokenType::MINUS ? -stmt->step : stmt->step;
+        runCountedLoop<double>(stmt, toDouble(start), toDouble(limit), step, variable);
+        return std::any();
+      }
+
+      // Not numeric: run the loop as written so errors surface as usual.
+      std::any step(stmt->step);
+      while (isTruthy(binaryOperation(stmt->op, variable, limit)))
+      {
+        if (executeIteration(stmt->body))
+        {
+          variable = binaryOperation(stmt->stepOp, variable, step);
+        }
+      }
+    }
+    catch (const RuntimeError &error)
+    {
+      lox::runtimeError(error);
+    }
+    return std::any();
+  }
+
+  template <typename Number>
+  void Interpreter::runCountedLoop(const CountedLoop *stmt, Number counter, Number limit, Number step, std::any &variable)
+  {
+    auto inBounds = [&]()
+    {
+      switch (stmt->op.type)
+      {
+      case TokenType::LESS:
+        return counter < limit;
+      case TokenType::LESS_EQUAL:
+        return counter <= limit;
+      case TokenType::GREATER:
+        return counter > limit;
+      default:
+        return counter >= limit;
+      }
+    };
+
+    while (inBounds())
+    {
+      if (stmt->materialize)
+      {
+        variable = counter;
+      }
+      if (executeIteration(stmt->body))
+      {
+        counter += step;
+      }
+    }
+    if (stmt->materialize)
+    {
+      variable = counter;
+    }
+  }
+
+  std::any Interpreter::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    std::any callee = evaluate(*expr->callee);
+    size_t base = inlineArguments.size();
+    for (const auto &argument : expr->arguments)
+    {
+      inlineArguments.push_back(evaluate(*argument));
+    }
+
+    auto *function = std::any_cast<std::shared_ptr<LoxFunction>>(&callee);
+    if (function == nullptr || (*function)->getDeclaration() != expr->target)
+    {
+      // The name no longer refers to the inlined function.
+      std::vector<std::any> arguments(std::make_move_iterator(inlineArguments.begin() + base), std::make_move_iterator(inlineArguments.end()));
+      inlineArguments.resize(base);
+      return call(expr->paren, callee, std::move(arguments));
+    }
+
+    if (profile != nullptr)
+    {
+      profile->countCall(expr->target);
+    }
+    size_t enclosingBase = inlineBase;
+    inlineBase = base;
+    std::any result;
+    try
+    {
+      result = evaluate(*expr->body);
+    }
+    catch (const RuntimeError &error)
+    {
+      // The callee's block would have reported it and returned nil.
+      lox::runtimeError(error);
+    }
+    inlineBase = enclosingBase;
+    inlineArguments.resize(base);
+    return result;
+  }
+
+  std::any Interpreter::visitArgRefExpr(const ArgRef *expr)
+  {
+    return inlineArguments[inlineBase + expr->slot];
+  }
+
+  std::any Interpreter::visitConditionalExpr(const Conditional *expr)
+  {
+    if (isTruthy(evaluate(*expr->condition)))
+    {
+      return evaluate(*expr->thenBranch);
+    }
+    return evaluate(*expr->elseBranch);
+  }
+
+  std::any Interpreter::visitInvariantExpr(const Invariant *expr)
+  {
+    if (expr->activation != expr->loop->activation)
+    {
+      expr->value = evaluate(*expr->expression);
+      expr->activation = expr->loop->activation;
+    }
+    return expr->value;
+  }
+
+  std::any Interpreter::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    // Each run of the loop starts with every hoisted value stale. A recursive
+    // call can run the same loop before this run ends, so the enclosing run's
+    // activation is restored afterwards, which makes the values the inner run
+    // cached stale in turn.
+    uint64_t enclosing = stmt->activation;
+    stmt->activation = ++loopActivations;
+    try
+    {
+      execute(*stmt->loop);
+    }
+    catch (...)
+    {
+      stmt->activation = enclosing;
+      throw;
+    }
+    stmt->activation = enclosing;
+    return std::any();
+  }
+
 };
\ No newline at end of file
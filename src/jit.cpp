@@ -0,0 +1,1033 @@
+#include "cpplox/jit.h"
+#include "cpplox/interpreter.h"
+#include "cpplox/loxfunction.h"
+#include "cpplox/number.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef CPPLOX_JIT
+#include <sys/mman.h>
+#include <cstring>
+#include <initializer_list>
+#endif
+
+namespace CppLox
+{
+#ifdef CPPLOX_JIT
+  // Emits x86-64 code into a byte buffer, with forward and backward labels
+  // patched once the whole module is laid out. Values live in xmm0 (result)
+  // and xmm1 (right operand); rax and rcx are scratch.
+  class Assembler
+  {
+  public:
+    // Condition codes of the two-byte jcc rel32 opcodes.
+    static constexpr uint8_t JE = 0x84, JNE = 0x85, JB = 0x82, JAE = 0x83, JBE = 0x86, JA = 0x87, JS = 0x88, JP = 0x8A, JG = 0x8F;
+
+    std::vector<uint8_t> code;
+
+    int newLabel()
+    {
+      labels.push_back(UNBOUND);
+      return static_cast<int>(labels.size()) - 1;
+    }
+
+    void bind(int label)
+    {
+      labels[label] = code.size();
+    }
+
+    size_t position(int label) const
+    {
+      return labels[label];
+    }
+
+    void emit(std::initializer_list<uint8_t> bytes)
+    {
+      code.insert(code.end(), bytes);
+    }
+
+    void emit32(uint32_t value)
+    {
+      for (int i = 0; i < 4; i++)
+        code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void emit64(uint64_t value)
+    {
+      for (int i = 0; i < 8; i++)
+        code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void patch32(size_t at, uint32_t value)
+    {
+      for (int i = 0; i < 4; i++)
+        code[at + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    void jump(int label)
+    {
+      emit({0xE9});
+      reference(label);
+    }
+
+    void jumpIf(uint8_t condition, int label)
+    {
+      emit({0x0F, condition});
+      reference(label);
+    }
+
+    void call(int label)
+    {
+      emit({0xE8});
+      reference(label);
+    }
+
+    // movsd xmm<reg>, [rbp + offset]
+    void load(int reg, int32_t offset)
+    {
+      emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x85 | reg << 3)});
+      emit32(offset);
+    }
+
+    // movsd [rbp + offset], xmm0
+    void store(int32_t offset)
+    {
+      emit({0xF2, 0x0F, 0x11, 0x85});
+      emit32(offset);
+    }
+
+    // mov rax, imm64; movq xmm<reg>, rax
+    void loadConstant(int reg, double value)
+    {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof bits);
+      emit({0x48, 0xB8});
+      emit64(bits);
+      emit({0x66, 0x48, 0x0F, 0x6E, static_cast<uint8_t>(0xC0 | reg << 3)});
+    }
+
+    // sub rsp, 8; movsd [rsp], xmm0
+    void push()
+    {
+      emit({0x48, 0x83, 0xEC, 0x08, 0xF2, 0x0F, 0x11, 0x04, 0x24});
+    }
+
+    // movsd xmm<reg>, [rsp]; add rsp, 8
+    void pop(int reg)
+    {
+      emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x04 | reg << 3), 0x24, 0x48, 0x83, 0xC4, 0x08});
+    }
+
+    // Moves xmm0 to xmm1 and pops the left operand into xmm0.
+    void popLeft()
+    {
+      emit({0x66, 0x0F, 0x28, 0xC8});
+      pop(0);
+    }
+
+    // Every fixup is a rel32 measured from the end of its field.
+    void link()
+    {
+      for (const auto &fixup : fixups)
+      {
+        patch32(fixup.first, static_cast<uint32_t>(labels[fixup.second] - (fixup.first + 4)));
+      }
+    }
+
+  private:
+    static constexpr size_t UNBOUND = static_cast<size_t>(-1);
+    std::vector<size_t> labels;
+    std::vector<std::pair<size_t, int>> fixups;
+
+    void reference(int label)
+    {
+      fixups.emplace_back(code.size(), label);
+      emit32(0);
+    }
+  };
+
+  // Compiles a function and the top-level functions it calls into one
+  // module. Every function in it keeps its parameters and locals in
+  // rbp-relative slots of one shared frame size, so a tail call can reuse
+  // the caller's frame and jump past the callee's prologue. Arguments are
+  // passed on the stack; a function returns its value in xmm0 and, in eax,
+  // 0 on success or 1 to bail out.
+  //
+  // Every value is a double at run time, but the compiler tracks which ones
+  // the interpreter would hold as int64: integer literals, and integer
+  // arithmetic on them. Those stay below 2^53 in magnitude, where a double
+  // is exact, and any operation whose integer result would not (or that
+  // the interpreter would turn into a double) bails out. A function is
+  // compiled once for integer arguments and once for doubles, and returns
+  // numbers of the kind it was called with.
+  class JitCompiler
+  {
+  public:
+    using Representation = Jit::Representation;
+
+    static constexpr uint32_t MAX_DEPTH = 10000;
+
+    JitCompiler(const Interpreter &interpreter, Environment &globals, uint32_t *depth)
+        : interpreter(interpreter), globals(globals), depth(depth) {}
+
+    Assembler assembler;
+    std::vector<std::pair<std::string, const Function *>> guards;
+    int root = -1;
+
+    bool compile(const Function *function, Representation representation, int maxParams)
+    {
+      this->maxParams = maxParams;
+      unitFor(function, representation);
+      // Compiling a unit can discover more callees.
+      for (size_t i = 0; i < units.size(); i++)
+      {
+        // By value: the vector can grow while the unit compiles.
+        if (!compileUnit(units[i]))
+          return false;
+      }
+
+      int32_t frame = static_cast<int32_t>((maxSlots * 8 + 15) / 16 * 16);
+      for (size_t at : frameFixups)
+      {
+        assembler.patch32(at, frame);
+      }
+
+      // The C++ entry point: int (const double *arguments, double *result).
+      root = assembler.newLabel();
+      assembler.bind(root);
+      size_t params = units[0].function->params.size();
+      assembler.emit({0x55, 0x48, 0x89, 0xE5, 0x56}); // push rbp; mov rbp, rsp; push rsi
+      for (size_t i = 0; i < params; i++)
+      {
+        // movsd xmm0, [rdi + 8i]
+        assembler.emit({0xF2, 0x0F, 0x10, 0x87});
+        assembler.emit32(static_cast<uint32_t>(8 * i));
+        assembler.push();
+      }
+      assembler.call(units[0].entry);
+      assembler.emit({0x48, 0x81, 0xC4}); // add rsp, imm32
+      assembler.emit32(static_cast<uint32_t>(8 * params));
+      assembler.emit({0x5E, 0xF2, 0x0F, 0x11, 0x06, 0x5D, 0xC3}); // pop rsi; movsd [rsi], xmm0; pop rbp; ret
+      assembler.link();
+      return true;
+    }
+
+  private:
+    struct Unit
+    {
+      const Function *function;
+      // Of its parameters and its result.
+      Representation representation;
+      int entry;
+      int body;
+    };
+
+    const Interpreter &interpreter;
+    Environment &globals;
+    uint32_t *depth;
+    int maxParams = 0;
+    std::vector<Unit> units;
+    // By representation.
+    std::unordered_map<const Function *, size_t> unitIndex[2];
+    std::vector<size_t> frameFixups;
+    size_t maxSlots = 0;
+
+    // Per unit being compiled.
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    std::vector<Representation> slotRepresentations;
+    size_t nextSlot = 0;
+    Representation returns = Representation::DOUBLE;
+    int bailout = -1;
+    int epilogue = -1;
+
+    int unitFor(const Function *function, Representation representation)
+    {
+      auto &index = unitIndex[static_cast<int>(representation)];
+      auto it = index.find(function);
+      if (it != index.end())
+        return static_cast<int>(it->second);
+      units.push_back(Unit{function, representation, assembler.newLabel(), assembler.newLabel()});
+      index[function] = units.size() - 1;
+      return static_cast<int>(units.size()) - 1;
+    }
+
+    static int32_t offset(int slot)
+    {
+      return -8 * (slot + 1);
+    }
+
+    int newSlot(Representation representation)
+    {
+      int slot = static_cast<int>(nextSlot++);
+      maxSlots = std::max(maxSlots, nextSlot);
+      slotRepresentations.resize(nextSlot);
+      slotRepresentations[slot] = representation;
+      return slot;
+    }
+
+    // mov rcx, &depth
+    void loadDepthAddress()
+    {
+      assembler.emit({0x48, 0xB9});
+      assembler.emit64(reinterpret_cast<uint64_t>(depth));
+    }
+
+    bool compileUnit(Unit unit)
+    {
+      const Function *function = unit.function;
+      if (static_cast<int>(function->params.size()) > maxParams || !isNumeric(function->returnType))
+        return false;
+      // Compiled code only ever holds numbers, so it satisfies `num`
+      // annotations without checks and can never satisfy the others.
+      for (Annotation annotation : function->paramTypes)
+      {
+        if (!isNumeric(annotation))
+          return false;
+      }
+
+      bailout = assembler.newLabel();
+      epilogue = assembler.newLabel();
+      scopes.assign(1, {});
+      nextSlot = 0;
+      returns = unit.representation;
+
+      assembler.bind(unit.entry);
+      assembler.emit({0x55, 0x48, 0x89, 0xE5, 0x48, 0x81, 0xEC}); // push rbp; mov rbp, rsp; sub rsp, imm32
+      frameFixups.push_back(assembler.code.size());
+      assembler.emit32(0);
+      loadDepthAddress();
+      assembler.emit({0xFF, 0x01, 0x81, 0x39}); // inc dword [rcx]; cmp dword [rcx], imm32
+      assembler.emit32(MAX_DEPTH);
+      assembler.jumpIf(Assembler::JG, bailout);
+
+      size_t params = function->params.size();
+      for (size_t i = 0; i < params; i++)
+      {
+        int slot = newSlot(unit.representation);
+        scopes.back()[function->params[i].lexeme] = slot;
+        assembler.load(0, static_cast<int32_t>(16 + 8 * (params - 1 - i)));
+        assembler.store(offset(slot));
+      }
+      assembler.bind(unit.body);
+
+      for (const auto &stmt : function->body)
+      {
+        if (!statement(stmt.get()))
+          return false;
+      }
+
+      // Falling off the end returns no value.
+      assembler.bind(bailout);
+      assembler.emit({0xB8, 0x01, 0x00, 0x00, 0x00}); // mov eax, 1
+      int exit = assembler.newLabel();
+      assembler.jump(exit);
+      assembler.bind(epilogue);
+      assembler.emit({0x31, 0xC0}); // xor eax, eax
+      assembler.bind(exit);
+      loadDepthAddress();
+      assembler.emit({0xFF, 0x09, 0x48, 0x89, 0xEC, 0x5D, 0xC3}); // dec dword [rcx]; mov rsp, rbp; pop rbp; ret
+      return true;
+    }
+
+    int lookup(const std::string &name, int distance) const
+    {
+      int index = static_cast<int>(scopes.size()) - 1 - distance;
+      if (distance < 0 || index < 0)
+        return -1;
+      auto it = scopes[index].find(name);
+      return it != scopes[index].end() ? it->second : -1;
+    }
+
+    bool statements(const std::vector<StmtPtr> &stmts)
+    {
+      for (const auto &stmt : stmts)
+      {
+        if (!statement(stmt.get()))
+          return false;
+      }
+      return true;
+    }
+
+    bool statement(const Stmt *stmt)
+    {
+      if (auto *expression = dynamic_cast<const Expression *>(stmt))
+      {
+        Representation representation;
+        return number(expression->expression.get(), representation);
+      }
+      if (auto *var = dynamic_cast<const Var *>(stmt))
+      {
+        Representation representation;
+        if (var->initializer == nullptr || !isNumeric(var->annotation) || !number(var->initializer.get(), representation))
+          return false;
+        int slot = newSlot(representation);
+        assembler.store(offset(slot));
+        scopes.back()[var->name.lexeme] = slot;
+        return true;
+      }
+      if (auto *block = dynamic_cast<const Block *>(stmt))
+      {
+        scopes.emplace_back();
+        bool compiled = statements(block->statements);
+        scopes.pop_back();
+        return compiled;
+      }
+      if (auto *ifStmt = dynamic_cast<const If *>(stmt))
+      {
+        int elseLabel = assembler.newLabel();
+        if (!branch(ifStmt->condition.get(), false, elseLabel) || !statement(ifStmt->thenBranch.get()))
+          return false;
+        if (ifStmt->elseBranch == nullptr)
+        {
+          assembler.bind(elseLabel);
+          return true;
+        }
+        int end = assembler.newLabel();
+        assembler.jump(end);
+        assembler.bind(elseLabel);
+        if (!statement(ifStmt->elseBranch.get()))
+          return false;
+        assembler.bind(end);
+        return true;
+      }
+      if (auto *whileStmt = dynamic_cast<const While *>(stmt))
+      {
+        int top = assembler.newLabel();
+        int end = assembler.newLabel();
+        assembler.bind(top);
+        if (!branch(whileStmt->condition.get(), false, end) || !statement(whileStmt->body.get()))
+          return false;
+        assembler.jump(top);
+        assembler.bind(end);
+        return true;
+      }
+      if (auto *forLoop = dynamic_cast<const ForLoop *>(stmt))
+      {
+        int top = assembler.newLabel();
+        int end = assembler.newLabel();
+        assembler.bind(top);
+        if (!branch(forLoop->condition.get(), false, end))
+          return false;
+        scopes.emplace_back();
+        Representation representation;
+        bool compiled = statements(forLoop->body) &&
+                        (forLoop->increment == nullptr || number(forLoop->increment.get(), representation));
+        scopes.pop_back();
+        if (!compiled)
+          return false;
+        assembler.jump(top);
+        assembler.bind(end);
+        return true;
+      }
+      if (auto *counted = dynamic_cast<const CountedLoop *>(stmt))
+      {
+        return countedLoop(counted);
+      }
+      if (auto *invariantLoop = dynamic_cast<const InvariantLoop *>(stmt))
+      {
+        return statement(invariantLoop->loop.get());
+      }
+      if (auto *ret = dynamic_cast<const Return *>(stmt))
+      {
+        if (ret->value == nullptr)
+        {
+          assembler.jump(bailout);
+          return true;
+        }
+        // The value must be of the kind the function was called with.
+        Representation representation;
+        if (auto *call = dynamic_cast<const Call *>(ret->value.get()))
+        {
+          return compileCall(call->callee.get(), call->arguments, nullptr, true, representation) &&
+                 representation == returns;
+        }
+        if (!number(ret->value.get(), representation) || representation != returns)
+          return false;
+        assembler.jump(epilogue);
+        return true;
+      }
+      return false;
+    }
+
+    bool countedLoop(const CountedLoop *stmt)
+    {
+      if (stmt->start == nullptr)
+        return false;
+      scopes.emplace_back();
+      Representation start, bound;
+      if (!number(stmt->start.get(), start))
+        return false;
+      int counter = newSlot(start);
+      assembler.store(offset(counter));
+      scopes.back()[stmt->name.lexeme] = counter;
+      if (!number(stmt->limit.get(), bound))
+        return false;
+      // Like the interpreter, count in integers only when the bounds and
+      // the step all are.
+      bool integer = start == Representation::INTEGER && bound == Representation::INTEGER &&
+                     stmt->step == std::floor(stmt->step) && std::fabs(stmt->step) < 0x1p31;
+      Representation representation = integer ? Representation::INTEGER : Representation::DOUBLE;
+      slotRepresentations[counter] = representation;
+      int limit = newSlot(representation);
+      assembler.store(offset(limit));
+
+      int top = assembler.newLabel();
+      int end = assembler.newLabel();
+      assembler.bind(top);
+      assembler.load(0, offset(counter));
+      assembler.load(1, offset(limit));
+      if (!compare(stmt->op.type, false, end))
+        return false;
+      scopes.emplace_back();
+      bool compiled = statements(stmt->body);
+      scopes.pop_back();
+      if (!compiled)
+        return false;
+      assembler.load(0, offset(counter));
+      assembler.loadConstant(1, stmt->stepOp.type == TokenType::MINUS ? -stmt->step : stmt->step);
+      assembler.emit({0xF2, 0x0F, 0x58, 0xC1}); // addsd xmm0, xmm1
+      if (representation == Representation::INTEGER)
+        checkInteger();
+      assembler.store(offset(counter));
+      assembler.jump(top);
+      assembler.bind(end);
+      scopes.pop_back();
+      return true;
+    }
+
+    // Emits code leaving expr's value in xmm0, and sets representation to
+    // the kind of number the interpreter would hold.
+    bool number(const Expr *expr, Representation &representation)
+    {
+      if (auto *literal = dynamic_cast<const Literal *>(expr))
+      {
+        if (!isNumber(literal->value))
+          return false;
+        if (auto *integer = std::get_if<int64_t>(&literal->value))
+        {
+          if (!exactInteger(*integer))
+            return false;
+          representation = Representation::INTEGER;
+        }
+        else
+        {
+          representation = Representation::DOUBLE;
+        }
+        assembler.loadConstant(0, toDouble(literal->value));
+        return true;
+      }
+      if (auto *grouping = dynamic_cast<const Grouping *>(expr))
+      {
+        return number(grouping->expression.get(), representation);
+      }
+      if (auto *invariant = dynamic_cast<const Invariant *>(expr))
+      {
+        return number(invariant->expression.get(), representation);
+      }
+      if (auto *variable = dynamic_cast<const Variable *>(expr))
+      {
+        int slot = lookup(variable->name.lexeme, interpreter.resolvedDepth(variable));
+        if (slot < 0)
+          return false;
+        representation = slotRepresentations[slot];
+        assembler.load(0, offset(slot));
+        return true;
+      }
+      // A local keeps the kind of number it was declared with.
+      if (auto *assign = dynamic_cast<const Assign *>(expr))
+      {
+        int slot = lookup(assign->name.lexeme, interpreter.resolvedDepth(assign));
+        if (slot < 0 || !number(assign->value.get(), representation) || representation != slotRepresentations[slot])
+          return false;
+        assembler.store(offset(slot));
+        return true;
+      }
+      if (auto *assignOp = dynamic_cast<const AssignOp *>(expr))
+      {
+        int slot = lookup(assignOp->name.lexeme, assignOp->depth);
+        Representation value;
+        if (slot < 0 || !number(assignOp->value.get(), value))
+          return false;
+        assembler.emit({0x66, 0x0F, 0x28, 0xC8}); // movapd xmm1, xmm0
+        assembler.load(0, offset(slot));
+        if (!arithmetic(assignOp->op.type, slotRepresentations[slot], value, representation) ||
+            representation != slotRepresentations[slot])
+          return false;
+        assembler.store(offset(slot));
+        return true;
+      }
+      if (auto *unary = dynamic_cast<const Unary *>(expr))
+      {
+        if (unary->op.type != TokenType::MINUS || !number(unary->right.get(), representation))
+          return false;
+        if (representation == Representation::INTEGER)
+        {
+          // The interpreter negates integer 0 to the double -0.
+          assembler.emit({0x66, 0x48, 0x0F, 0x7E, 0xC0}); // movq rax, xmm0
+          assembler.emit({0x48, 0x85, 0xC0});             // test rax, rax
+          assembler.jumpIf(Assembler::JE, bailout);
+        }
+        assembler.loadConstant(1, -0.0);
+        assembler.emit({0x66, 0x0F, 0x57, 0xC1}); // xorpd xmm0, xmm1
+        return true;
+      }
+      if (auto *binary = dynamic_cast<const Binary *>(expr))
+      {
+        Representation left, right;
+        if (!number(binary->left.get(), left))
+          return false;
+        assembler.push();
+        if (!number(binary->right.get(), right))
+          return false;
+        assembler.popLeft();
+        return arithmetic(binary->op.type, left, right, representation);
+      }
+      if (auto *conditional = dynamic_cast<const Conditional *>(expr))
+      {
+        int elseLabel = assembler.newLabel();
+        int end = assembler.newLabel();
+        Representation otherwise;
+        if (!branch(conditional->condition.get(), false, elseLabel) ||
+            !number(conditional->thenBranch.get(), representation))
+          return false;
+        assembler.jump(end);
+        assembler.bind(elseLabel);
+        if (!number(conditional->elseBranch.get(), otherwise) || otherwise != representation)
+          return false;
+        assembler.bind(end);
+        return true;
+      }
+      if (auto *call = dynamic_cast<const Call *>(expr))
+      {
+        return compileCall(call->callee.get(), call->arguments, nullptr, false, representation);
+      }
+      if (auto *inlined = dynamic_cast<const InlinedCall *>(expr))
+      {
+        return compileCall(inlined->callee.get(), inlined->arguments, inlined->target, false, representation);
+      }
+      return false;
+    }
+
+    // Whether an integer is one compiled code can hold: below 2^53 in
+    // magnitude, so sums and differences of two stay exact up to the
+    // checks that follow them.
+    static bool exactInteger(int64_t value)
+    {
+      return value > -(int64_t(1) << 53) && value < (int64_t(1) << 53);
+    }
+
+    // xmm0 = xmm0 op xmm1. Integer operands give an integer result, which
+    // bails out wherever the interpreter's would not be one compiled code
+    // holds.
+    bool arithmetic(TokenType op, Representation left, Representation right, Representation &representation)
+    {
+      bool integer = left == Representation::INTEGER && right == Representation::INTEGER;
+      representation = integer ? Representation::INTEGER : Representation::DOUBLE;
+      if (integer && op == TokenType::SLASH)
+      {
+        integerDivide();
+        return true;
+      }
+      if (!arithmetic(op))
+        return false;
+      if (integer)
+        checkInteger();
+      return true;
+    }
+
+    bool arithmetic(TokenType op)
+    {
+      uint8_t opcode;
+      switch (op)
+      {
+      case TokenType::PLUS:
+        opcode = 0x58;
+        break;
+      case TokenType::MINUS:
+        opcode = 0x5C;
+        break;
+      case TokenType::STAR:
+        opcode = 0x59;
+        break;
+      case TokenType::SLASH:
+        opcode = 0x5E;
+        break;
+      default:
+        return false;
+      }
+      assembler.emit({0xF2, 0x0F, opcode, 0xC1});
+      return true;
+    }
+
+    // Bails out unless xmm0 is below 2^53 in magnitude, which rounding
+    // cannot reach from an exact result that is not, and is not -0, which
+    // the interpreter's integer arithmetic turns into a double.
+    void checkInteger()
+    {
+      int nonzero = assembler.newLabel();
+      assembler.emit({0x66, 0x48, 0x0F, 0x7E, 0xC0}); // movq rax, xmm0
+      assembler.emit({0x48, 0x89, 0xC1});             // mov rcx, rax
+      assembler.emit({0x48, 0x0F, 0xBA, 0xF1, 0x3F}); // btr rcx, 63
+      assembler.emit({0x48, 0xBA});                   // mov rdx, imm64
+      assembler.emit64(0x4340000000000000);           // 2^53
+      assembler.emit({0x48, 0x39, 0xD1});             // cmp rcx, rdx
+      assembler.jumpIf(Assembler::JAE, bailout);
+      assembler.emit({0x48, 0x85, 0xC9}); // test rcx, rcx
+      assembler.jumpIf(Assembler::JNE, nonzero);
+      assembler.emit({0x48, 0x85, 0xC0}); // test rax, rax
+      assembler.jumpIf(Assembler::JNE, bailout);
+      assembler.bind(nonzero);
+    }
+
+    // xmm0 = xmm0 / xmm1 on integers, bailing out where the interpreter's
+    // quotient is a double: division by zero, an inexact quotient, or -0.
+    void integerDivide()
+    {
+      int nonzero = assembler.newLabel();
+      assembler.emit({0xF2, 0x48, 0x0F, 0x2C, 0xC0}); // cvttsd2si rax, xmm0
+      assembler.emit({0xF2, 0x48, 0x0F, 0x2C, 0xC9}); // cvttsd2si rcx, xmm1
+      assembler.emit({0x48, 0x85, 0xC9});             // test rcx, rcx
+      assembler.jumpIf(Assembler::JE, bailout);
+      assembler.emit({0x48, 0x99, 0x48, 0xF7, 0xF9}); // cqo; idiv rcx
+      assembler.emit({0x48, 0x85, 0xD2});             // test rdx, rdx
+      assembler.jumpIf(Assembler::JNE, bailout);
+      assembler.emit({0x48, 0x85, 0xC0}); // test rax, rax
+      assembler.jumpIf(Assembler::JNE, nonzero);
+      assembler.emit({0x48, 0x85, 0xC9}); // test rcx, rcx
+      assembler.jumpIf(Assembler::JS, bailout);
+      assembler.bind(nonzero);
+      assembler.emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0}); // cvtsi2sd xmm0, rax
+    }
+
+    // Jumps to label when expr's truthiness equals when. Numbers are always
+    // truthy, so only comparisons, logic and boolean literals can fail.
+    bool branch(const Expr *expr, bool when, int label)
+    {
+      if (auto *literal = dynamic_cast<const Literal *>(expr))
+      {
+        if (std::holds_alternative<std::string>(literal->value))
+          return false;
+        bool truthy = isNumber(literal->value) ||
+                      (std::holds_alternative<bool>(literal->value) && std::get<bool>(literal->value));
+        if (truthy == when)
+          assembler.jump(label);
+        return true;
+      }
+      if (auto *grouping = dynamic_cast<const Grouping *>(expr))
+      {
+        return branch(grouping->expression.get(), when, label);
+      }
+      if (auto *unary = dynamic_cast<const Unary *>(expr))
+      {
+        if (unary->op.type == TokenType::BANG)
+          return branch(unary->right.get(), !when, label);
+      }
+      if (auto *logical = dynamic_cast<const Logical *>(expr))
+      {
+        // `a and b` is truthy when both are; `a or b` when either is.
+        bool all = logical->op.type == TokenType::AND;
+        if (when != all)
+        {
+          return branch(logical->left.get(), when, label) && branch(logical->right.get(), when, label);
+        }
+        int skip = assembler.newLabel();
+        if (!branch(logical->left.get(), !when, skip) || !branch(logical->right.get(), when, label))
+          return false;
+        assembler.bind(skip);
+        return true;
+      }
+      if (auto *binary = dynamic_cast<const Binary *>(expr))
+      {
+        // Integers below 2^53 compare exactly as doubles, with each other
+        // and with doubles.
+        if (isComparison(binary->op.type))
+        {
+          Representation representation;
+          if (!number(binary->left.get(), representation))
+            return false;
+          assembler.push();
+          if (!number(binary->right.get(), representation))
+            return false;
+          assembler.popLeft();
+          return compare(binary->op.type, when, label);
+        }
+      }
+      if (auto *compareVariable = dynamic_cast<const CompareVariable *>(expr))
+      {
+        int slot = lookup(compareVariable->name.lexeme, compareVariable->depth);
+        Representation representation;
+        if (slot < 0 || !number(compareVariable->right.get(), representation))
+          return false;
+        assembler.emit({0x66, 0x0F, 0x28, 0xC8}); // movapd xmm1, xmm0
+        assembler.load(0, offset(slot));
+        return compare(compareVariable->op.type, when, label);
+      }
+      Representation representation;
+      if (!number(expr, representation))
+        return false;
+      if (when)
+        assembler.jump(label);
+      return true;
+    }
+
+    static bool isNumeric(Annotation annotation)
+    {
+      return annotation == Annotation::NONE || annotation == Annotation::NUM;
+    }
+
+    static bool isComparison(TokenType op)
+    {
+      return op == TokenType::LESS || op == TokenType::LESS_EQUAL || op == TokenType::GREATER ||
+             op == TokenType::GREATER_EQUAL || op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL;
+    }
+
+    // Compares xmm0 (left) with xmm1 (right). ucomisd reports unordered
+    // (NaN) as ZF = PF = CF = 1, which every test below treats as false.
+    bool compare(TokenType op, bool when, int label)
+    {
+      const uint8_t leftWithRight[] = {0x66, 0x0F, 0x2E, 0xC1};  // ucomisd xmm0, xmm1
+      const uint8_t rightWithLeft[] = {0x66, 0x0F, 0x2E, 0xC8};  // ucomisd xmm1, xmm0
+      auto ucomisd = [&](const uint8_t *bytes)
+      {
+        assembler.code.insert(assembler.code.end(), bytes, bytes + 4);
+      };
+
+      switch (op)
+      {
+      case TokenType::LESS:
+        ucomisd(rightWithLeft);
+        assembler.jumpIf(when ? Assembler::JA : Assembler::JBE, label);
+        return true;
+      case TokenType::LESS_EQUAL:
+        ucomisd(rightWithLeft);
+        assembler.jumpIf(when ? Assembler::JAE : Assembler::JB, label);
+        return true;
+      case TokenType::GREATER:
+        ucomisd(leftWithRight);
+        assembler.jumpIf(when ? Assembler::JA : Assembler::JBE, label);
+        return true;
+      case TokenType::GREATER_EQUAL:
+        ucomisd(leftWithRight);
+        assembler.jumpIf(when ? Assembler::JAE : Assembler::JB, label);
+        return true;
+      case TokenType::EQUAL_EQUAL:
+      case TokenType::BANG_EQUAL:
+      {
+        ucomisd(leftWithRight);
+        // Equal is ZF = 1 with PF = 0.
+        if (when == (op == TokenType::EQUAL_EQUAL))
+        {
+          int skip = assembler.newLabel();
+          assembler.jumpIf(Assembler::JP, skip);
+          assembler.jumpIf(Assembler::JE, label);
+          assembler.bind(skip);
+        }
+        else
+        {
+          assembler.jumpIf(Assembler::JP, label);
+          assembler.jumpIf(Assembler::JNE, label);
+        }
+        return true;
+      }
+      default:
+        return false;
+      }
+    }
+
+    // Calls a top-level function by name. In tail position the arguments
+    // replace the current frame's parameters and control jumps to the
+    // callee's body, so tail recursion runs in constant stack. The callee
+    // is compiled for the kind of its arguments, which must all be the
+    // same, and returns that kind.
+    bool compileCall(const Expr *callee, const std::vector<ExprPtr> &arguments, const Function *expected, bool tail,
+                     Representation &representation)
+    {
+      auto *variable = dynamic_cast<const Variable *>(callee);
+      if (variable == nullptr || interpreter.resolvedDepth(variable) != -1)
+        return false;
+
+      const Function *function = globalFunction(variable->name.lexeme);
+      if (function == nullptr || function->params.size() != arguments.size() ||
+          (expected != nullptr && function != expected))
+        return false;
+      bool guarded = false;
+      for (const auto &guard : guards)
+      {
+        guarded = guarded || guard.first == variable->name.lexeme;
+      }
+      if (!guarded)
+        guards.emplace_back(variable->name.lexeme, function);
+
+      representation = Representation::INTEGER;
+      for (size_t i = 0; i < arguments.size(); i++)
+      {
+        Representation argument;
+        if (!number(arguments[i].get(), argument) || (i > 0 && argument != representation))
+          return false;
+        representation = argument;
+        assembler.push();
+      }
+      int index = unitFor(function, representation);
+
+      if (tail)
+      {
+        for (size_t i = arguments.size(); i-- > 0;)
+        {
+          assembler.pop(0);
+          assembler.store(offset(static_cast<int>(i)));
+        }
+        assembler.jump(units[index].body);
+        return true;
+      }
+
+      assembler.call(units[index].entry);
+      if (!arguments.empty())
+      {
+        assembler.emit({0x48, 0x81, 0xC4}); // add rsp, imm32
+        assembler.emit32(static_cast<uint32_t>(8 * arguments.size()));
+      }
+      assembler.emit({0x85, 0xC0}); // test eax, eax
+      assembler.jumpIf(Assembler::JNE, bailout);
+      return true;
+    }
+
+    const Function *globalFunction(const std::string &name) const
+    {
+      const std::any *value = globals.find(name);
+      auto *function = value != nullptr ? std::any_cast<std::shared_ptr<LoxFunction>>(value) : nullptr;
+      if (function == nullptr || (*function)->initializer())
+        return nullptr;
+      return (*function)->getDeclaration();
+    }
+  };
+#endif
+
+  Jit::~Jit()
+  {
+#ifdef CPPLOX_JIT
+    for (const auto &page : pages)
+    {
+      munmap(page.first, page.second);
+    }
+#endif
+  }
+
+  bool Jit::call(const LoxFunction &function, const std::vector<std::any> &arguments, std::any &result)
+  {
+#ifdef CPPLOX_JIT
+    if (function.initializer())
+      return false;
+
+    // Compiled code holds integers in doubles, so they must be ones a
+    // double holds exactly, and is compiled either for all-integer or for
+    // all-double arguments.
+    Representation representation = Representation::INTEGER;
+    double values[MAX_PARAMS];
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+      Representation argument;
+      if (const auto *integer = std::any_cast<int64_t>(&arguments[i]))
+      {
+        if (*integer <= -(int64_t(1) << 53) || *integer >= (int64_t(1) << 53))
+          return false;
+        values[i] = static_cast<double>(*integer);
+        argument = Representation::INTEGER;
+      }
+      else if (const auto *value = std::any_cast<double>(&arguments[i]))
+      {
+        values[i] = *value;
+        argument = Representation::DOUBLE;
+      }
+      else
+      {
+        return false;
+      }
+      if (i > 0 && argument != representation)
+        return false;
+      representation = argument;
+    }
+
+    Entry &entry = entries[static_cast<int>(representation)][function.getDeclaration()];
+    if (entry.state == State::FAILED)
+      return false;
+    if (entry.state == State::COLD)
+    {
+      if (++entry.calls < HOT_CALL_THRESHOLD)
+        return false;
+      if (!compile(function.getDeclaration(), representation, entry))
+      {
+        entry.state = State::FAILED;
+        return false;
+      }
+      entry.state = State::COMPILED;
+    }
+    if (!guardsHold(entry))
+      return false;
+
+    double value;
+    if (entry.code(values, &value) != 0)
+    {
+      entry.state = State::FAILED;
+      return false;
+    }
+    if (representation == Representation::INTEGER)
+      result = static_cast<int64_t>(value);
+    else
+      result = value;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void Jit::seed(const Function *function, uint64_t calls)
+  {
+    for (auto &byRepresentation : entries)
+    {
+      Entry &entry = byRepresentation[function];
+      if (entry.state == State::COLD)
+        entry.calls = static_cast<int>(std::min<uint64_t>(calls, HOT_CALL_THRESHOLD - 1));
+    }
+  }
+
+  bool Jit::guardsHold(const Entry &entry)
+  {
+    for (const auto &guard : entry.guards)
+    {
+      const std::any *value = globals->find(guard.first);
+      auto *function = value != nullptr ? std::any_cast<std::shared_ptr<LoxFunction>>(value) : nullptr;
+      if (function == nullptr || (*function)->getDeclaration() != guard.second)
+        return false;
+    }
+    return true;
+  }
+
+  bool Jit::compile(const Function *function, Representation representation, Entry &entry)
+  {
+#ifdef CPPLOX_JIT
+    JitCompiler compiler(interpreter, *globals, &depth);
+    if (!compiler.compile(function, representation, MAX_PARAMS))
+      return false;
+
+    const std::vector<uint8_t> &code = compiler.assembler.code;
+    size_t size = code.size();
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+      return false;
+    std::memcpy(memory, code.data(), size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+      munmap(memory, size);
+      return false;
+    }
+    pages.emplace_back(memory, size);
+
+    entry.code = reinterpret_cast<EntryPoint>(static_cast<uint8_t *>(memory) + compiler.assembler.position(compiler.root));
+    entry.guards = std::move(compiler.guards);
+    return true;
+#else
+    return false;
+#endif
+  }
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "cpplox/listlib.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/loxstring.h"
+#include "cpplox/number.h"
+#include "cpplox/pdqsort.h"
+
+namespace CppLox
+{
+  // Numbers in order with NaNs last, comparing an integer and a double
+  // exactly so the order stays a strict weak ordering past 2^53.
+  static bool numberLess(const std::any &left, const std::any &right)
+  {
+    const auto *a = std::any_cast<int64_t>(&left);
+    const auto *b = std::any_cast<int64_t>(&right);
+    if (a != nullptr && b != nullptr)
+      return *a < *b;
+    if (a == nullptr && std::isnan(*std::any_cast<double>(&left)))
+      return false;
+    if (b == nullptr && std::isnan(*std::any_cast<double>(&right)))
+      return true;
+    if (a != nullptr)
+      return compareMixed(*a, *std::any_cast<double>(&right)) < 0;
+    if (b != nullptr)
+      return compareMixed(*b, *std::any_cast<double>(&left)) > 0;
+    return *std::any_cast<double>(&left) < *std::any_cast<double>(&right);
+  }
+
+  // Sorts elements that all hold a T by sorting the unboxed values, which
+  // moves eight bytes per swap and compares without any_cast. NaNs go
+  // last.
+  template <typename T>
+  static void sortUnboxed(std::vector<std::any> &elements)
+  {
+    std::vector<T> values;
+    values.reserve(elements.size());
+    for (const std::any &element : elements)
+      values.push_back(*std::any_cast<T>(&element));
+    auto ordered = std::partition(values.begin(), values.end(), [](T value)
+                                  { return value == value; });
+    pdqsort(values.begin(), ordered, std::less<T>());
+    for (size_t i = 0; i < values.size(); i++)
+      *std::any_cast<T>(&elements[i]) = values[i];
+  }
+
+  void LoxList::sort()
+  {
+    // The element types are checked once, so each comparison can cast
+    // without checking.
+    bool integers = true;
+    bool doubles = true;
+    bool numbers = true;
+    bool strings = true;
+    for (const std::any &element : elements)
+    {
+      bool integer = std::any_cast<int64_t>(&element) != nullptr;
+      bool number = std::any_cast<double>(&element) != nullptr;
+      integers = integers && integer;
+      doubles = doubles && number;
+      numbers = numbers && (integer || number);
+      strings = strings && std::any_cast<LoxStringRef>(&element) != nullptr;
+    }
+    if (integers)
+      sortUnboxed<int64_t>(elements);
+    else if (doubles)
+      sortUnboxed<double>(elements);
+    else if (numbers)
+      pdqsort(elements.begin(), elements.end(), numberLess);
+    else if (strings)
+      pdqsort(elements.begin(), elements.end(), [](const std::any &a, const std::any &b)
+              { return (*std::any_cast<LoxStringRef>(&a))->view() < (*std::any_cast<LoxStringRef>(&b))->view(); });
+    else
+      throw NativeError("Only lists of numbers or of strings can be sorted.");
+  }
+
+  static LoxList &listArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&arguments[index]);
+    if (list == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a list.");
+    return **list;
+  }
+
+  static std::any makeList(const std::vector<std::any> &arguments)
+  {
+    return std::make_shared<LoxList>();
+  }
+
+  static std::any push(const std::vector<std::any> &arguments)
+  {
+    listArgument(arguments, 0, "push").elements.push_back(arguments[1]);
+    return std::any();
+  }
+
+  static std::any pop(const std::vector<std::any> &arguments)
+  {
+    std::vector<std::any> &elements = listArgument(arguments, 0, "pop").elements;
+    if (elements.empty())
+      throw NativeError("Cannot pop from an empty list.");
+    std::any last = std::move(elements.back());
+    elements.pop_back();
+    return last;
+  }
+
+  static const NativeEntry LIST_LIBRARY[] = {
+      {"List", 0, makeList},
+      {"push", 2, push},
+      {"pop", 1, pop},
+  };
+
+  void defineListLibrary(Environment &globals)
+  {
+    defineNatives(globals, LIST_LIBRARY);
+  }
+
+  bool isListLibraryFunction(const std::string &name)
+  {
+    return definesNative(LIST_LIBRARY, name);
+  }
+}
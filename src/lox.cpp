@@ -12,6 +12,10 @@
 #include "cpplox/expr.h"
 #include "cpplox/stmt.h"
 #include "cpplox/astprinter.h"
+#include "cpplox/astcache.h"
+#include "cpplox/cemitter.h"
+#include "cpplox/optimizer.h"
+#include "cpplox/profile.h"
 #include "cpplox/resolver.h"
 #include "cpplox/scanner.h"
 #include "cpplox/parser.h"
@@ -19,9 +23,19 @@
 #include "cpplox/tokentype.h"
 #include "cpplox/runtime_error.h"
 #include "cpplox/interpreter.h"
+#include "cpplox/output.h"
 
 static int hadError = false;
 static int hadRuntimeError = false;
+static bool fusedResolve = false;
+static std::string cacheDir;
+static bool optimize = true;
+static bool dumpOptimized = false;
+static bool jit = true;
+static std::string emitPath;
+static std::string profileIn;
+static std::string profileOut;
+static bool typeStats = false;
 
 namespace CppLox
 {
@@ -75,26 +89,111 @@ namespace CppLox
     std::cout << "Type: " << demangle(typeInfo.name()) << std::endl;
   }
 
-  void run(const std::string &source)
+  bool runFrontEnd(const std::string &source, std::vector<StmtPtr> &stmts)
   {
     Scanner scanner = Scanner(source);
     std::vector<Token> tokens = scanner.scanTokens();
 
-    Parser parser = Parser(tokens);
-    std::vector<StmtPtr> stmts = parser.parse();
+    if (fusedResolve)
+    {
+      Parser parser = Parser(tokens, interpreter);
+      stmts = parser.parse();
+    }
+    else
+    {
+      Parser parser = Parser(tokens);
+      stmts = parser.parse();
+    }
 
     if (hadError)
-      return;
+      return false;
     if (hadRuntimeError)
+      return false;
+
+    if (!fusedResolve)
+    {
+      Resolver resolver = Resolver(interpreter);
+      resolver.resolve(stmts);
+    }
+
+    return !hadError;
+  }
+
+  void run(const std::string &source, bool wholeProgram)
+  {
+    std::vector<StmtPtr> stmts;
+    if (wholeProgram && !cacheDir.empty())
+    {
+      AstCache cache(cacheDir, interpreter);
+      if (!cache.load(source, stmts))
+      {
+        if (!runFrontEnd(source, stmts))
+          return;
+        cache.store(source, stmts);
+      }
+    }
+    else if (!runFrontEnd(source, stmts))
+    {
       return;
+    }
 
-    Resolver resolver = Resolver(interpreter);
-    resolver.resolve(stmts);
+    // Also run on cached trees: it marks the stores that need a check.
+    TypeChecker checker(interpreter);
+    if (!checker.check(stmts))
+      return;
 
-    if (hadError)
+    if (!emitPath.empty())
+    {
+      std::ofstream out(emitPath);
+      CEmitter emitter(interpreter);
+      if (!out.is_open() || !emitter.emit(stmts, out))
+      {
+        std::cout << "Could not emit C to " << emitPath << std::endl;
+        hadError = true;
+      }
       return;
+    }
+
+    Optimizer optimizer(interpreter);
+    optimizer.wholeProgram = wholeProgram;
+    auto profile = std::make_shared<Profile>();
+    if (!profileIn.empty() || !profileOut.empty())
+    {
+      profile->index(stmts);
+    }
+    if (!profileIn.empty() && profile->load(profileIn, source))
+    {
+      optimizer.profile = profile;
+      interpreter->applyProfile(*profile);
+    }
+    if (!profileOut.empty())
+    {
+      interpreter->recordProfile(profile);
+    }
+
+    if (optimize)
+    {
+      optimizer.addStandardPasses();
+      if (typeStats)
+      {
+        optimizer.report = &std::cerr;
+      }
+      optimizer.optimize(stmts);
+    }
+
+    if (dumpOptimized)
+    {
+      AstPrinter printer;
+      std::cout << printer.print(stmts);
+      return;
+    }
 
     interpreter->interpret(stmts);
+
+    if (!profileOut.empty())
+    {
+      profile->save(profileOut, source);
+    }
   }
 
   bool readFile(const std::string &file_loc, std::string &content)
@@ -115,7 +214,7 @@ namespace CppLox
   {
     std::string contents;
     readFile(file_loc, contents);
-    run(contents);
+    run(contents, true);
     if (hadError)
     {
       std::exit(1);
@@ -129,7 +228,7 @@ namespace CppLox
       std::string line;
       if (std::getline(std::cin, line))
       {
-        run(line);
+        run(line, false);
       }
       else
       {
@@ -161,14 +260,73 @@ int main(int argc, char *argv[])
   // std::any res = printer.print(expression);
   // std::cout << std::any_cast<std::string>(res) << std::endl;
 
-  if (argc > 2)
+  CppLox::Output::init();
+
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--fused-resolve")
+    {
+      fusedResolve = true;
+    }
+    else if (arg == "--no-opt")
+    {
+      optimize = false;
+    }
+    else if (arg == "--dump-opt")
+    {
+      dumpOptimized = true;
+    }
+    else if (arg == "--type-stats")
+    {
+      typeStats = true;
+    }
+    else if (arg == "--no-jit")
+    {
+      jit = false;
+    }
+    else if (arg == "--emit-c" && i + 1 < argc)
+    {
+      emitPath = argv[++i];
+    }
+    else if (arg.rfind("--profile-in=", 0) == 0)
+    {
+      profileIn = arg.substr(std::string("--profile-in=").size());
+    }
+    else if (arg.rfind("--profile-out=", 0) == 0)
+    {
+      profileOut = arg.substr(std::string("--profile-out=").size());
+    }
+    else if (arg.rfind("--cache-dir=", 0) == 0)
+    {
+      cacheDir = arg.substr(std::string("--cache-dir=").size());
+    }
+    else if (arg.rfind("--", 0) == 0)
+    {
+      std::cout << "Unknown option " << arg << std::endl;
+      std::exit(64);
+    }
+    else
+    {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() > 1)
   {
-    std::cout << "test program" << std::endl;
-    std::exit(1);
+    std::cout << "Usage: cpplox [--fused-resolve] [--cache-dir=<dir>] [--no-opt] [--dump-opt] [--no-jit] [--type-stats] [--emit-c <file>] [--profile-in=<file>] [--profile-out=<file>] [script]" << std::endl;
+    std::exit(64);
   }
-  else if (argc == 2)
+
+  if (jit)
+  {
+    CppLox::interpreter->enableJit();
+  }
+
+  if (args.size() == 1)
   {
-    CppLox::runFile(argv[1]);
+    CppLox::runFile(args[0]);
   }
   else
   {
@@ -34,4 +34,10 @@ namespace CppLox
     fields[name.lexeme] = value;
     return value;
   }
+
+  std::any *LoxInstance::field(const std::string &name)
+  {
+    auto it = fields.find(name);
+    return it != fields.end() ? &it->second : nullptr;
+  }
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cpplox/loxmap.h"
+#include "cpplox/loxstring.h"
+#include "cpplox/number.h"
+
+namespace CppLox
+{
+  static const size_t GROUP_WIDTH = 16;
+  static const size_t NOT_FOUND = static_cast<size_t>(-1);
+  // Both have the sign bit set, which no full slot's byte has.
+  static const int8_t EMPTY = -128;
+  static const int8_t DELETED = -2;
+
+  // The control bytes of one group, each compared at once. Bit i of a
+  // mask is slot i of the group.
+  class Group
+  {
+  public:
+#if defined(__SSE2__)
+    explicit Group(const int8_t *control) : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(control))) {}
+
+    uint32_t match(int8_t byte) const
+    {
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+    }
+
+    // Empty or deleted slots.
+    uint32_t matchAvailable() const
+    {
+      return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+    }
+
+  private:
+    __m128i bytes;
+#else
+    // Plain loops the compiler can vectorize for other targets.
+    explicit Group(const int8_t *control) : control(control) {}
+
+    uint32_t match(int8_t byte) const
+    {
+      uint32_t mask = 0;
+      for (size_t i = 0; i < GROUP_WIDTH; i++)
+        mask |= static_cast<uint32_t>(control[i] == byte) << i;
+      return mask;
+    }
+
+    uint32_t matchAvailable() const
+    {
+      uint32_t mask = 0;
+      for (size_t i = 0; i < GROUP_WIDTH; i++)
+        mask |= static_cast<uint32_t>(control[i] < 0) << i;
+      return mask;
+    }
+
+  private:
+    const int8_t *control;
+#endif
+  };
+
+  // MurmurHash3's finalizer, so both the group index (high bits) and the
+  // control byte (low bits) depend on every bit of the input.
+  static uint64_t mix(uint64_t x)
+  {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  // Integral doubles hash as the integer, so 1 and 1.0 meet.
+  uint64_t LoxMap::hashKey(const std::any &key)
+  {
+    if (const auto *string = std::any_cast<LoxStringRef>(&key))
+      return mix((*string)->hash());
+    if (const auto *integer = std::any_cast<int64_t>(&key))
+      return mix(static_cast<uint64_t>(*integer));
+    if (const auto *number = std::any_cast<double>(&key))
+    {
+      if (*number >= -0x1p63 && *number < 0x1p63 && *number == std::floor(*number))
+        return mix(static_cast<uint64_t>(static_cast<int64_t>(*number)));
+      uint64_t bits;
+      std::memcpy(&bits, number, sizeof bits);
+      return mix(bits);
+    }
+    if (const auto *boolean = std::any_cast<bool>(&key))
+      return mix(*boolean ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL);
+    return mix(0x5851f42d4c957f2dULL);
+  }
+
+  bool LoxMap::sameKey(const std::any &a, const std::any &b)
+  {
+    if (const auto *string = std::any_cast<LoxStringRef>(&a))
+    {
+      const auto *other = std::any_cast<LoxStringRef>(&b);
+      return other != nullptr && *string == *other;
+    }
+    if (const auto *integer = std::any_cast<int64_t>(&a))
+    {
+      if (const auto *other = std::any_cast<int64_t>(&b))
+        return *integer == *other;
+      const auto *number = std::any_cast<double>(&b);
+      return number != nullptr && sameNumber(*integer, *number);
+    }
+    if (const auto *number = std::any_cast<double>(&a))
+    {
+      if (const auto *other = std::any_cast<double>(&b))
+        return *number == *other;
+      const auto *integer = std::any_cast<int64_t>(&b);
+      return integer != nullptr && sameNumber(*integer, *number);
+    }
+    if (const auto *boolean = std::any_cast<bool>(&a))
+    {
+      const auto *other = std::any_cast<bool>(&b);
+      return other != nullptr && *boolean == *other;
+    }
+    return b.type() == typeid(std::nullptr_t);
+  }
+
+  static int8_t controlByte(uint64_t hash)
+  {
+    return static_cast<int8_t>(hash & 0x7f);
+  }
+
+  const char *LoxMap::keyError(const std::any &value)
+  {
+    if (const auto *number = std::any_cast<double>(&value))
+      return std::isnan(*number) ? "Map keys cannot be NaN." : nullptr;
+    if (std::any_cast<LoxStringRef>(&value) != nullptr || std::any_cast<int64_t>(&value) != nullptr ||
+        std::any_cast<bool>(&value) != nullptr || value.type() == typeid(std::nullptr_t))
+      return nullptr;
+    return "Map keys must be strings, numbers, booleans or nil.";
+  }
+
+  // Probes whole groups, in triangular steps that visit every group of
+  // the power-of-two table. A group with an empty slot ends the search:
+  // the key would have been placed there.
+  size_t LoxMap::find(const std::any &key, uint64_t hash) const
+  {
+    if (control.empty())
+      return NOT_FOUND;
+    size_t mask = control.size() / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & mask;
+    int8_t byte = controlByte(hash);
+    for (size_t step = 1;; step++)
+    {
+      Group bytes(&control[group * GROUP_WIDTH]);
+      for (uint32_t matches = bytes.match(byte); matches != 0; matches &= matches - 1)
+      {
+        size_t slot = group * GROUP_WIDTH + __builtin_ctz(matches);
+        if (sameKey(slots[slot].key, key))
+          return slot;
+      }
+      if (bytes.match(EMPTY) != 0)
+        return NOT_FOUND;
+      group = (group + step) & mask;
+    }
+  }
+
+  size_t LoxMap::firstAvailable(uint64_t hash) const
+  {
+    size_t mask = control.size() / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & mask;
+    for (size_t step = 1;; step++)
+    {
+      uint32_t available = Group(&control[group * GROUP_WIDTH]).matchAvailable();
+      if (available != 0)
+        return group * GROUP_WIDTH + __builtin_ctz(available);
+      group = (group + step) & mask;
+    }
+  }
+
+  const std::any *LoxMap::get(const std::any &key) const
+  {
+    size_t slot = find(key, hashKey(key));
+    return slot == NOT_FOUND ? nullptr : &slots[slot].value;
+  }
+
+  void LoxMap::set(const std::any &key, std::any value)
+  {
+    uint64_t hash = hashKey(key);
+    size_t slot = find(key, hash);
+    if (slot != NOT_FOUND)
+    {
+      slots[slot].value = std::move(value);
+      return;
+    }
+
+    // At most 7/8 full, counting deleted slots, so every probe meets an
+    // empty slot. Grow when live keys would pass half that; otherwise
+    // rehashing in place just clears the tombstones.
+    size_t capacity = control.size();
+    if ((count + tombstones + 1) * 8 > capacity * 7)
+    {
+      size_t target = std::max(capacity, GROUP_WIDTH);
+      while ((count + 1) * 16 > target * 7)
+        target *= 2;
+      rehash(target);
+    }
+
+    slot = firstAvailable(hash);
+    if (control[slot] == DELETED)
+      tombstones--;
+    control[slot] = controlByte(hash);
+    slots[slot].key = key;
+    slots[slot].value = std::move(value);
+    count++;
+  }
+
+  bool LoxMap::remove(const std::any &key)
+  {
+    size_t slot = find(key, hashKey(key));
+    if (slot == NOT_FOUND)
+      return false;
+    slots[slot] = Slot();
+    count--;
+    // Searches stop at a group with an empty slot, so if this group has
+    // one the slot can be empty too rather than a tombstone.
+    if (Group(&control[slot - slot % GROUP_WIDTH]).match(EMPTY) != 0)
+    {
+      control[slot] = EMPTY;
+    }
+    else
+    {
+      control[slot] = DELETED;
+      tombstones++;
+    }
+    return true;
+  }
+
+  void LoxMap::rehash(size_t capacity)
+  {
+    std::vector<int8_t> oldControl(capacity, EMPTY);
+    std::vector<Slot> oldSlots(capacity);
+    oldControl.swap(control);
+    oldSlots.swap(slots);
+    tombstones = 0;
+    for (size_t i = 0; i < oldControl.size(); i++)
+    {
+      if (oldControl[i] < 0)
+        continue;
+      uint64_t hash = hashKey(oldSlots[i].key);
+      size_t slot = firstAvailable(hash);
+      control[slot] = controlByte(hash);
+      slots[slot] = std::move(oldSlots[i]);
+    }
+  }
+}
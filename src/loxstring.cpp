@@ -0,0 +1,139 @@
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "cpplox/loxstring.h"
+
+namespace CppLox
+{
+  // Concatenations shorter than this are copied at once: a rope node costs
+  // more than the copy.
+  static const size_t MIN_ROPE_LENGTH = 256;
+  // Substrings shorter than this are copied: a short copy is cheaper than
+  // keeping the whole base string alive.
+  static const size_t MIN_SLICE_LENGTH = 32;
+
+  // Interned strings by their characters. Entries do not hold a reference:
+  // a string leaves the table when its last reference goes. Never destroyed,
+  // so values released during static destruction still find it.
+  static std::unordered_map<std::string_view, LoxString *> &internTable()
+  {
+    static auto *table = new std::unordered_map<std::string_view, LoxString *>();
+    return *table;
+  }
+
+  LoxString::LoxString(std::string chars, bool interned)
+      : chars(std::move(chars)), hashCode(std::hash<std::string_view>()(this->chars)), size(this->chars.size()), isInterned(interned) {}
+
+  LoxString::LoxString(LoxString *left, LoxString *right)
+      : left(left), right(right), size(left->size + right->size), isInterned(false)
+  {
+    left->refs++;
+    right->refs++;
+  }
+
+  LoxString::LoxString(LoxString *base, size_t offset, size_t size)
+      : base(base), offset(offset), size(size), isInterned(false)
+  {
+    base->refs++;
+  }
+
+  // Walks the leaves left to right with an explicit stack: a string built
+  // by appending in a loop is a rope as deep as the loop ran.
+  void LoxString::flatten() const
+  {
+    if (base != nullptr)
+    {
+      chars.assign(view());
+      hashCode = std::hash<std::string_view>()(chars);
+      LoxString *operand = base;
+      base = nullptr;
+      if (--operand->refs == 0)
+        LoxStringRef::release(operand);
+      return;
+    }
+
+    chars.reserve(size);
+    std::vector<const LoxString *> pending{right, left};
+    while (!pending.empty())
+    {
+      const LoxString *node = pending.back();
+      pending.pop_back();
+      if (node->left != nullptr)
+      {
+        pending.push_back(node->right);
+        pending.push_back(node->left);
+      }
+      else
+      {
+        chars += node->view();
+      }
+    }
+    hashCode = std::hash<std::string_view>()(chars);
+
+    LoxString *operands[] = {left, right};
+    left = nullptr;
+    right = nullptr;
+    for (LoxString *operand : operands)
+    {
+      if (--operand->refs == 0)
+        LoxStringRef::release(operand);
+    }
+  }
+
+  LoxStringRef::LoxStringRef(std::string chars) : LoxStringRef(new LoxString(std::move(chars), false)) {}
+
+  LoxStringRef LoxStringRef::intern(std::string_view chars)
+  {
+    auto &table = internTable();
+    auto it = table.find(chars);
+    if (it != table.end())
+      return LoxStringRef(it->second);
+    auto *string = new LoxString(std::string(chars), true);
+    table.emplace(string->chars, string);
+    return LoxStringRef(string);
+  }
+
+  LoxStringRef LoxStringRef::slice(size_t offset, size_t length) const
+  {
+    if (length == string->size)
+      return *this;
+    std::string_view chars = string->view().substr(offset, length);
+    if (length < MIN_SLICE_LENGTH)
+      return LoxStringRef(std::string(chars));
+    // A slice of a slice reads from the same base.
+    LoxString *base = string->base != nullptr ? string->base : string;
+    return LoxStringRef(new LoxString(base, chars.data() - base->chars.data(), length));
+  }
+
+  // Iterative for the same reason as flatten: freeing a deep rope must not
+  // recurse once per level.
+  void LoxStringRef::release(LoxString *string)
+  {
+    std::vector<LoxString *> pending{string};
+    while (!pending.empty())
+    {
+      LoxString *node = pending.back();
+      pending.pop_back();
+      for (LoxString *operand : {node->left, node->right, node->base})
+      {
+        if (operand != nullptr && --operand->refs == 0)
+          pending.push_back(operand);
+      }
+      if (node->isInterned)
+        internTable().erase(node->chars);
+      delete node;
+    }
+  }
+
+  LoxStringRef operator+(const LoxStringRef &left, const LoxStringRef &right)
+  {
+    if (left.string->size + right.string->size >= MIN_ROPE_LENGTH)
+      return LoxStringRef(new LoxString(left.string, right.string));
+    std::string chars;
+    chars.reserve(left.string->size + right.string->size);
+    chars += left->view();
+    chars += right->view();
+    return LoxStringRef(std::move(chars));
+  }
+}
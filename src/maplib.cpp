@@ -0,0 +1,96 @@
+#include "cpplox/maplib.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/loxmap.h"
+#include "cpplox/persistent.h"
+
+namespace CppLox
+{
+  static LoxMap &mapArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *map = std::any_cast<std::shared_ptr<LoxMap>>(&arguments[index]);
+    if (map == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a map.");
+    return **map;
+  }
+
+  static const std::any &keyArgument(const std::vector<std::any> &arguments, size_t index)
+  {
+    if (const char *error = LoxMap::keyError(arguments[index]))
+      throw NativeError(error);
+    return arguments[index];
+  }
+
+  static std::any makeMap(const std::vector<std::any> &arguments)
+  {
+    return std::make_shared<LoxMap>();
+  }
+
+  // The value under the key in a map or a persistent map, or nullptr.
+  static const std::any *lookUp(const std::vector<std::any> &arguments, const char *function)
+  {
+    if (const auto *persistent = std::any_cast<std::shared_ptr<PersistentMap>>(&arguments[0]))
+      return (*persistent)->get(keyArgument(arguments, 1));
+    return mapArgument(arguments, 0, function).get(keyArgument(arguments, 1));
+  }
+
+  static std::any get(const std::vector<std::any> &arguments)
+  {
+    const std::any *value = lookUp(arguments, "get");
+    return value != nullptr ? *value : std::any(nullptr);
+  }
+
+  static std::any set(const std::vector<std::any> &arguments)
+  {
+    mapArgument(arguments, 0, "set").set(keyArgument(arguments, 1), arguments[2]);
+    return arguments[2];
+  }
+
+  static std::any has(const std::vector<std::any> &arguments)
+  {
+    return lookUp(arguments, "has") != nullptr;
+  }
+
+  static std::any remove(const std::vector<std::any> &arguments)
+  {
+    return mapArgument(arguments, 0, "remove").remove(keyArgument(arguments, 1));
+  }
+
+  // A list of the keys or the values of a map or a persistent map.
+  template <bool Keys>
+  static std::any entries(const std::vector<std::any> &arguments)
+  {
+    auto list = std::make_shared<LoxList>();
+    auto collect = [&list](const std::any &key, const std::any &value)
+    { list->elements.push_back(Keys ? key : value); };
+    if (const auto *persistent = std::any_cast<std::shared_ptr<PersistentMap>>(&arguments[0]))
+    {
+      list->elements.reserve((*persistent)->size());
+      (*persistent)->forEach(collect);
+      return list;
+    }
+    LoxMap &map = mapArgument(arguments, 0, Keys ? "keys" : "values");
+    list->elements.reserve(map.size());
+    map.forEach(collect);
+    return list;
+  }
+
+  static const NativeEntry MAP_LIBRARY[] = {
+      {"Map", 0, makeMap},
+      {"get", 2, get},
+      {"set", 3, set},
+      {"has", 2, has},
+      {"remove", 2, remove},
+      {"keys", 1, entries<true>},
+      {"values", 1, entries<false>},
+  };
+
+  void defineMapLibrary(Environment &globals)
+  {
+    defineNatives(globals, MAP_LIBRARY);
+  }
+
+  bool isMapLibraryFunction(const std::string &name)
+  {
+    return definesNative(MAP_LIBRARY, name);
+  }
+}
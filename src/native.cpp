@@ -0,0 +1,33 @@
+#include <cmath>
+
+#include "cpplox/native.h"
+#include "cpplox/number.h"
+
+namespace CppLox
+{
+  int64_t integerArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *value = std::any_cast<int64_t>(&arguments[index]);
+    const auto *number = std::any_cast<double>(&arguments[index]);
+    if (value != nullptr)
+      return *value;
+    if (number != nullptr && *number == std::floor(*number) && std::fabs(*number) < 0x1p62)
+      return static_cast<int64_t>(*number);
+    throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be an integer.");
+  }
+
+  size_t indexArgument(const std::vector<std::any> &arguments, size_t index, const char *function, size_t limit)
+  {
+    int64_t integer = integerArgument(arguments, index, function);
+    if (integer < 0 || static_cast<uint64_t>(integer) > limit)
+      throw NativeError("Index " + std::to_string(integer) + " is out of range for '" + function + "'.");
+    return static_cast<size_t>(integer);
+  }
+
+  double numberArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    if (!isNumber(arguments[index]))
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a number.");
+    return toDouble(arguments[index]);
+  }
+}
@@ -0,0 +1,87 @@
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#include "cpplox/numberformat.h"
+
+namespace CppLox
+{
+  std::string_view formatNumber(double value, char (&buffer)[NUMBER_BUFFER_SIZE])
+  {
+    if (std::isnan(value))
+      return "nan";
+    if (std::isinf(value))
+      return value > 0 ? "inf" : "-inf";
+
+    // std::to_chars finds the shortest round-tripping digits (Ryu in
+    // libstdc++ and MSVC); the layout is ours so every platform and the C
+    // runtime agree.
+    char scientific[NUMBER_BUFFER_SIZE];
+    char *end = std::to_chars(scientific, scientific + sizeof scientific - 1, value, std::chars_format::scientific).ptr;
+    *end = '\0';
+    char *at = buffer;
+    const char *digits = scientific;
+    if (*digits == '-')
+    {
+      *at++ = '-';
+      digits++;
+    }
+    const char *exponentMark = static_cast<const char *>(std::memchr(digits, 'e', end - digits));
+    int exponent = std::atoi(exponentMark + 1);
+    // The significant digits without the point: d[.ddd]. to_chars always
+    // writes at least one, but the compiler cannot see that.
+    char significand[NUMBER_BUFFER_SIZE] = {};
+    size_t count = 0;
+    for (const char *digit = digits; digit < exponentMark; digit++)
+    {
+      if (*digit != '.')
+        significand[count++] = *digit;
+    }
+
+    if (exponent < -6 || exponent > 20)
+    {
+      *at++ = significand[0];
+      if (count > 1)
+      {
+        *at++ = '.';
+        std::memcpy(at, significand + 1, count - 1);
+        at += count - 1;
+      }
+      *at++ = 'e';
+      *at++ = exponent < 0 ? '-' : '+';
+      at = std::to_chars(at, buffer + NUMBER_BUFFER_SIZE, std::abs(exponent)).ptr;
+    }
+    else if (exponent < 0)
+    {
+      *at++ = '0';
+      *at++ = '.';
+      for (int i = -1; i > exponent; i--)
+      {
+        *at++ = '0';
+      }
+      std::memcpy(at, significand, count);
+      at += count;
+    }
+    else
+    {
+      size_t whole = static_cast<size_t>(exponent) + 1;
+      for (size_t i = 0; i < whole; i++)
+      {
+        *at++ = i < count ? significand[i] : '0';
+      }
+      if (count > whole)
+      {
+        *at++ = '.';
+        std::memcpy(at, significand + whole, count - whole);
+        at += count - whole;
+      }
+    }
+    return std::string_view(buffer, at - buffer);
+  }
+
+  std::string formatNumber(double value)
+  {
+    char buffer[NUMBER_BUFFER_SIZE];
+    return std::string(formatNumber(value, buffer));
+  }
+}
@@ -0,0 +1,1878 @@
+#include <ostream>
+
+#include "cpplox/optimizer.h"
+#include "cpplox/number.h"
+
+namespace CppLox
+{
+  static void forEachOperand(Expr *expr, const std::function<void(ExprPtr &)> &fn);
+
+  void Optimizer::addPass(std::unique_ptr<OptimizationPass> pass)
+  {
+    passes.push_back(std::move(pass));
+  }
+
+  void Optimizer::addStandardPasses()
+  {
+    addPass(std::make_unique<Inliner>());
+    addPass(std::make_unique<ScalarReplacement>());
+    addPass(std::make_unique<ConstantFolding>());
+    addPass(std::make_unique<ConstantPropagation>());
+    addPass(std::make_unique<ConstantFolding>());
+    addPass(std::make_unique<DeadCodeElimination>());
+    addPass(std::make_unique<Superinstructions>());
+    addPass(std::make_unique<CountedLoops>());
+    addPass(std::make_unique<LoopInvariantCodeMotion>());
+    addPass(std::make_unique<TypeInference>());
+  }
+
+  void Optimizer::optimize(std::vector<StmtPtr> &stmts)
+  {
+    for (auto &pass : passes)
+    {
+      pass->run(stmts, *this);
+    }
+  }
+
+  void Optimizer::retire(ExprPtr expr)
+  {
+    if (expr != nullptr)
+    {
+      retiredExprs.push_back(std::move(expr));
+    }
+  }
+
+  void Optimizer::retire(StmtPtr stmt)
+  {
+    if (stmt != nullptr)
+    {
+      retiredStmts.push_back(std::move(stmt));
+    }
+  }
+
+  void RewritePass::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    this->optimizer = &optimizer;
+    rewrite(stmts);
+  }
+
+  void RewritePass::rewrite(std::vector<StmtPtr> &stmts)
+  {
+    std::vector<StmtPtr> kept;
+    kept.reserve(stmts.size());
+    for (auto &stmt : stmts)
+    {
+      rewrite(stmt);
+      if (stmt != nullptr)
+      {
+        kept.push_back(std::move(stmt));
+      }
+    }
+    stmts = std::move(kept);
+  }
+
+  void RewritePass::rewrite(StmtPtr &stmt)
+  {
+    if (stmt == nullptr)
+    {
+      return;
+    }
+
+    if (auto *block = dynamic_cast<Block *>(stmt.get()))
+    {
+      rewrite(block->statements);
+    }
+    else if (auto *klass = dynamic_cast<Class *>(stmt.get()))
+    {
+      rewrite(klass->superclass);
+      for (auto &method : klass->methods)
+      {
+        rewrite(dynamic_cast<Function *>(method.get())->body);
+      }
+    }
+    else if (auto *expression = dynamic_cast<Expression *>(stmt.get()))
+    {
+      rewrite(expression->expression);
+    }
+    else if (auto *print = dynamic_cast<Print *>(stmt.get()))
+    {
+      rewrite(print->expression);
+    }
+    else if (auto *ret = dynamic_cast<Return *>(stmt.get()))
+    {
+      rewrite(ret->value);
+    }
+    else if (auto *var = dynamic_cast<Var *>(stmt.get()))
+    {
+      rewrite(var->initializer);
+    }
+    else if (auto *function = dynamic_cast<Function *>(stmt.get()))
+    {
+      rewrite(function->body);
+    }
+    else if (auto *ifStmt = dynamic_cast<If *>(stmt.get()))
+    {
+      rewrite(ifStmt->condition);
+      rewrite(ifStmt->thenBranch);
+      rewrite(ifStmt->elseBranch);
+      if (ifStmt->thenBranch == nullptr)
+      {
+        ifStmt->thenBranch = std::make_unique<Block>(std::vector<StmtPtr>());
+      }
+    }
+    else if (auto *whileStmt = dynamic_cast<While *>(stmt.get()))
+    {
+      rewrite(whileStmt->condition);
+      rewrite(whileStmt->body);
+      if (whileStmt->body == nullptr)
+      {
+        whileStmt->body = std::make_unique<Block>(std::vector<StmtPtr>());
+      }
+    }
+    else if (auto *loop = dynamic_cast<ForLoop *>(stmt.get()))
+    {
+      rewrite(loop->condition);
+      rewrite(loop->body);
+      rewrite(loop->increment);
+    }
+    else if (auto *counted = dynamic_cast<CountedLoop *>(stmt.get()))
+    {
+      rewrite(counted->start);
+      rewrite(counted->limit);
+      rewrite(counted->body);
+    }
+    else if (auto *hoisting = dynamic_cast<InvariantLoop *>(stmt.get()))
+    {
+      rewrite(hoisting->loop);
+    }
+
+    stmt = transform(std::move(stmt));
+  }
+
+  void RewritePass::rewrite(ExprPtr &expr)
+  {
+    if (expr == nullptr)
+    {
+      return;
+    }
+
+    if (auto *binary = dynamic_cast<Binary *>(expr.get()))
+    {
+      rewrite(binary->left);
+      rewrite(binary->right);
+    }
+    else if (auto *call = dynamic_cast<Call *>(expr.get()))
+    {
+      rewrite(call->callee);
+      for (auto &argument : call->arguments)
+      {
+        rewrite(argument);
+      }
+    }
+    else if (auto *get = dynamic_cast<Get *>(expr.get()))
+    {
+      rewrite(get->object);
+    }
+    else if (auto *set = dynamic_cast<Set *>(expr.get()))
+    {
+      rewrite(set->object);
+      rewrite(set->value);
+    }
+    else if (auto *index = dynamic_cast<Index *>(expr.get()))
+    {
+      rewrite(index->object);
+      rewrite(index->index);
+    }
+    else if (auto *setIndex = dynamic_cast<SetIndex *>(expr.get()))
+    {
+      rewrite(setIndex->object);
+      rewrite(setIndex->index);
+      rewrite(setIndex->value);
+    }
+    else if (auto *slice = dynamic_cast<Slice *>(expr.get()))
+    {
+      rewrite(slice->object);
+      rewrite(slice->start);
+      rewrite(slice->end);
+    }
+    else if (auto *grouping = dynamic_cast<Grouping *>(expr.get()))
+    {
+      rewrite(grouping->expression);
+    }
+    else if (auto *unary = dynamic_cast<Unary *>(expr.get()))
+    {
+      rewrite(unary->right);
+    }
+    else if (auto *assign = dynamic_cast<Assign *>(expr.get()))
+    {
+      rewrite(assign->value);
+    }
+    else if (auto *logical = dynamic_cast<Logical *>(expr.get()))
+    {
+      rewrite(logical->left);
+      rewrite(logical->right);
+    }
+    else if (auto *assignOp = dynamic_cast<AssignOp *>(expr.get()))
+    {
+      rewrite(assignOp->value);
+    }
+    else if (auto *compare = dynamic_cast<CompareVariable *>(expr.get()))
+    {
+      rewrite(compare->right);
+    }
+    else if (auto *setOp = dynamic_cast<SetFieldOp *>(expr.get()))
+    {
+      rewrite(setOp->object);
+      rewrite(setOp->value);
+    }
+    else if (auto *inlined = dynamic_cast<InlinedCall *>(expr.get()))
+    {
+      rewrite(inlined->callee);
+      for (auto &argument : inlined->arguments)
+      {
+        rewrite(argument);
+      }
+      rewrite(inlined->body);
+    }
+    else if (auto *conditional = dynamic_cast<Conditional *>(expr.get()))
+    {
+      rewrite(conditional->condition);
+      rewrite(conditional->thenBranch);
+      rewrite(conditional->elseBranch);
+    }
+    else if (auto *invariant = dynamic_cast<Invariant *>(expr.get()))
+    {
+      rewrite(invariant->expression);
+    }
+    else if (auto *interpolation = dynamic_cast<Interpolation *>(expr.get()))
+    {
+      for (auto &part : interpolation->parts)
+      {
+        rewrite(part);
+      }
+    }
+
+    expr = transform(std::move(expr));
+  }
+
+  void Inliner::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    this->optimizer = &optimizer;
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    // Templates are taken before any call is rewritten, so a body is always
+    // cloned from its original form.
+    collect(stmts);
+    RewritePass::run(stmts, optimizer);
+    templates.clear();
+    analysis.reset();
+  }
+
+  void Inliner::collect(const std::vector<StmtPtr> &stmts)
+  {
+    for (const auto &stmt : stmts)
+    {
+      collect(stmt.get());
+    }
+  }
+
+  void Inliner::collect(const Stmt *stmt)
+  {
+    if (auto *block = dynamic_cast<const Block *>(stmt))
+    {
+      collect(block->statements);
+    }
+    else if (auto *ifStmt = dynamic_cast<const If *>(stmt))
+    {
+      collect(ifStmt->thenBranch.get());
+      collect(ifStmt->elseBranch.get());
+    }
+    else if (auto *whileStmt = dynamic_cast<const While *>(stmt))
+    {
+      collect(whileStmt->body.get());
+    }
+    else if (auto *function = dynamic_cast<const Function *>(stmt))
+    {
+      collect(function->body);
+      // An inlined body would skip the argument and return checks.
+      const Binding *binding = analysis->bindingFor(function);
+      if (binding == nullptr || binding->declarations != 1 || binding->assignments != 0 || function->annotated())
+        return;
+      int budget = MAX_INLINE_NODES;
+      if (optimizer->profile != nullptr && optimizer->profile->callsTo(function) >= HOT_CALLS)
+        budget = HOT_INLINE_NODES;
+      ExprPtr body = inlineBody(function, function->body, 0, budget);
+      if (body != nullptr)
+      {
+        templates[function] = std::move(body);
+      }
+    }
+  }
+
+  ExprPtr Inliner::inlineBody(const Function *function, const std::vector<StmtPtr> &stmts, size_t index, int &budget)
+  {
+    // Falling off the end returns no value at all, which no literal
+    // reproduces.
+    if (index == stmts.size())
+      return nullptr;
+
+    if (auto *ifStmt = dynamic_cast<const If *>(stmts[index].get()))
+    {
+      ExprPtr condition = clone(function, ifStmt->condition.get(), budget);
+      ExprPtr thenBranch = returnedValue(function, ifStmt->thenBranch.get(), budget);
+      ExprPtr elseBranch = ifStmt->elseBranch != nullptr ? returnedValue(function, ifStmt->elseBranch.get(), budget)
+                                                         : inlineBody(function, stmts, index + 1, budget);
+      if (condition == nullptr || thenBranch == nullptr || elseBranch == nullptr)
+        return nullptr;
+      return std::make_unique<Conditional>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    }
+    return returnedValue(function, stmts[index].get(), budget);
+  }
+
+  ExprPtr Inliner::returnedValue(const Function *function, const Stmt *stmt, int &budget)
+  {
+    if (auto *block = dynamic_cast<const Block *>(stmt))
+    {
+      if (block->statements.size() != 1)
+        return nullptr;
+      stmt = block->statements[0].get();
+    }
+    auto *ret = dynamic_cast<const Return *>(stmt);
+    if (ret == nullptr || ret->value == nullptr)
+      return nullptr;
+    // A tail call runs in the caller's frame; inlined, it would nest.
+    if (dynamic_cast<const Call *>(ret->value.get()) != nullptr)
+      return nullptr;
+    return clone(function, ret->value.get(), budget);
+  }
+
+  // Copies an expression of the callee's body, or returns nullptr if it is
+  // too large or uses anything but parameters, globals and pure operators.
+  ExprPtr Inliner::clone(const Function *function, const Expr *expr, int &budget)
+  {
+    if (--budget < 0)
+      return nullptr;
+
+    if (auto *literal = dynamic_cast<const Literal *>(expr))
+    {
+      return std::make_unique<Literal>(literal->value);
+    }
+    if (auto *variable = dynamic_cast<const Variable *>(expr))
+    {
+      int depth = optimizer->interpreter->resolvedDepth(variable);
+      if (depth == -1)
+      {
+        if (variable->name.lexeme == function->name.lexeme)
+          return nullptr;
+        return std::make_unique<Variable>(variable->name);
+      }
+      if (depth != 0)
+        return nullptr;
+      for (size_t slot = 0; slot < function->params.size(); slot++)
+      {
+        if (function->params[slot].lexeme == variable->name.lexeme)
+          return std::make_unique<ArgRef>(variable->name, static_cast<int>(slot));
+      }
+      return nullptr;
+    }
+    if (auto *grouping = dynamic_cast<const Grouping *>(expr))
+    {
+      return clone(function, grouping->expression.get(), budget);
+    }
+    if (auto *unary = dynamic_cast<const Unary *>(expr))
+    {
+      ExprPtr right = clone(function, unary->right.get(), budget);
+      if (right == nullptr)
+        return nullptr;
+      return std::make_unique<Unary>(unary->op, std::move(right));
+    }
+    if (auto *binary = dynamic_cast<const Binary *>(expr))
+    {
+      ExprPtr left = clone(function, binary->left.get(), budget);
+      ExprPtr right = clone(function, binary->right.get(), budget);
+      if (left == nullptr || right == nullptr)
+        return nullptr;
+      auto copy = std::make_unique<Binary>(std::move(left), binary->op, std::move(right));
+      copy->kind = binary->kind;
+      return copy;
+    }
+    if (auto *logical = dynamic_cast<const Logical *>(expr))
+    {
+      ExprPtr left = clone(function, logical->left.get(), budget);
+      ExprPtr right = clone(function, logical->right.get(), budget);
+      if (left == nullptr || right == nullptr)
+        return nullptr;
+      return std::make_unique<Logical>(std::move(left), logical->op, std::move(right));
+    }
+    if (auto *get = dynamic_cast<const Get *>(expr))
+    {
+      ExprPtr object = clone(function, get->object.get(), budget);
+      if (object == nullptr)
+        return nullptr;
+      return std::make_unique<Get>(std::move(object), get->name);
+    }
+    if (auto *call = dynamic_cast<const Call *>(expr))
+    {
+      ExprPtr callee = clone(function, call->callee.get(), budget);
+      if (callee == nullptr)
+        return nullptr;
+      std::vector<ExprPtr> arguments;
+      for (const auto &argument : call->arguments)
+      {
+        arguments.push_back(clone(function, argument.get(), budget));
+        if (arguments.back() == nullptr)
+          return nullptr;
+      }
+      return std::make_unique<Call>(std::move(callee), call->paren, std::move(arguments));
+    }
+    return nullptr;
+  }
+
+  ExprPtr Inliner::copy(const Expr *expr)
+  {
+    if (auto *literal = dynamic_cast<const Literal *>(expr))
+      return std::make_unique<Literal>(literal->value);
+    if (auto *variable = dynamic_cast<const Variable *>(expr))
+      return std::make_unique<Variable>(variable->name);
+    if (auto *arg = dynamic_cast<const ArgRef *>(expr))
+      return std::make_unique<ArgRef>(arg->name, arg->slot);
+    if (auto *conditional = dynamic_cast<const Conditional *>(expr))
+      return std::make_unique<Conditional>(copy(conditional->condition.get()), copy(conditional->thenBranch.get()), copy(conditional->elseBranch.get()));
+    if (auto *unary = dynamic_cast<const Unary *>(expr))
+      return std::make_unique<Unary>(unary->op, copy(unary->right.get()));
+    if (auto *binary = dynamic_cast<const Binary *>(expr))
+      return std::make_unique<Binary>(copy(binary->left.get()), binary->op, copy(binary->right.get()));
+    if (auto *logical = dynamic_cast<const Logical *>(expr))
+      return std::make_unique<Logical>(copy(logical->left.get()), logical->op, copy(logical->right.get()));
+    if (auto *get = dynamic_cast<const Get *>(expr))
+      return std::make_unique<Get>(copy(get->object.get()), get->name);
+
+    auto *call = dynamic_cast<const Call *>(expr);
+    std::vector<ExprPtr> arguments;
+    for (const auto &argument : call->arguments)
+    {
+      arguments.push_back(copy(argument.get()));
+    }
+    return std::make_unique<Call>(copy(call->callee.get()), call->paren, std::move(arguments));
+  }
+
+  ExprPtr Inliner::transform(ExprPtr expr)
+  {
+    auto *call = dynamic_cast<Call *>(expr.get());
+    if (call == nullptr || dynamic_cast<Variable *>(call->callee.get()) == nullptr)
+      return expr;
+    const Binding *binding = analysis->bindingFor(call->callee.get());
+    if (binding == nullptr)
+      return expr;
+    auto *function = dynamic_cast<const Function *>(binding->declaration);
+    if (function == nullptr || analysis->bindingFor(function) != binding || function->params.size() != call->arguments.size())
+      return expr;
+    auto it = templates.find(function);
+    if (it == templates.end())
+      return expr;
+
+    ExprPtr inlined = std::make_unique<InlinedCall>(std::move(call->callee), call->paren, std::move(call->arguments), function, copy(it->second.get()));
+    optimizer->retire(std::move(expr));
+    return inlined;
+  }
+
+  void ScalarReplacement::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    this->optimizer = &optimizer;
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    for (auto &stmt : stmts)
+    {
+      collect(stmt.get());
+    }
+
+    // Every read of the variable must be a field access we can rewrite.
+    for (auto it = candidates.begin(); it != candidates.end();)
+    {
+      const Binding *binding = it->first;
+      auto uses = fieldUses.find(binding);
+      if (binding->reads != (uses != fieldUses.end() ? uses->second : 0))
+        it = candidates.erase(it);
+      else
+        ++it;
+    }
+
+    if (!candidates.empty())
+    {
+      RewritePass::run(stmts, optimizer);
+    }
+    candidates.clear();
+    fieldUses.clear();
+    analysis.reset();
+  }
+
+  void ScalarReplacement::collect(Stmt *stmt)
+  {
+    if (stmt == nullptr)
+      return;
+
+    if (auto *var = dynamic_cast<Var *>(stmt))
+    {
+      collect(var->initializer.get());
+      auto *call = dynamic_cast<Call *>(var->initializer.get());
+      const Binding *binding = analysis->bindingFor(var);
+      if (call == nullptr || dynamic_cast<Variable *>(call->callee.get()) == nullptr || binding == nullptr ||
+          binding->global || binding->declarations != 1 || binding->assignments != 0 || var->annotation != Annotation::NONE)
+        return;
+      const Binding *classBinding = analysis->bindingFor(call->callee.get());
+      if (classBinding == nullptr || !classBinding->global || classBinding->declarations != 1 || classBinding->assignments != 0)
+        return;
+      auto *klass = dynamic_cast<const Class *>(classBinding->declaration);
+      std::vector<FieldSource> fields;
+      if (klass == nullptr || !describeClass(klass, fields))
+        return;
+      size_t arity = 0;
+      for (const auto &field : fields)
+        arity += field.param >= 0 ? 1 : 0;
+      if (arity != call->arguments.size())
+        return;
+      candidates[binding] = Candidate{klass, std::move(fields)};
+    }
+    else if (auto *block = dynamic_cast<Block *>(stmt))
+    {
+      for (auto &inner : block->statements)
+        collect(inner.get());
+    }
+    else if (auto *klass = dynamic_cast<Class *>(stmt))
+    {
+      collect(klass->superclass.get());
+      for (auto &method : klass->methods)
+        collect(method.get());
+    }
+    else if (auto *function = dynamic_cast<Function *>(stmt))
+    {
+      for (auto &inner : function->body)
+        collect(inner.get());
+    }
+    else if (auto *expression = dynamic_cast<Expression *>(stmt))
+      collect(expression->expression.get());
+    else if (auto *print = dynamic_cast<Print *>(stmt))
+      collect(print->expression.get());
+    else if (auto *ret = dynamic_cast<Return *>(stmt))
+      collect(ret->value.get());
+    else if (auto *ifStmt = dynamic_cast<If *>(stmt))
+    {
+      collect(ifStmt->condition.get());
+      collect(ifStmt->thenBranch.get());
+      collect(ifStmt->elseBranch.get());
+    }
+    else if (auto *whileStmt = dynamic_cast<While *>(stmt))
+    {
+      collect(whileStmt->condition.get());
+      collect(whileStmt->body.get());
+    }
+  }
+
+  void ScalarReplacement::collect(Expr *expr)
+  {
+    if (expr == nullptr)
+      return;
+
+    const Expr *object = nullptr;
+    const Token *name = nullptr;
+    if (auto *get = dynamic_cast<Get *>(expr))
+    {
+      object = get->object.get();
+      name = &get->name;
+    }
+    else if (auto *set = dynamic_cast<Set *>(expr))
+    {
+      object = set->object.get();
+      name = &set->name;
+    }
+    if (object != nullptr && dynamic_cast<const Variable *>(object) != nullptr)
+    {
+      const Binding *binding = analysis->bindingFor(object);
+      auto it = candidates.find(binding);
+      if (it != candidates.end())
+      {
+        // Only fields init always sets; anything else could be undefined or
+        // bind a method.
+        bool known = false;
+        for (const auto &field : it->second.fields)
+          known = known || field.field == name->lexeme;
+        fieldUses[binding] += known ? 1 : 0;
+      }
+    }
+
+    forEachOperand(expr, [this](ExprPtr &operand)
+                   { collect(operand.get()); });
+  }
+
+  bool ScalarReplacement::describeClass(const Class *klass, std::vector<FieldSource> &fields) const
+  {
+    if (klass->superclass != nullptr)
+      return false;
+    const Function *init = nullptr;
+    for (const auto &method : klass->methods)
+    {
+      auto *function = dynamic_cast<const Function *>(method.get());
+      if (function->name.lexeme == "init")
+        init = function;
+    }
+    if (init == nullptr)
+      return false;
+
+    // Each parameter is copied exactly once and in order, so the arguments
+    // can initialize the fields directly and still run in source order.
+    int nextParam = 0;
+    for (const auto &stmt : init->body)
+    {
+      auto *expression = dynamic_cast<const Expression *>(stmt.get());
+      auto *set = expression != nullptr ? dynamic_cast<const Set *>(expression->expression.get()) : nullptr;
+      if (set == nullptr || dynamic_cast<const This *>(set->object.get()) == nullptr)
+        return false;
+      for (const auto &field : fields)
+      {
+        if (field.field == set->name.lexeme)
+          return false;
+      }
+
+      if (auto *literal = dynamic_cast<const Literal *>(set->value.get()))
+      {
+        fields.push_back(FieldSource{set->name.lexeme, -1, literal->value});
+        continue;
+      }
+      auto *variable = dynamic_cast<const Variable *>(set->value.get());
+      if (variable == nullptr || nextParam >= static_cast<int>(init->params.size()) ||
+          init->params[nextParam].lexeme != variable->name.lexeme || optimizer->interpreter->resolvedDepth(variable) != 0)
+        return false;
+      fields.push_back(FieldSource{set->name.lexeme, nextParam++, nullptr});
+    }
+    return nextParam == static_cast<int>(init->params.size());
+  }
+
+  const ScalarReplacement::Candidate *ScalarReplacement::candidateFor(const Expr *object) const
+  {
+    if (dynamic_cast<const Variable *>(object) == nullptr)
+      return nullptr;
+    auto it = candidates.find(analysis->bindingFor(object));
+    return it != candidates.end() ? &it->second : nullptr;
+  }
+
+  Token ScalarReplacement::hiddenName(const Token &variable, const Token &field) const
+  {
+    return Token(TokenType::IDENTIFIER, variable.lexeme + "." + field.lexeme, nullptr, field.line);
+  }
+
+  ExprPtr ScalarReplacement::transform(ExprPtr expr)
+  {
+    if (auto *get = dynamic_cast<Get *>(expr.get()))
+    {
+      if (candidateFor(get->object.get()) == nullptr)
+        return expr;
+      const Token &variable = dynamic_cast<Variable *>(get->object.get())->name;
+      ExprPtr read = std::make_unique<Variable>(hiddenName(variable, get->name));
+      optimizer->interpreter->resolve(read.get(), optimizer->interpreter->resolvedDepth(get->object.get()));
+      optimizer->retire(std::move(expr));
+      return read;
+    }
+
+    if (auto *set = dynamic_cast<Set *>(expr.get()))
+    {
+      if (candidateFor(set->object.get()) == nullptr)
+        return expr;
+      const Token &variable = dynamic_cast<Variable *>(set->object.get())->name;
+      ExprPtr write = std::make_unique<Assign>(hiddenName(variable, set->name), std::move(set->value));
+      optimizer->interpreter->resolve(write.get(), optimizer->interpreter->resolvedDepth(set->object.get()));
+      optimizer->retire(std::move(expr));
+      return write;
+    }
+
+    return expr;
+  }
+
+  void ScalarReplacement::rewrite(std::vector<StmtPtr> &stmts)
+  {
+    RewritePass::rewrite(stmts);
+
+    std::vector<StmtPtr> expanded;
+    for (auto &stmt : stmts)
+    {
+      auto *var = dynamic_cast<Var *>(stmt.get());
+      auto it = var != nullptr ? candidates.find(analysis->bindingFor(var)) : candidates.end();
+      if (it == candidates.end())
+      {
+        expanded.push_back(std::move(stmt));
+        continue;
+      }
+
+      // `var p = C(a, b)` becomes `C; var p.x = a; var p.y = b;`, keeping
+      // the class lookup for its undefined-variable error.
+      auto *call = dynamic_cast<Call *>(var->initializer.get());
+      expanded.push_back(std::make_unique<Expression>(std::move(call->callee)));
+      for (const auto &field : it->second.fields)
+      {
+        Token fieldName(TokenType::IDENTIFIER, std::string(field.field), nullptr, var->name.line);
+        ExprPtr value = field.param >= 0 ? std::move(call->arguments[field.param]) : std::make_unique<Literal>(field.literal);
+        expanded.push_back(std::make_unique<Var>(hiddenName(var->name, fieldName), std::move(value)));
+      }
+      optimizer->retire(std::move(stmt));
+    }
+    stmts = std::move(expanded);
+  }
+
+  bool isTruthyLiteral(const LiteralType &value)
+  {
+    if (std::holds_alternative<std::nullptr_t>(value))
+      return false;
+    if (std::holds_alternative<bool>(value))
+      return std::get<bool>(value);
+    return true;
+  }
+
+  static bool equalLiterals(const LiteralType &left, const LiteralType &right)
+  {
+    if (const auto *a = std::get_if<int64_t>(&left))
+    {
+      if (const auto *b = std::get_if<double>(&right))
+        return sameNumber(*a, *b);
+    }
+    if (const auto *a = std::get_if<double>(&left))
+    {
+      if (const auto *b = std::get_if<int64_t>(&right))
+        return sameNumber(*b, *a);
+    }
+    return left == right;
+  }
+
+  std::optional<LiteralType> foldBinary(TokenType op, const LiteralType &left, const LiteralType &right)
+  {
+    // Mirrors Interpreter::visitBinaryExpr; anything that would raise a
+    // runtime error is left for the interpreter to report.
+    if (op == TokenType::EQUAL_EQUAL)
+      return LiteralType(equalLiterals(left, right));
+    if (op == TokenType::BANG_EQUAL)
+      return LiteralType(!equalLiterals(left, right));
+
+    if (op == TokenType::PLUS && std::holds_alternative<std::string>(left) && std::holds_alternative<std::string>(right))
+      return LiteralType(std::get<std::string>(left) + std::get<std::string>(right));
+
+    if (!isNumber(left) || !isNumber(right))
+      return std::nullopt;
+
+    const auto *i = std::get_if<int64_t>(&left);
+    const auto *j = std::get_if<int64_t>(&right);
+    if (i != nullptr && j != nullptr)
+    {
+      if (std::optional<int64_t> integer = integerArithmetic(numberKind(op), *i, *j))
+        return LiteralType(*integer);
+    }
+
+    double a = toDouble(left);
+    double b = toDouble(right);
+    switch (op)
+    {
+    case TokenType::PLUS:
+      return LiteralType(a + b);
+    case TokenType::MINUS:
+      return LiteralType(a - b);
+    case TokenType::STAR:
+      return LiteralType(a * b);
+    case TokenType::SLASH:
+      return LiteralType(a / b);
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+      return LiteralType(orderingHolds(numberKind(op), compareNumbers(left, right)));
+    default:
+      return std::nullopt;
+    }
+  }
+
+  ExprPtr ConstantFolding::transform(ExprPtr expr)
+  {
+    if (auto *grouping = dynamic_cast<Grouping *>(expr.get()))
+    {
+      ExprPtr inner = std::move(grouping->expression);
+      optimizer->retire(std::move(expr));
+      return inner;
+    }
+
+    if (auto *unary = dynamic_cast<Unary *>(expr.get()))
+    {
+      auto *operand = dynamic_cast<Literal *>(unary->right.get());
+      if (operand == nullptr)
+        return expr;
+      if (unary->op.type == TokenType::BANG)
+      {
+        ExprPtr folded = std::make_unique<Literal>(!isTruthyLiteral(operand->value));
+        optimizer->retire(std::move(expr));
+        return folded;
+      }
+      if (unary->op.type == TokenType::MINUS && isNumber(operand->value))
+      {
+        const auto *integer = std::get_if<int64_t>(&operand->value);
+        std::optional<int64_t> negated = integer != nullptr ? integerNegate(*integer) : std::nullopt;
+        ExprPtr folded = negated ? std::make_unique<Literal>(*negated) : std::make_unique<Literal>(-toDouble(operand->value));
+        optimizer->retire(std::move(expr));
+        return folded;
+      }
+      return expr;
+    }
+
+    if (auto *binary = dynamic_cast<Binary *>(expr.get()))
+    {
+      auto *left = dynamic_cast<Literal *>(binary->left.get());
+      auto *right = dynamic_cast<Literal *>(binary->right.get());
+      if (left == nullptr || right == nullptr)
+        return expr;
+      std::optional<LiteralType> value = foldBinary(binary->op.type, left->value, right->value);
+      if (!value)
+        return expr;
+      ExprPtr folded = std::make_unique<Literal>(std::move(*value));
+      optimizer->retire(std::move(expr));
+      return folded;
+    }
+
+    if (auto *logical = dynamic_cast<Logical *>(expr.get()))
+    {
+      auto *left = dynamic_cast<Literal *>(logical->left.get());
+      if (left == nullptr)
+        return expr;
+      bool truthy = isTruthyLiteral(left->value);
+      bool shortCircuits = logical->op.type == TokenType::OR ? truthy : !truthy;
+      ExprPtr result = shortCircuits ? std::move(logical->left) : std::move(logical->right);
+      optimizer->retire(std::move(expr));
+      return result;
+    }
+
+    return expr;
+  }
+
+  void ConstantPropagation::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    RewritePass::run(stmts, optimizer);
+    analysis.reset();
+  }
+
+  const Literal *ConstantPropagation::constantFor(const Binding *binding) const
+  {
+    if (binding == nullptr || binding->global || binding->assignments != 0 || binding->declarations != 1)
+      return nullptr;
+    auto *var = dynamic_cast<const Var *>(binding->declaration);
+    if (var == nullptr)
+      return nullptr;
+    return dynamic_cast<const Literal *>(var->initializer.get());
+  }
+
+  ExprPtr ConstantPropagation::transform(ExprPtr expr)
+  {
+    if (dynamic_cast<Variable *>(expr.get()) == nullptr)
+      return expr;
+    const Literal *constant = constantFor(analysis->bindingFor(expr.get()));
+    if (constant == nullptr)
+      return expr;
+    ExprPtr literal = std::make_unique<Literal>(constant->value);
+    optimizer->retire(std::move(expr));
+    return literal;
+  }
+
+  StmtPtr ConstantPropagation::transform(StmtPtr stmt)
+  {
+    if (dynamic_cast<Var *>(stmt.get()) == nullptr)
+      return stmt;
+    if (constantFor(analysis->bindingFor(stmt.get())) == nullptr)
+      return stmt;
+    optimizer->retire(std::move(stmt));
+    return nullptr;
+  }
+
+  void DeadCodeElimination::rewrite(std::vector<StmtPtr> &stmts)
+  {
+    RewritePass::rewrite(stmts);
+    for (size_t i = 0; i < stmts.size(); i++)
+    {
+      if (dynamic_cast<Return *>(stmts[i].get()) != nullptr)
+      {
+        for (size_t j = i + 1; j < stmts.size(); j++)
+        {
+          optimizer->retire(std::move(stmts[j]));
+        }
+        stmts.resize(i + 1);
+        break;
+      }
+    }
+  }
+
+  StmtPtr DeadCodeElimination::transform(StmtPtr stmt)
+  {
+    if (auto *ifStmt = dynamic_cast<If *>(stmt.get()))
+    {
+      auto *condition = dynamic_cast<Literal *>(ifStmt->condition.get());
+      if (condition == nullptr)
+        return stmt;
+      StmtPtr taken = isTruthyLiteral(condition->value) ? std::move(ifStmt->thenBranch) : std::move(ifStmt->elseBranch);
+      optimizer->retire(std::move(stmt));
+      return taken;
+    }
+
+    if (auto *whileStmt = dynamic_cast<While *>(stmt.get()))
+    {
+      auto *condition = dynamic_cast<Literal *>(whileStmt->condition.get());
+      if (condition == nullptr || isTruthyLiteral(condition->value))
+        return stmt;
+      optimizer->retire(std::move(stmt));
+      return nullptr;
+    }
+
+    if (auto *expression = dynamic_cast<Expression *>(stmt.get()))
+    {
+      if (dynamic_cast<Literal *>(expression->expression.get()) == nullptr)
+        return stmt;
+      optimizer->retire(std::move(stmt));
+      return nullptr;
+    }
+
+    return stmt;
+  }
+
+  static bool isArithmetic(TokenType op)
+  {
+    return op == TokenType::PLUS || op == TokenType::MINUS || op == TokenType::STAR || op == TokenType::SLASH;
+  }
+
+  static bool isComparison(TokenType op)
+  {
+    return op == TokenType::LESS || op == TokenType::LESS_EQUAL || op == TokenType::GREATER ||
+           op == TokenType::GREATER_EQUAL || op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL;
+  }
+
+  // Operands the fused nodes may evaluate out of source order.
+  static bool isSimple(const Expr *expr)
+  {
+    return dynamic_cast<const Literal *>(expr) != nullptr || dynamic_cast<const Variable *>(expr) != nullptr;
+  }
+
+  bool Superinstructions::sameVariable(const Expr *a, const Expr *b) const
+  {
+    int depth = optimizer->interpreter->resolvedDepth(a);
+    if (depth != optimizer->interpreter->resolvedDepth(b))
+      return false;
+    if (auto *left = dynamic_cast<const Variable *>(a))
+    {
+      auto *right = dynamic_cast<const Variable *>(b);
+      return right != nullptr && left->name.lexeme == right->name.lexeme;
+    }
+    return dynamic_cast<const This *>(a) != nullptr && dynamic_cast<const This *>(b) != nullptr;
+  }
+
+  ExprPtr Superinstructions::transform(ExprPtr expr)
+  {
+    if (auto *assign = dynamic_cast<Assign *>(expr.get()))
+    {
+      // A store the TypeChecker could not prove keeps its check.
+      auto *binary = dynamic_cast<Binary *>(assign->value.get());
+      if (binary == nullptr || !isArithmetic(binary->op.type) || !isSimple(binary->right.get()) ||
+          assign->annotation != Annotation::NONE)
+        return expr;
+      auto *target = dynamic_cast<Variable *>(binary->left.get());
+      int depth = optimizer->interpreter->resolvedDepth(assign);
+      if (target == nullptr || target->name.lexeme != assign->name.lexeme || optimizer->interpreter->resolvedDepth(target) != depth)
+        return expr;
+      ExprPtr fused = std::make_unique<AssignOp>(assign->name, depth, binary->op, std::move(binary->right));
+      optimizer->retire(std::move(expr));
+      return fused;
+    }
+
+    if (auto *binary = dynamic_cast<Binary *>(expr.get()))
+    {
+      auto *left = dynamic_cast<Variable *>(binary->left.get());
+      if (left == nullptr || !isComparison(binary->op.type) || !isSimple(binary->right.get()))
+        return expr;
+      int depth = optimizer->interpreter->resolvedDepth(left);
+      ExprPtr fused = std::make_unique<CompareVariable>(left->name, depth, binary->op, std::move(binary->right));
+      optimizer->retire(std::move(expr));
+      return fused;
+    }
+
+    if (auto *set = dynamic_cast<Set *>(expr.get()))
+    {
+      auto *binary = dynamic_cast<Binary *>(set->value.get());
+      if (binary == nullptr || !isArithmetic(binary->op.type) || !isSimple(binary->right.get()))
+        return expr;
+      auto *get = dynamic_cast<Get *>(binary->left.get());
+      if (get == nullptr || get->name.lexeme != set->name.lexeme || !sameVariable(set->object.get(), get->object.get()))
+        return expr;
+      ExprPtr fused = std::make_unique<SetFieldOp>(std::move(set->object), set->name, binary->op, std::move(binary->right));
+      optimizer->retire(std::move(expr));
+      return fused;
+    }
+
+    return expr;
+  }
+
+  StmtPtr Superinstructions::transform(StmtPtr stmt)
+  {
+    auto *whileStmt = dynamic_cast<While *>(stmt.get());
+    if (whileStmt == nullptr)
+      return stmt;
+    auto *body = dynamic_cast<Block *>(whileStmt->body.get());
+    if (body == nullptr || body->statements.empty())
+      return stmt;
+    auto *increment = dynamic_cast<Expression *>(body->statements.back().get());
+    if (increment == nullptr)
+      return stmt;
+
+    ExprPtr step = std::move(increment->expression);
+    optimizer->retire(std::move(body->statements.back()));
+    body->statements.pop_back();
+    StmtPtr fused = std::make_unique<ForLoop>(std::move(whileStmt->condition), std::move(body->statements), std::move(step));
+    optimizer->retire(std::move(stmt));
+    return fused;
+  }
+
+  void CountedLoops::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    RewritePass::run(stmts, optimizer);
+    analysis.reset();
+  }
+
+  bool CountedLoops::isInvariant(const Expr *limit) const
+  {
+    auto *literal = dynamic_cast<const Literal *>(limit);
+    if (literal != nullptr)
+      return isNumber(literal->value);
+    if (dynamic_cast<const Variable *>(limit) == nullptr)
+      return false;
+    const Binding *binding = analysis->bindingFor(limit);
+    return binding != nullptr && binding->assignments == 0 && binding->declarations == 1;
+  }
+
+  StmtPtr CountedLoops::transform(StmtPtr stmt)
+  {
+    // forStatement lowers `for (var i = a; i < b; i = i + c)` to a block of
+    // the declaration and the loop, fused into a ForLoop by Superinstructions.
+    auto *block = dynamic_cast<Block *>(stmt.get());
+    if (block == nullptr || block->statements.size() != 2)
+      return stmt;
+    auto *var = dynamic_cast<Var *>(block->statements[0].get());
+    auto *loop = dynamic_cast<ForLoop *>(block->statements[1].get());
+    if (var == nullptr || loop == nullptr)
+      return stmt;
+
+    auto *condition = dynamic_cast<CompareVariable *>(loop->condition.get());
+    auto *increment = dynamic_cast<AssignOp *>(loop->increment.get());
+    if (condition == nullptr || increment == nullptr)
+      return stmt;
+    TokenType op = condition->op.type;
+    if (op != TokenType::LESS && op != TokenType::LESS_EQUAL && op != TokenType::GREATER && op != TokenType::GREATER_EQUAL)
+      return stmt;
+    if (increment->op.type != TokenType::PLUS && increment->op.type != TokenType::MINUS)
+      return stmt;
+    auto *step = dynamic_cast<Literal *>(increment->value.get());
+    if (step == nullptr || !isNumber(step->value) || !isInvariant(condition->right.get()))
+      return stmt;
+
+    // The counter must be the loop's own variable, stepped only by the
+    // increment.
+    Binding *counter = analysis->bindingFor(var);
+    if (counter == nullptr || counter->assignments != 1 || counter->declarations != 1 ||
+        analysis->bindingFor(condition) != counter || analysis->bindingFor(increment) != counter)
+      return stmt;
+    // The loop does not check its start against the counter's annotation;
+    // only a literal one is known to pass.
+    if (var->annotation != Annotation::NONE && dynamic_cast<Literal *>(var->initializer.get()) == nullptr)
+      return stmt;
+
+    // Reads besides the bound check and the step need the Lox variable kept
+    // current, as do closures that capture it.
+    bool materialize = counter->reads != 2 || counter->captured;
+    StmtPtr counted = std::make_unique<CountedLoop>(var->name, std::move(var->initializer), condition->op,
+                                                    std::move(condition->right), increment->op,
+                                                    toDouble(step->value), std::move(loop->body), materialize);
+    optimizer->retire(std::move(stmt));
+    return counted;
+  }
+
+  // Calls fn on each direct operand slot of expr.
+  static void forEachOperand(Expr *expr, const std::function<void(ExprPtr &)> &fn)
+  {
+    if (auto *binary = dynamic_cast<Binary *>(expr))
+    {
+      fn(binary->left);
+      fn(binary->right);
+    }
+    else if (auto *call = dynamic_cast<Call *>(expr))
+    {
+      fn(call->callee);
+      for (auto &argument : call->arguments)
+        fn(argument);
+    }
+    else if (auto *get = dynamic_cast<Get *>(expr))
+      fn(get->object);
+    else if (auto *set = dynamic_cast<Set *>(expr))
+    {
+      fn(set->object);
+      fn(set->value);
+    }
+    else if (auto *index = dynamic_cast<Index *>(expr))
+    {
+      fn(index->object);
+      fn(index->index);
+    }
+    else if (auto *setIndex = dynamic_cast<SetIndex *>(expr))
+    {
+      fn(setIndex->object);
+      fn(setIndex->index);
+      fn(setIndex->value);
+    }
+    else if (auto *slice = dynamic_cast<Slice *>(expr))
+    {
+      fn(slice->object);
+      fn(slice->start);
+      fn(slice->end);
+    }
+    else if (auto *grouping = dynamic_cast<Grouping *>(expr))
+      fn(grouping->expression);
+    else if (auto *unary = dynamic_cast<Unary *>(expr))
+      fn(unary->right);
+    else if (auto *assign = dynamic_cast<Assign *>(expr))
+      fn(assign->value);
+    else if (auto *logical = dynamic_cast<Logical *>(expr))
+    {
+      fn(logical->left);
+      fn(logical->right);
+    }
+    else if (auto *assignOp = dynamic_cast<AssignOp *>(expr))
+      fn(assignOp->value);
+    else if (auto *compare = dynamic_cast<CompareVariable *>(expr))
+      fn(compare->right);
+    else if (auto *setOp = dynamic_cast<SetFieldOp *>(expr))
+    {
+      fn(setOp->object);
+      fn(setOp->value);
+    }
+    else if (auto *inlined = dynamic_cast<InlinedCall *>(expr))
+    {
+      fn(inlined->callee);
+      for (auto &argument : inlined->arguments)
+        fn(argument);
+      fn(inlined->body);
+    }
+    else if (auto *conditional = dynamic_cast<Conditional *>(expr))
+    {
+      fn(conditional->condition);
+      fn(conditional->thenBranch);
+      fn(conditional->elseBranch);
+    }
+    else if (auto *invariant = dynamic_cast<Invariant *>(expr))
+      fn(invariant->expression);
+    else if (auto *interpolation = dynamic_cast<Interpolation *>(expr))
+    {
+      for (auto &part : interpolation->parts)
+        fn(part);
+    }
+  }
+
+  void LoopInvariantCodeMotion::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    RewritePass::run(stmts, optimizer);
+    analysis.reset();
+  }
+
+  StmtPtr LoopInvariantCodeMotion::transform(StmtPtr stmt)
+  {
+    Stmt *target = stmt.get();
+    if (dynamic_cast<While *>(target) == nullptr && dynamic_cast<ForLoop *>(target) == nullptr &&
+        dynamic_cast<CountedLoop *>(target) == nullptr)
+      return stmt;
+
+    effects = LoopEffects();
+    collectEffects(target);
+    auto wrapper = std::make_unique<InvariantLoop>(nullptr);
+    loop = wrapper.get();
+    hoisted = 0;
+
+    if (auto *whileStmt = dynamic_cast<While *>(target))
+    {
+      hoistRoot(whileStmt->condition, 0);
+      hoist(whileStmt->body.get(), 0);
+    }
+    else if (auto *forLoop = dynamic_cast<ForLoop *>(target))
+    {
+      hoistRoot(forLoop->condition, 0);
+      for (auto &bodyStmt : forLoop->body)
+        hoist(bodyStmt.get(), 1);
+      hoistRoot(forLoop->increment, 1);
+    }
+    else if (auto *counted = dynamic_cast<CountedLoop *>(target))
+    {
+      // The counter's own scope changes every iteration too.
+      for (auto &bodyStmt : counted->body)
+        hoist(bodyStmt.get(), 2);
+    }
+
+    if (hoisted == 0)
+      return stmt;
+    wrapper->loop = std::move(stmt);
+    return wrapper;
+  }
+
+  void LoopInvariantCodeMotion::collectEffects(Stmt *stmt)
+  {
+    if (stmt == nullptr)
+      return;
+    // Nested function and class bodies only run when called, and any call
+    // is already assumed to have every effect.
+    if (auto *block = dynamic_cast<Block *>(stmt))
+    {
+      for (auto &inner : block->statements)
+        collectEffects(inner.get());
+    }
+    else if (auto *expression = dynamic_cast<Expression *>(stmt))
+      collectEffects(expression->expression.get());
+    else if (auto *print = dynamic_cast<Print *>(stmt))
+      collectEffects(print->expression.get());
+    else if (auto *ret = dynamic_cast<Return *>(stmt))
+      collectEffects(ret->value.get());
+    else if (auto *var = dynamic_cast<Var *>(stmt))
+      collectEffects(var->initializer.get());
+    else if (auto *ifStmt = dynamic_cast<If *>(stmt))
+    {
+      collectEffects(ifStmt->condition.get());
+      collectEffects(ifStmt->thenBranch.get());
+      collectEffects(ifStmt->elseBranch.get());
+    }
+    else if (auto *whileStmt = dynamic_cast<While *>(stmt))
+    {
+      collectEffects(whileStmt->condition.get());
+      collectEffects(whileStmt->body.get());
+    }
+    else if (auto *forLoop = dynamic_cast<ForLoop *>(stmt))
+    {
+      collectEffects(forLoop->condition.get());
+      for (auto &inner : forLoop->body)
+        collectEffects(inner.get());
+      collectEffects(forLoop->increment.get());
+    }
+    else if (auto *counted = dynamic_cast<CountedLoop *>(stmt))
+    {
+      collectEffects(counted->start.get());
+      collectEffects(counted->limit.get());
+      for (auto &inner : counted->body)
+        collectEffects(inner.get());
+    }
+    else if (auto *hoisting = dynamic_cast<InvariantLoop *>(stmt))
+      collectEffects(hoisting->loop.get());
+  }
+
+  void LoopInvariantCodeMotion::collectEffects(Expr *expr)
+  {
+    if (expr == nullptr)
+      return;
+    if (dynamic_cast<Assign *>(expr) != nullptr || dynamic_cast<AssignOp *>(expr) != nullptr)
+      effects.assigned.insert(analysis->bindingFor(expr));
+    else if (auto *set = dynamic_cast<Set *>(expr))
+      effects.fields.insert(set->name.lexeme);
+    else if (auto *setOp = dynamic_cast<SetFieldOp *>(expr))
+      effects.fields.insert(setOp->name.lexeme);
+    else if (dynamic_cast<Call *>(expr) != nullptr)
+      effects.calls = true;
+    forEachOperand(expr, [this](ExprPtr &operand)
+                   { collectEffects(operand.get()); });
+  }
+
+  void LoopInvariantCodeMotion::hoist(Stmt *stmt, int scopes)
+  {
+    if (stmt == nullptr)
+      return;
+    if (auto *block = dynamic_cast<Block *>(stmt))
+    {
+      for (auto &inner : block->statements)
+        hoist(inner.get(), scopes + 1);
+    }
+    else if (auto *expression = dynamic_cast<Expression *>(stmt))
+      hoistRoot(expression->expression, scopes);
+    else if (auto *print = dynamic_cast<Print *>(stmt))
+      hoistRoot(print->expression, scopes);
+    else if (auto *ret = dynamic_cast<Return *>(stmt))
+      hoistRoot(ret->value, scopes);
+    else if (auto *var = dynamic_cast<Var *>(stmt))
+      hoistRoot(var->initializer, scopes);
+    else if (auto *ifStmt = dynamic_cast<If *>(stmt))
+    {
+      hoistRoot(ifStmt->condition, scopes);
+      hoist(ifStmt->thenBranch.get(), scopes);
+      hoist(ifStmt->elseBranch.get(), scopes);
+    }
+    else if (auto *whileStmt = dynamic_cast<While *>(stmt))
+    {
+      hoistRoot(whileStmt->condition, scopes);
+      hoist(whileStmt->body.get(), scopes);
+    }
+    else if (auto *forLoop = dynamic_cast<ForLoop *>(stmt))
+    {
+      hoistRoot(forLoop->condition, scopes);
+      for (auto &inner : forLoop->body)
+        hoist(inner.get(), scopes + 1);
+      hoistRoot(forLoop->increment, scopes + 1);
+    }
+    else if (auto *counted = dynamic_cast<CountedLoop *>(stmt))
+    {
+      hoistRoot(counted->start, scopes + 1);
+      hoistRoot(counted->limit, scopes + 1);
+      for (auto &inner : counted->body)
+        hoist(inner.get(), scopes + 2);
+    }
+    else if (auto *hoisting = dynamic_cast<InvariantLoop *>(stmt))
+      hoist(hoisting->loop.get(), scopes);
+  }
+
+  void LoopInvariantCodeMotion::hoistRoot(ExprPtr &expr, int scopes)
+  {
+    if (expr != nullptr && hoist(expr, scopes) && isWorthHoisting(expr.get()))
+    {
+      expr = std::make_unique<Invariant>(std::move(expr), loop);
+      hoisted++;
+    }
+  }
+
+  // Returns whether expr is invariant; when it is not, wraps its largest
+  // invariant operands instead.
+  bool LoopInvariantCodeMotion::hoist(ExprPtr &expr, int scopes)
+  {
+    Expr *node = expr.get();
+    if (dynamic_cast<Literal *>(node) != nullptr)
+      return true;
+    if (auto *arg = dynamic_cast<ArgRef *>(node))
+      return !argumentFrames.empty() && argumentFrames.back()[arg->slot];
+    if (dynamic_cast<Variable *>(node) != nullptr || dynamic_cast<This *>(node) != nullptr)
+      return isInvariantBinding(node, optimizer->interpreter->resolvedDepth(node), scopes);
+
+    bool pure = dynamic_cast<Binary *>(node) != nullptr || dynamic_cast<Unary *>(node) != nullptr ||
+                dynamic_cast<Logical *>(node) != nullptr || dynamic_cast<Grouping *>(node) != nullptr ||
+                dynamic_cast<Conditional *>(node) != nullptr || dynamic_cast<Invariant *>(node) != nullptr ||
+                dynamic_cast<Interpolation *>(node) != nullptr;
+    if (auto *get = dynamic_cast<Get *>(node))
+      pure = !effects.calls && effects.fields.count(get->name.lexeme) == 0;
+    if (auto *compare = dynamic_cast<CompareVariable *>(node))
+      pure = isInvariantBinding(compare, compare->depth, scopes);
+
+    std::vector<ExprPtr *> operands;
+    forEachOperand(node, [&operands](ExprPtr &operand)
+                   { operands.push_back(&operand); });
+
+    auto *inlined = dynamic_cast<InlinedCall *>(node);
+    std::vector<bool> invariant;
+    bool all = true;
+    for (ExprPtr *operand : operands)
+    {
+      if (inlined != nullptr && operand == &inlined->body)
+      {
+        // The body reads the arguments through ArgRef slots.
+        argumentFrames.push_back(std::vector<bool>(invariant.begin() + 1, invariant.end()));
+        invariant.push_back(hoist(*operand, scopes));
+        argumentFrames.pop_back();
+      }
+      else
+      {
+        invariant.push_back(hoist(*operand, scopes));
+      }
+      all = all && invariant.back();
+    }
+    if (inlined != nullptr)
+      pure = dynamic_cast<Variable *>(inlined->callee.get()) != nullptr;
+
+    if (pure && all)
+      return true;
+    for (size_t i = 0; i < operands.size(); i++)
+    {
+      if (invariant[i] && isWorthHoisting(operands[i]->get()))
+      {
+        *operands[i] = std::make_unique<Invariant>(std::move(*operands[i]), loop);
+        hoisted++;
+      }
+    }
+    return false;
+  }
+
+  bool LoopInvariantCodeMotion::isInvariantBinding(const Expr *expr, int depth, int scopes) const
+  {
+    // Declared inside the loop: a fresh variable each iteration.
+    if (depth > -1 && depth < scopes)
+      return false;
+    const Binding *binding = analysis->bindingFor(expr);
+    if (binding == nullptr || effects.assigned.count(binding) != 0)
+      return false;
+    if (!effects.calls)
+      return true;
+    if (binding->assignments == 0 && binding->declarations == 1)
+      return true;
+    return !binding->global && !binding->captured;
+  }
+
+  bool LoopInvariantCodeMotion::isWorthHoisting(const Expr *expr) const
+  {
+    if (dynamic_cast<const Literal *>(expr) != nullptr || dynamic_cast<const ArgRef *>(expr) != nullptr ||
+        dynamic_cast<const Invariant *>(expr) != nullptr || dynamic_cast<const This *>(expr) != nullptr)
+      return false;
+    // Locals are a short walk; globals and anything computed are worth it.
+    if (dynamic_cast<const Variable *>(expr) != nullptr)
+      return optimizer->interpreter->resolvedDepth(expr) == -1;
+    return true;
+  }
+
+  void TypeInference::run(std::vector<StmtPtr> &stmts, Optimizer &optimizer)
+  {
+    analysis = std::make_unique<BindingAnalysis>(*optimizer.interpreter);
+    analysis->analyze(stmts);
+    wholeProgram = optimizer.wholeProgram;
+    infer(stmts);
+    mark(optimizer.report);
+    binaryOperands.clear();
+    unaryOperands.clear();
+    state.clear();
+    declared.clear();
+    analysis.reset();
+  }
+
+  TypeInference::Type TypeInference::join(Type a, Type b)
+  {
+    if (a == Type::NONE)
+      return b;
+    if (b == Type::NONE || a == b)
+      return a;
+    return Type::ANY;
+  }
+
+  void TypeInference::join(State &into, const State &from)
+  {
+    for (const auto &entry : from)
+    {
+      into[entry.first] = join(into[entry.first], entry.second);
+    }
+  }
+
+  // What an operator yields when it yields at all: arithmetic that fails
+  // throws instead.
+  TypeInference::Type TypeInference::binaryType(TokenType op, Type left, Type right)
+  {
+    switch (op)
+    {
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+      return Type::NUMBER;
+    case TokenType::PLUS:
+      if (left == Type::NUMBER && right == Type::NUMBER)
+        return Type::NUMBER;
+      if (left == Type::STRING && right == Type::STRING)
+        return Type::STRING;
+      return Type::ANY;
+    default:
+      return Type::BOOL;
+    }
+  }
+
+  TypeInference::Type TypeInference::read(const Binding *binding) const
+  {
+    auto annotated = binding != nullptr ? declared.find(binding) : declared.end();
+    if (annotated != declared.end())
+      return annotated->second;
+    auto it = binding != nullptr ? state.find(binding) : state.end();
+    if (it == state.end() || it->second == Type::NONE)
+      return Type::ANY;
+    return it->second;
+  }
+
+  void TypeInference::declare(const Binding *binding, Annotation annotation)
+  {
+    // A global is trusted only when this is its one declaration anywhere:
+    // code running before the Var sees its old value, or none, and a later
+    // REPL line may declare it again without the annotation. Code after the
+    // Var in source order runs after it, and the global's environment
+    // checks every later store.
+    if (binding == nullptr || (binding->global && (!wholeProgram || binding->declarations != 1)))
+      return;
+    switch (annotation)
+    {
+    case Annotation::NUM:
+      declared[binding] = Type::NUMBER;
+      break;
+    case Annotation::STR:
+      declared[binding] = Type::STRING;
+      break;
+    case Annotation::BOOL:
+      declared[binding] = Type::BOOL;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void TypeInference::write(const Binding *binding, Type type)
+  {
+    if (binding == nullptr || binding->global || binding->captured)
+      return;
+    state[binding] = type;
+    if (!assigned.empty())
+    {
+      Type &any = assigned.back()[binding];
+      any = join(any, type);
+    }
+  }
+
+  void TypeInference::recovering(const std::function<void()> &body)
+  {
+    State entry = state;
+    assigned.emplace_back();
+    body();
+    State inside = std::move(assigned.back());
+    assigned.pop_back();
+    for (const auto &entryType : inside)
+    {
+      // Variables declared inside are out of scope afterwards.
+      auto before = entry.find(entryType.first);
+      if (before == entry.end())
+        continue;
+      Type &type = state[entryType.first];
+      type = join(join(type, before->second), entryType.second);
+      if (!assigned.empty())
+      {
+        Type &any = assigned.back()[entryType.first];
+        any = join(any, entryType.second);
+      }
+    }
+  }
+
+  void TypeInference::loop(const std::function<void()> &condition, const std::function<void()> &body)
+  {
+    State head = state;
+    while (true)
+    {
+      state = head;
+      condition();
+      State exit = state;
+      body();
+      State next = head;
+      join(next, state);
+      if (next == head)
+      {
+        state = std::move(exit);
+        return;
+      }
+      head = std::move(next);
+    }
+  }
+
+  void TypeInference::function(const Function *function)
+  {
+    // A function's locals are its own; everything it shares with the
+    // enclosing code is captured, global or a field, hence unknown.
+    State enclosing = std::move(state);
+    std::vector<State> enclosingAssigned = std::move(assigned);
+    state.clear();
+    assigned.clear();
+    recovering([&]()
+               {
+                 for (size_t i = 0; i < function->params.size(); i++)
+                 {
+                   const Binding *binding = analysis->bindingFor(&function->params[i]);
+                   if (i < function->paramTypes.size())
+                     declare(binding, function->paramTypes[i]);
+                   write(binding, Type::ANY);
+                 }
+                 infer(function->body); });
+    state = std::move(enclosing);
+    assigned = std::move(enclosingAssigned);
+  }
+
+  void TypeInference::infer(const std::vector<StmtPtr> &stmts)
+  {
+    for (const auto &stmt : stmts)
+    {
+      infer(stmt.get());
+    }
+  }
+
+  void TypeInference::infer(const Stmt *stmt)
+  {
+    if (stmt == nullptr)
+      return;
+
+    if (auto *expression = dynamic_cast<const Expression *>(stmt))
+    {
+      infer(expression->expression.get());
+    }
+    else if (auto *print = dynamic_cast<const Print *>(stmt))
+    {
+      infer(print->expression.get());
+    }
+    else if (auto *ret = dynamic_cast<const Return *>(stmt))
+    {
+      infer(ret->value.get());
+    }
+    else if (auto *var = dynamic_cast<const Var *>(stmt))
+    {
+      // `var x;` holds no value at all, which is not nil.
+      Type type = var->initializer != nullptr ? infer(var->initializer.get()) : Type::ANY;
+      declare(analysis->bindingFor(stmt), var->annotation);
+      write(analysis->bindingFor(stmt), type);
+    }
+    else if (auto *block = dynamic_cast<const Block *>(stmt))
+    {
+      recovering([&]()
+                 { infer(block->statements); });
+    }
+    else if (auto *ifStmt = dynamic_cast<const If *>(stmt))
+    {
+      infer(ifStmt->condition.get());
+      State otherwise = state;
+      infer(ifStmt->thenBranch.get());
+      std::swap(state, otherwise);
+      infer(ifStmt->elseBranch.get());
+      join(state, otherwise);
+    }
+    else if (auto *whileStmt = dynamic_cast<const While *>(stmt))
+    {
+      loop([&]()
+           { infer(whileStmt->condition.get()); },
+           [&]()
+           { infer(whileStmt->body.get()); });
+    }
+    else if (auto *forLoop = dynamic_cast<const ForLoop *>(stmt))
+    {
+      loop([&]()
+           { infer(forLoop->condition.get()); },
+           [&]()
+           { recovering([&]()
+                        {
+                          infer(forLoop->body);
+                          infer(forLoop->increment.get()); }); });
+    }
+    else if (auto *counted = dynamic_cast<const CountedLoop *>(stmt))
+    {
+      recovering([&]()
+                 {
+                   Type start = counted->start != nullptr ? infer(counted->start.get()) : Type::NIL;
+                   const Binding *counter = analysis->bindingFor(stmt);
+                   // Stepping yields numbers, or fails.
+                   write(counter, join(start, Type::NUMBER));
+                   infer(counted->limit.get());
+                   loop([&]()
+                        { write(counter, join(read(counter), Type::NUMBER)); },
+                        [&]()
+                        { recovering([&]()
+                                     { infer(counted->body); }); }); });
+    }
+    else if (auto *invariantLoop = dynamic_cast<const InvariantLoop *>(stmt))
+    {
+      infer(invariantLoop->loop.get());
+    }
+    else if (auto *functionStmt = dynamic_cast<const Function *>(stmt))
+    {
+      write(analysis->bindingFor(stmt), Type::ANY);
+      function(functionStmt);
+    }
+    else if (auto *klass = dynamic_cast<const Class *>(stmt))
+    {
+      infer(klass->superclass.get());
+      write(analysis->bindingFor(stmt), Type::ANY);
+      for (const auto &method : klass->methods)
+      {
+        function(dynamic_cast<const Function *>(method.get()));
+      }
+    }
+  }
+
+  TypeInference::Type TypeInference::infer(const Expr *expr)
+  {
+    if (expr == nullptr)
+      return Type::NIL;
+
+    if (auto *literal = dynamic_cast<const Literal *>(expr))
+    {
+      if (isNumber(literal->value))
+        return Type::NUMBER;
+      if (std::holds_alternative<std::string>(literal->value))
+        return Type::STRING;
+      if (std::holds_alternative<bool>(literal->value))
+        return Type::BOOL;
+      return Type::NIL;
+    }
+    if (auto *grouping = dynamic_cast<const Grouping *>(expr))
+      return infer(grouping->expression.get());
+    if (auto *invariant = dynamic_cast<const Invariant *>(expr))
+      return infer(invariant->expression.get());
+    if (auto *unary = dynamic_cast<const Unary *>(expr))
+    {
+      Type operand = infer(unary->right.get());
+      if (unary->op.type == TokenType::BANG)
+        return Type::BOOL;
+      unaryOperands[unary] = join(unaryOperands[unary], operand);
+      return Type::NUMBER;
+    }
+    if (auto *binary = dynamic_cast<const Binary *>(expr))
+    {
+      Type left = infer(binary->left.get());
+      Type right = infer(binary->right.get());
+      auto &seen = binaryOperands[binary];
+      seen.first = join(seen.first, left);
+      seen.second = join(seen.second, right);
+      return binaryType(binary->op.type, left, right);
+    }
+    if (auto *logical = dynamic_cast<const Logical *>(expr))
+    {
+      Type left = infer(logical->left.get());
+      State shortCircuit = state;
+      Type right = infer(logical->right.get());
+      join(state, shortCircuit);
+      return join(left, right);
+    }
+    if (auto *conditional = dynamic_cast<const Conditional *>(expr))
+    {
+      infer(conditional->condition.get());
+      State otherwise = state;
+      Type thenType = infer(conditional->thenBranch.get());
+      std::swap(state, otherwise);
+      Type elseType = infer(conditional->elseBranch.get());
+      join(state, otherwise);
+      return join(thenType, elseType);
+    }
+    if (dynamic_cast<const Variable *>(expr) != nullptr)
+      return read(analysis->bindingFor(expr));
+    if (auto *assign = dynamic_cast<const Assign *>(expr))
+    {
+      Type type = infer(assign->value.get());
+      write(analysis->bindingFor(expr), type);
+      return type;
+    }
+    if (auto *assignOp = dynamic_cast<const AssignOp *>(expr))
+    {
+      Type operand = infer(assignOp->value.get());
+      const Binding *binding = analysis->bindingFor(expr);
+      Type type = binaryType(assignOp->op.type, read(binding), operand);
+      write(binding, type);
+      return type;
+    }
+    if (auto *compare = dynamic_cast<const CompareVariable *>(expr))
+    {
+      infer(compare->right.get());
+      return Type::BOOL;
+    }
+    if (auto *set = dynamic_cast<const Set *>(expr))
+    {
+      infer(set->object.get());
+      return infer(set->value.get());
+    }
+    if (auto *setFieldOp = dynamic_cast<const SetFieldOp *>(expr))
+    {
+      infer(setFieldOp->object.get());
+      return binaryType(setFieldOp->op.type, Type::ANY, infer(setFieldOp->value.get()));
+    }
+    if (auto *inlined = dynamic_cast<const InlinedCall *>(expr))
+    {
+      infer(inlined->callee.get());
+      for (const auto &argument : inlined->arguments)
+      {
+        infer(argument.get());
+      }
+      recovering([&]()
+                 { infer(inlined->body.get()); });
+      return Type::ANY;
+    }
+    if (auto *call = dynamic_cast<const Call *>(expr))
+    {
+      infer(call->callee.get());
+      for (const auto &argument : call->arguments)
+      {
+        infer(argument.get());
+      }
+      return Type::ANY;
+    }
+    if (auto *get = dynamic_cast<const Get *>(expr))
+    {
+      infer(get->object.get());
+      return Type::ANY;
+    }
+    if (auto *index = dynamic_cast<const Index *>(expr))
+    {
+      infer(index->object.get());
+      infer(index->index.get());
+      return Type::ANY;
+    }
+    if (auto *setIndex = dynamic_cast<const SetIndex *>(expr))
+    {
+      infer(setIndex->object.get());
+      infer(setIndex->index.get());
+      return infer(setIndex->value.get());
+    }
+    if (auto *slice = dynamic_cast<const Slice *>(expr))
+    {
+      infer(slice->object.get());
+      infer(slice->start.get());
+      infer(slice->end.get());
+      return Type::ANY;
+    }
+    if (auto *interpolation = dynamic_cast<const Interpolation *>(expr))
+    {
+      for (const auto &part : interpolation->parts)
+      {
+        infer(part.get());
+      }
+      return Type::STRING;
+    }
+    // This, Super and ArgRef.
+    return Type::ANY;
+  }
+
+  void TypeInference::mark(std::ostream *report)
+  {
+    int arithmetic = 0;
+    int numeric = 0;
+    int strings = 0;
+    for (const auto &entry : binaryOperands)
+    {
+      const Binary *binary = entry.first;
+      TokenType op = binary->op.type;
+      if (op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL)
+        continue;
+      arithmetic++;
+      if (op == TokenType::PLUS && entry.second.first == Type::STRING && entry.second.second == Type::STRING)
+      {
+        binary->kind = BinaryKind::CONCAT_STRINGS;
+        binary->proven = true;
+        strings++;
+      }
+      else if (entry.second.first == Type::NUMBER && entry.second.second == Type::NUMBER)
+      {
+        binary->kind = integerKind(numberKind(op));
+        binary->proven = true;
+        numeric++;
+      }
+    }
+    for (const auto &entry : unaryOperands)
+    {
+      arithmetic++;
+      if (entry.second == Type::NUMBER)
+      {
+        entry.first->proven = true;
+        numeric++;
+      }
+    }
+
+    if (report == nullptr)
+      return;
+    *report << "Type inference: ";
+    if (arithmetic == 0)
+    {
+      *report << "no arithmetic nodes." << std::endl;
+      return;
+    }
+    *report << (100 * numeric / arithmetic) << "% of arithmetic nodes proven numeric (" << numeric << " of "
+            << arithmetic << "), " << strings << " proven string concatenations." << std::endl;
+  }
+}
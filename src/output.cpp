@@ -0,0 +1,29 @@
+#include <iostream>
+#include <unistd.h>
+
+#include "cpplox/output.h"
+
+namespace CppLox
+{
+  static const size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+  bool Output::interactive = true;
+
+  void Output::init()
+  {
+    static char buffer[OUTPUT_BUFFER_SIZE];
+    // Unsynchronized, std::cout has its own buffer rather than writing
+    // through to stdio a character at a time.
+    std::ios::sync_with_stdio(false);
+    std::cout.rdbuf()->pubsetbuf(buffer, sizeof buffer);
+    interactive = isatty(STDOUT_FILENO);
+  }
+
+  void Output::line(std::string_view text)
+  {
+    std::cout.write(text.data(), text.size());
+    std::cout.put('\n');
+    if (interactive)
+      std::cout.flush();
+  }
+}
@@ -69,13 +69,20 @@ namespace CppLox
       if (varExpr)
       {
         Token name = varExpr->name;
-        return std::make_unique<Assign>(name, std::move(value));
+        ExprPtr assign = std::make_unique<Assign>(name, std::move(value));
+        resolveLocal(assign.get(), name);
+        return assign;
       }
       Get *getExpr = dynamic_cast<Get *>(expr.get());
       if (getExpr)
       {
         return std::make_unique<Set>(std::move(getExpr->object), getExpr->name, std::move(value));
       }
+      Index *indexExpr = dynamic_cast<Index *>(expr.get());
+      if (indexExpr)
+      {
+        return std::make_unique<SetIndex>(std::move(indexExpr->object), indexExpr->bracket, std::move(indexExpr->index), std::move(value));
+      }
       lox::error(equals, "Invalid assignment target.");
     }
     return expr;
@@ -98,17 +105,58 @@ namespace CppLox
       Token keyword = previous();
       consume(TokenType::DOT, "Expect '.' after 'super'.");
       Token method = consume(TokenType::IDENTIFIER, "Expect superclass method name.");
-      return std::make_unique<Super>(keyword, method);
+      ExprPtr expr = std::make_unique<Super>(keyword, method);
+      if (resolving())
+      {
+        if (currentClass == ClassType::NONE)
+        {
+          lox::error(keyword, "Cannot use 'super' outside of a class.");
+        }
+        else if (currentClass != ClassType::SUBCLASS)
+        {
+          lox::error(keyword, "Cannot use 'super' in a class with no superclass.");
+        }
+        resolveLocal(expr.get(), keyword);
+      }
+      return expr;
     }
 
     if (match({TokenType::THIS}))
     {
-      return std::make_unique<This>(previous());
+      ExprPtr expr = std::make_unique<This>(previous());
+      if (resolving())
+      {
+        if (currentClass == ClassType::NONE)
+        {
+          lox::error(previous(), "Cannot use 'this' outside of a class.");
+        }
+        else
+        {
+          resolveLocal(expr.get(), previous());
+        }
+      }
+      return expr;
     }
 
     if (match({TokenType::IDENTIFIER}))
     {
-      return std::make_unique<Variable>(previous());
+      Token name = previous();
+      ExprPtr expr = std::make_unique<Variable>(name);
+      // An assignment target is resolved as an Assign node by assignment().
+      if (resolving() && !check(TokenType::EQUAL))
+      {
+        if (!scopes.empty())
+        {
+          Scope &top = scopes.back();
+          auto it = top.find(name.lexeme);
+          if (it != top.end() && !it->second)
+          {
+            lox::error(name, "Cannot read local variable in its own initializer.");
+          }
+        }
+        resolveLocal(expr.get(), name);
+      }
+      return expr;
     }
 
     if (match({TokenType::NIL}))
@@ -121,6 +169,11 @@ namespace CppLox
       return std::make_unique<Literal>(previous().literal);
     }
 
+    if (match({TokenType::INTERPOLATION}))
+    {
+      return interpolation();
+    }
+
     if (match({TokenType::LEFT_PAREN}))
     {
       ExprPtr expr = expression();
@@ -131,6 +184,29 @@ namespace CppLox
     throw error(peek(), "Expect expression");
   }
 
+  // "a ${b} c" scans as INTERPOLATION("a ") b STRING(" c"); empty text
+  // between the expressions is dropped.
+  ExprPtr Parser::interpolation()
+  {
+    Token quote = previous();
+    std::vector<ExprPtr> parts;
+    do
+    {
+      if (!std::get<std::string>(previous().literal).empty())
+      {
+        parts.push_back(std::make_unique<Literal>(previous().literal));
+      }
+      parts.push_back(expression());
+    } while (match({TokenType::INTERPOLATION}));
+
+    consume(TokenType::STRING, "Expect '}' after interpolated expression.");
+    if (!std::get<std::string>(previous().literal).empty())
+    {
+      parts.push_back(std::make_unique<Literal>(previous().literal));
+    }
+    return std::make_unique<Interpolation>(std::move(quote), std::move(parts));
+  }
+
   Token Parser::consume(TokenType type, std::string errorMessage)
   {
     if (check(type))
@@ -174,6 +250,20 @@ namespace CppLox
     return std::make_unique<Call>(std::move(callee), paren, std::move(arguments));
   }
 
+  // a[i], or a slice a[start:end] where a missing bound is nil.
+  ExprPtr Parser::finishIndex(ExprPtr object)
+  {
+    ExprPtr start = check(TokenType::COLON) ? ExprPtr(std::make_unique<Literal>(nullptr)) : expression();
+    if (match({TokenType::COLON}))
+    {
+      ExprPtr end = check(TokenType::RIGHT_BRACKET) ? ExprPtr(std::make_unique<Literal>(nullptr)) : expression();
+      Token bracket = consume(TokenType::RIGHT_BRACKET, "Expect ']' after slice.");
+      return std::make_unique<Slice>(std::move(object), bracket, std::move(start), std::move(end));
+    }
+    Token bracket = consume(TokenType::RIGHT_BRACKET, "Expect ']' after index.");
+    return std::make_unique<Index>(std::move(object), bracket, std::move(start));
+  }
+
   ExprPtr Parser::call()
   {
     ExprPtr expr = primary();
@@ -188,6 +278,10 @@ namespace CppLox
         Token name = consume(TokenType::IDENTIFIER, "Expect property name after '.'.");
         expr = std::make_unique<Get>(std::move(expr), name);
       }
+      else if (match({TokenType::LEFT_BRACKET}))
+      {
+        expr = finishIndex(std::move(expr));
+      }
       else
       {
         break;
@@ -335,7 +429,10 @@ namespace CppLox
     }
     if (match({TokenType::LEFT_BRACE}))
     {
-      return std::make_unique<Block>(std::move(block()));
+      beginScope();
+      std::vector<StmtPtr> statements = block();
+      endScope();
+      return std::make_unique<Block>(std::move(statements));
     }
     return expressionStatement();
   }
@@ -357,12 +454,33 @@ namespace CppLox
   StmtPtr Parser::classDeclaration()
   {
     Token name = consume(TokenType::IDENTIFIER, "Expect class name.");
+    ClassType enclosingClass = currentClass;
+    currentClass = ClassType::CLASS;
+    declare(name);
+    define(name);
 
     ExprPtr superclass;
     if (match({TokenType::LESS}))
     {
       consume(TokenType::IDENTIFIER, "Expect superclass name.");
       superclass = std::make_unique<Variable>(previous());
+      if (resolving())
+      {
+        if (previous().lexeme == name.lexeme)
+        {
+          lox::error(previous(), "A class cannot inherit from itself.");
+        }
+        currentClass = ClassType::SUBCLASS;
+        resolveLocal(superclass.get(), previous());
+        beginScope();
+        scopes.back()["super"] = true;
+      }
+    }
+
+    beginScope();
+    if (resolving())
+    {
+      scopes.back()["this"] = true;
     }
 
     consume(TokenType::LEFT_BRACE, "Expect '{' before class body.");
@@ -372,11 +490,21 @@ namespace CppLox
       methods.push_back(function("method"));
     }
     consume(RIGHT_BRACE, "Expect '}' after class body.");
+
+    endScope();
+    if (superclass != nullptr)
+    {
+      endScope();
+    }
+    currentClass = enclosingClass;
     return std::make_unique<Class>(name, std::move(superclass), std::move(methods));
   }
 
   StmtPtr Parser::declaration()
   {
+    size_t scopeDepth = scopes.size();
+    FunctionType enclosingFunction = currentFunction;
+    ClassType enclosingClass = currentClass;
     try
     {
       if (match({TokenType::CLASS}))
@@ -395,6 +523,10 @@ namespace CppLox
     }
     catch (const ParserError &error)
     {
+      // Unwind any scopes the failed declaration left open.
+      scopes.resize(scopeDepth);
+      currentFunction = enclosingFunction;
+      currentClass = enclosingClass;
       synchronize();
       return nullptr;
     }
@@ -403,8 +535,23 @@ namespace CppLox
   StmtPtr Parser::function(std::string kind)
   {
     Token name = consume(TokenType::IDENTIFIER, "Expect " + kind + " name.");
+    FunctionType type = FunctionType::FUNCTION;
+    if (kind == "method")
+    {
+      type = name.lexeme == "init" ? FunctionType::INITIALIZER : FunctionType::METHOD;
+    }
+    else
+    {
+      declare(name);
+      define(name);
+    }
+    FunctionType enclosingFunction = currentFunction;
+    currentFunction = type;
+    beginScope();
+
     consume(TokenType::LEFT_PAREN, "Expect '(' after " + kind + " name.");
     std::vector<Token> parameters;
+    std::vector<Annotation> paramTypes;
     if (!check(TokenType::RIGHT_PAREN))
     {
       do
@@ -414,24 +561,56 @@ namespace CppLox
           error(peek(), "Cannot have more than 255 parameters.");
         }
         parameters.push_back(consume(TokenType::IDENTIFIER, "Expect parameter name."));
+        declare(parameters.back());
+        define(parameters.back());
+        paramTypes.push_back(match({TokenType::COLON}) ? typeAnnotation() : Annotation::NONE);
       } while (match({TokenType::COMMA}));
     }
     consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
+    Annotation returnType = match({TokenType::COLON}) ? typeAnnotation() : Annotation::NONE;
     consume(TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body.");
     std::vector<StmtPtr> body = block();
-    return std::make_unique<Function>(name, std::move(parameters), std::move(body));
+    endScope();
+    currentFunction = enclosingFunction;
+    bool annotatedParams = false;
+    for (Annotation paramType : paramTypes)
+    {
+      annotatedParams = annotatedParams || paramType != Annotation::NONE;
+    }
+    if (!annotatedParams)
+    {
+      paramTypes.clear();
+    }
+    return std::make_unique<Function>(name, std::move(parameters), std::move(body), std::move(paramTypes), returnType);
   }
 
   StmtPtr Parser::varDeclaration()
   {
     Token name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+    declare(name);
+    Annotation annotation = match({TokenType::COLON}) ? typeAnnotation() : Annotation::NONE;
     ExprPtr initializer = nullptr;
     if (match({TokenType::EQUAL}))
     {
       initializer = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-    return std::make_unique<Var>(name, std::move(initializer));
+    define(name);
+    return std::make_unique<Var>(name, std::move(initializer), annotation);
+  }
+
+  // The type after a ':'.
+  Annotation Parser::typeAnnotation()
+  {
+    Token type = consume(TokenType::IDENTIFIER, "Expect type after ':'.");
+    if (type.lexeme == "num")
+      return Annotation::NUM;
+    if (type.lexeme == "str")
+      return Annotation::STR;
+    if (type.lexeme == "bool")
+      return Annotation::BOOL;
+    error(type, "Unknown type '" + type.lexeme + "'.");
+    return Annotation::NONE;
   }
 
   std::vector<StmtPtr> Parser::block()
@@ -474,6 +653,7 @@ namespace CppLox
   StmtPtr Parser::forStatement()
   {
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'for' .");
+    beginScope();
     StmtPtr initializer;
     if (match({TokenType::SEMICOLON}))
     {
@@ -496,12 +676,47 @@ namespace CppLox
     consume(TokenType::SEMICOLON, "Expect ';' after loop condition.");
 
     ExprPtr increment;
+    int incrementStart = -1;
     if (!check(TokenType::RIGHT_PAREN))
     {
-      increment = expression();
+      if (resolving())
+      {
+        // The increment runs inside the body's block, so it is parsed once
+        // that scope is open.
+        incrementStart = current;
+        skipIncrement();
+      }
+      else
+      {
+        increment = expression();
+      }
     }
     consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
-    StmtPtr body = statement();
+
+    StmtPtr body;
+    if (incrementStart != -1)
+    {
+      beginScope();
+      std::vector<StmtPtr> bodyStmts;
+      if (match({TokenType::LEFT_BRACE}))
+      {
+        bodyStmts = block();
+      }
+      else
+      {
+        bodyStmts.push_back(statement());
+      }
+      int resume = current;
+      current = incrementStart;
+      increment = expression();
+      current = resume;
+      endScope();
+      body = std::make_unique<Block>(std::move(bodyStmts));
+    }
+    else
+    {
+      body = statement();
+    }
 
     std::vector<StmtPtr> stmts;
 
@@ -513,6 +728,13 @@ namespace CppLox
     if (increment != nullptr)
     {
       Block *block = dynamic_cast<Block *>(body.get());
+      if (block == nullptr)
+      {
+        std::vector<StmtPtr> bodyStmts;
+        bodyStmts.push_back(std::move(body));
+        body = std::make_unique<Block>(std::move(bodyStmts));
+        block = dynamic_cast<Block *>(body.get());
+      }
       block->statements.push_back(std::make_unique<Expression>(std::move(increment)));
     }
 
@@ -526,19 +748,104 @@ namespace CppLox
       stmts.push_back(std::make_unique<While>(std::move(condition), std::move(body)));
     }
 
+    endScope();
     return std::make_unique<Block>(std::move(stmts));
   }
 
   StmtPtr Parser::returnStatement()
   {
     Token keyword = previous();
+    if (resolving() && currentFunction == FunctionType::NONE)
+    {
+      lox::error(keyword, "Cannot return from top-level code.");
+    }
     ExprPtr value = nullptr;
     if (!check(TokenType::SEMICOLON))
     {
+      if (resolving() && currentFunction == FunctionType::INITIALIZER)
+      {
+        lox::error(keyword, "Cannot return a value from an initializer.");
+      }
       value = expression();
     }
     consume(TokenType::SEMICOLON, "Expect ';' after return value.");
     return std::make_unique<Return>(keyword, std::move(value));
   }
 
-}
\ No newline at end of file
+  bool Parser::resolving() const
+  {
+    return interpreter != nullptr;
+  }
+
+  void Parser::beginScope()
+  {
+    if (resolving())
+    {
+      scopes.push_back(Scope());
+    }
+  }
+
+  void Parser::endScope()
+  {
+    if (!scopes.empty())
+    {
+      scopes.pop_back();
+    }
+  }
+
+  void Parser::declare(const Token &name)
+  {
+    if (scopes.empty())
+    {
+      return;
+    }
+    Scope &scope = scopes.back();
+    if (scope.find(name.lexeme) != scope.end())
+    {
+      lox::error(name, "Variable with this name already declared in this scope.");
+    }
+    scope[name.lexeme] = false;
+  }
+
+  void Parser::define(const Token &name)
+  {
+    if (scopes.empty())
+    {
+      return;
+    }
+    scopes.back()[name.lexeme] = true;
+  }
+
+  void Parser::resolveLocal(const Expr *expr, const Token &name)
+  {
+    for (int i = scopes.size() - 1; i >= 0; i--)
+    {
+      if (scopes[i].find(name.lexeme) != scopes[i].end())
+      {
+        interpreter->resolve(expr, scopes.size() - 1 - i);
+        return;
+      }
+    }
+  }
+
+  void Parser::skipIncrement()
+  {
+    int depth = 0;
+    while (!isAtEnd())
+    {
+      if (check(TokenType::LEFT_PAREN))
+      {
+        depth++;
+      }
+      else if (check(TokenType::RIGHT_PAREN))
+      {
+        if (depth == 0)
+        {
+          return;
+        }
+        depth--;
+      }
+      advance();
+    }
+  }
+}
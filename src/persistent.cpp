@@ -0,0 +1,354 @@
+#include "cpplox/persistent.h"
+#include "cpplox/loxmap.h"
+
+namespace CppLox
+{
+  PersistentVector::PersistentVector() : root(std::make_shared<Node>()), tail(std::make_shared<Node>()) {}
+
+  const PersistentVector::NodePtr &PersistentVector::leafFor(size_t index) const
+  {
+    const NodePtr *node = &root;
+    for (unsigned level = shift; level > 0; level -= BITS)
+      node = &(*node)->children[(index >> level) & MASK];
+    return *node;
+  }
+
+  const std::any &PersistentVector::at(size_t index) const
+  {
+    if (index >= tailOffset())
+      return tail->values[index & MASK];
+    return leafFor(index)->values[index & MASK];
+  }
+
+  PersistentVector PersistentVector::push(std::any value) const
+  {
+    PersistentVector result = *this;
+    result.count++;
+    if (count - tailOffset() < WIDTH)
+    {
+      auto leaf = std::make_shared<Node>(*tail);
+      leaf->values.push_back(std::move(value));
+      result.tail = std::move(leaf);
+      return result;
+    }
+
+    // The tail is full, so it moves into the trie, under a new root if
+    // the old one has no room left.
+    if ((count >> BITS) > (size_t(1) << shift))
+    {
+      auto top = std::make_shared<Node>();
+      top->children.push_back(root);
+      top->children.push_back(newPath(shift, tail));
+      result.root = std::move(top);
+      result.shift = shift + BITS;
+    }
+    else
+    {
+      result.root = pushTail(shift, *root, tail);
+    }
+    auto leaf = std::make_shared<Node>();
+    leaf->values.push_back(std::move(value));
+    result.tail = std::move(leaf);
+    return result;
+  }
+
+  // A copy of parent with leaf added after its last element.
+  PersistentVector::NodePtr PersistentVector::pushTail(unsigned level, const Node &parent, NodePtr leaf) const
+  {
+    auto node = std::make_shared<Node>(parent);
+    size_t child = ((count - 1) >> level) & MASK;
+    NodePtr inserted;
+    if (level == BITS)
+      inserted = std::move(leaf);
+    else if (child < parent.children.size())
+      inserted = pushTail(level - BITS, *parent.children[child], std::move(leaf));
+    else
+      inserted = newPath(level - BITS, std::move(leaf));
+    if (child < node->children.size())
+      node->children[child] = std::move(inserted);
+    else
+      node->children.push_back(std::move(inserted));
+    return node;
+  }
+
+  // A chain of single-child branches from level down to leaf.
+  PersistentVector::NodePtr PersistentVector::newPath(unsigned level, NodePtr leaf)
+  {
+    if (level == 0)
+      return leaf;
+    auto node = std::make_shared<Node>();
+    node->children.push_back(newPath(level - BITS, std::move(leaf)));
+    return node;
+  }
+
+  PersistentVector PersistentVector::set(size_t index, std::any value) const
+  {
+    PersistentVector result = *this;
+    if (index >= tailOffset())
+    {
+      auto leaf = std::make_shared<Node>(*tail);
+      leaf->values[index & MASK] = std::move(value);
+      result.tail = std::move(leaf);
+    }
+    else
+    {
+      result.root = assoc(shift, *root, index, std::move(value));
+    }
+    return result;
+  }
+
+  PersistentVector::NodePtr PersistentVector::assoc(unsigned level, const Node &node, size_t index, std::any value)
+  {
+    auto copy = std::make_shared<Node>(node);
+    if (level == 0)
+    {
+      copy->values[index & MASK] = std::move(value);
+    }
+    else
+    {
+      size_t child = (index >> level) & MASK;
+      copy->children[child] = assoc(level - BITS, *node.children[child], index, std::move(value));
+    }
+    return copy;
+  }
+
+  PersistentVector PersistentVector::pop() const
+  {
+    if (count == 1)
+      return PersistentVector();
+    PersistentVector result = *this;
+    result.count--;
+    if (count - tailOffset() > 1)
+    {
+      auto leaf = std::make_shared<Node>(*tail);
+      leaf->values.pop_back();
+      result.tail = std::move(leaf);
+      return result;
+    }
+
+    // The tail empties, so the trie's last leaf becomes the tail, and a
+    // root left with one child gives way to it.
+    result.tail = leafFor(count - 2);
+    NodePtr trimmed = popTail(shift, *root);
+    if (trimmed == nullptr)
+      trimmed = std::make_shared<Node>();
+    if (shift > BITS && trimmed->children.size() == 1)
+    {
+      result.root = trimmed->children[0];
+      result.shift = shift - BITS;
+    }
+    else
+    {
+      result.root = std::move(trimmed);
+    }
+    return result;
+  }
+
+  // A copy of node without its last leaf, or nullptr if that leaves it
+  // empty.
+  PersistentVector::NodePtr PersistentVector::popTail(unsigned level, const Node &node) const
+  {
+    size_t child = ((count - 2) >> level) & MASK;
+    if (level > BITS)
+    {
+      NodePtr trimmed = popTail(level - BITS, *node.children[child]);
+      if (trimmed == nullptr && child == 0)
+        return nullptr;
+      auto copy = std::make_shared<Node>(node);
+      if (trimmed == nullptr)
+        copy->children.pop_back();
+      else
+        copy->children[child] = std::move(trimmed);
+      return copy;
+    }
+    if (child == 0)
+      return nullptr;
+    auto copy = std::make_shared<Node>(node);
+    copy->children.pop_back();
+    return copy;
+  }
+
+  static const unsigned MAP_BITS = 5;
+  static const unsigned MAP_MASK = (1u << MAP_BITS) - 1;
+  // Nodes this deep have used the whole hash and hold colliding entries.
+  static const unsigned HASH_BITS = 64;
+
+  static uint32_t positionBit(uint64_t hash, unsigned shift)
+  {
+    return uint32_t(1) << ((hash >> shift) & MAP_MASK);
+  }
+
+  // Where a position's entry or child sits in its packed array.
+  static size_t packedIndex(uint32_t bitmap, uint32_t bit)
+  {
+    return static_cast<size_t>(__builtin_popcount(bitmap & (bit - 1)));
+  }
+
+  PersistentMap::PersistentMap() : root(std::make_shared<Node>()) {}
+
+  const std::any *PersistentMap::get(const std::any &key) const
+  {
+    uint64_t hash = LoxMap::hashKey(key);
+    const Node *node = root.get();
+    for (unsigned shift = 0; shift < HASH_BITS; shift += MAP_BITS)
+    {
+      uint32_t bit = positionBit(hash, shift);
+      if ((node->entryMap & bit) != 0)
+      {
+        const Entry &entry = node->entries[packedIndex(node->entryMap, bit)];
+        return entry.hash == hash && LoxMap::sameKey(entry.key, key) ? &entry.value : nullptr;
+      }
+      if ((node->nodeMap & bit) == 0)
+        return nullptr;
+      node = node->children[packedIndex(node->nodeMap, bit)].get();
+    }
+    for (const Entry &entry : node->entries)
+    {
+      if (LoxMap::sameKey(entry.key, key))
+        return &entry.value;
+    }
+    return nullptr;
+  }
+
+  PersistentMap PersistentMap::set(const std::any &key, std::any value) const
+  {
+    bool added = false;
+    NodePtr updated = set(root, Entry{LoxMap::hashKey(key), key, std::move(value)}, 0, added);
+    return PersistentMap(count + (added ? 1 : 0), std::move(updated));
+  }
+
+  PersistentMap PersistentMap::remove(const std::any &key) const
+  {
+    bool removed = false;
+    NodePtr updated = remove(root, key, LoxMap::hashKey(key), 0, removed);
+    return removed ? PersistentMap(count - 1, std::move(updated)) : *this;
+  }
+
+  PersistentMap::NodePtr PersistentMap::set(const NodePtr &node, Entry entry, unsigned shift, bool &added)
+  {
+    auto copy = std::make_shared<Node>(*node);
+    if (shift >= HASH_BITS)
+    {
+      for (Entry &existing : copy->entries)
+      {
+        if (LoxMap::sameKey(existing.key, entry.key))
+        {
+          existing.value = std::move(entry.value);
+          return copy;
+        }
+      }
+      copy->entries.push_back(std::move(entry));
+      added = true;
+      return copy;
+    }
+
+    uint32_t bit = positionBit(entry.hash, shift);
+    if ((node->entryMap & bit) != 0)
+    {
+      size_t index = packedIndex(node->entryMap, bit);
+      Entry &existing = copy->entries[index];
+      if (existing.hash == entry.hash && LoxMap::sameKey(existing.key, entry.key))
+      {
+        existing.value = std::move(entry.value);
+        return copy;
+      }
+      // Two keys at one position move down into a subnode together.
+      NodePtr child = merge(std::move(existing), std::move(entry), shift + MAP_BITS);
+      copy->entries.erase(copy->entries.begin() + index);
+      copy->entryMap ^= bit;
+      copy->children.insert(copy->children.begin() + packedIndex(copy->nodeMap, bit), std::move(child));
+      copy->nodeMap |= bit;
+      added = true;
+      return copy;
+    }
+    if ((node->nodeMap & bit) != 0)
+    {
+      size_t index = packedIndex(node->nodeMap, bit);
+      copy->children[index] = set(node->children[index], std::move(entry), shift + MAP_BITS, added);
+      return copy;
+    }
+    copy->entries.insert(copy->entries.begin() + packedIndex(node->entryMap, bit), std::move(entry));
+    copy->entryMap |= bit;
+    added = true;
+    return copy;
+  }
+
+  PersistentMap::NodePtr PersistentMap::merge(Entry a, Entry b, unsigned shift)
+  {
+    auto node = std::make_shared<Node>();
+    if (shift >= HASH_BITS)
+    {
+      node->entries.push_back(std::move(a));
+      node->entries.push_back(std::move(b));
+      return node;
+    }
+    uint32_t bitA = positionBit(a.hash, shift);
+    uint32_t bitB = positionBit(b.hash, shift);
+    if (bitA == bitB)
+    {
+      node->nodeMap = bitA;
+      node->children.push_back(merge(std::move(a), std::move(b), shift + MAP_BITS));
+      return node;
+    }
+    node->entryMap = bitA | bitB;
+    if (bitB < bitA)
+      std::swap(a, b);
+    node->entries.push_back(std::move(a));
+    node->entries.push_back(std::move(b));
+    return node;
+  }
+
+  // Returns node itself when key is missing.
+  PersistentMap::NodePtr PersistentMap::remove(const NodePtr &node, const std::any &key, uint64_t hash, unsigned shift, bool &removed)
+  {
+    if (shift >= HASH_BITS)
+    {
+      for (size_t i = 0; i < node->entries.size(); i++)
+      {
+        if (LoxMap::sameKey(node->entries[i].key, key))
+        {
+          auto copy = std::make_shared<Node>(*node);
+          copy->entries.erase(copy->entries.begin() + i);
+          removed = true;
+          return copy;
+        }
+      }
+      return node;
+    }
+
+    uint32_t bit = positionBit(hash, shift);
+    if ((node->entryMap & bit) != 0)
+    {
+      size_t index = packedIndex(node->entryMap, bit);
+      const Entry &entry = node->entries[index];
+      if (entry.hash != hash || !LoxMap::sameKey(entry.key, key))
+        return node;
+      auto copy = std::make_shared<Node>(*node);
+      copy->entries.erase(copy->entries.begin() + index);
+      copy->entryMap ^= bit;
+      removed = true;
+      return copy;
+    }
+    if ((node->nodeMap & bit) == 0)
+      return node;
+
+    size_t index = packedIndex(node->nodeMap, bit);
+    NodePtr child = remove(node->children[index], key, hash, shift + MAP_BITS, removed);
+    if (!removed)
+      return node;
+    auto copy = std::make_shared<Node>(*node);
+    if (child->entries.size() == 1 && child->children.empty())
+    {
+      // A subnode down to one entry is replaced by the entry.
+      copy->children.erase(copy->children.begin() + index);
+      copy->nodeMap ^= bit;
+      copy->entries.insert(copy->entries.begin() + packedIndex(copy->entryMap, bit), child->entries[0]);
+      copy->entryMap |= bit;
+    }
+    else
+    {
+      copy->children[index] = std::move(child);
+    }
+    return copy;
+  }
+}
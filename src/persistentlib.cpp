@@ -0,0 +1,114 @@
+#include "cpplox/persistentlib.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/loxmap.h"
+#include "cpplox/persistent.h"
+
+namespace CppLox
+{
+  static const PersistentVector &vectorArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *vector = std::any_cast<std::shared_ptr<PersistentVector>>(&arguments[index]);
+    if (vector == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a persistent vector.");
+    return **vector;
+  }
+
+  static const PersistentMap &mapArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *map = std::any_cast<std::shared_ptr<PersistentMap>>(&arguments[index]);
+    if (map == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a persistent map.");
+    return **map;
+  }
+
+  static const std::any &keyArgument(const std::vector<std::any> &arguments, size_t index)
+  {
+    if (const char *error = LoxMap::keyError(arguments[index]))
+      throw NativeError(error);
+    return arguments[index];
+  }
+
+  static std::any makeVector(const std::vector<std::any> &arguments)
+  {
+    return std::make_shared<PersistentVector>();
+  }
+
+  static std::any makeMap(const std::vector<std::any> &arguments)
+  {
+    return std::make_shared<PersistentMap>();
+  }
+
+  static std::any toPersistent(const std::vector<std::any> &arguments)
+  {
+    if (const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&arguments[0]))
+    {
+      PersistentVector vector;
+      for (const std::any &element : (*list)->elements)
+        vector = vector.push(element);
+      return std::make_shared<PersistentVector>(std::move(vector));
+    }
+    const auto *map = std::any_cast<std::shared_ptr<LoxMap>>(&arguments[0]);
+    if (map == nullptr)
+      throw NativeError("Argument 1 of 'toPersistent' must be a list or a map.");
+    PersistentMap result;
+    (*map)->forEach([&result](const std::any &key, std::any &value)
+                    { result = result.set(key, value); });
+    return std::make_shared<PersistentMap>(std::move(result));
+  }
+
+  static std::any conj(const std::vector<std::any> &arguments)
+  {
+    return std::make_shared<PersistentVector>(vectorArgument(arguments, 0, "conj").push(arguments[1]));
+  }
+
+  static std::any assoc(const std::vector<std::any> &arguments)
+  {
+    if (const auto *map = std::any_cast<std::shared_ptr<PersistentMap>>(&arguments[0]))
+      return std::make_shared<PersistentMap>((*map)->set(keyArgument(arguments, 1), arguments[2]));
+    const auto *vector = std::any_cast<std::shared_ptr<PersistentVector>>(&arguments[0]);
+    if (vector == nullptr)
+      throw NativeError("Argument 1 of 'assoc' must be a persistent vector or map.");
+    size_t index = indexArgument(arguments, 1, "assoc", (*vector)->size());
+    if (index == (*vector)->size())
+      return std::make_shared<PersistentVector>((*vector)->push(arguments[2]));
+    return std::make_shared<PersistentVector>((*vector)->set(index, arguments[2]));
+  }
+
+  // Returns the map itself when the key is missing.
+  static std::any dissoc(const std::vector<std::any> &arguments)
+  {
+    const PersistentMap &map = mapArgument(arguments, 0, "dissoc");
+    const std::any &key = keyArgument(arguments, 1);
+    if (map.get(key) == nullptr)
+      return arguments[0];
+    return std::make_shared<PersistentMap>(map.remove(key));
+  }
+
+  static std::any dropLast(const std::vector<std::any> &arguments)
+  {
+    const PersistentVector &vector = vectorArgument(arguments, 0, "dropLast");
+    if (vector.size() == 0)
+      throw NativeError("Cannot drop from an empty vector.");
+    return std::make_shared<PersistentVector>(vector.pop());
+  }
+
+  static const NativeEntry PERSISTENT_LIBRARY[] = {
+      {"PersistentVector", 0, makeVector},
+      {"PersistentMap", 0, makeMap},
+      {"toPersistent", 1, toPersistent},
+      {"conj", 2, conj},
+      {"assoc", 3, assoc},
+      {"dissoc", 2, dissoc},
+      {"dropLast", 1, dropLast},
+  };
+
+  void definePersistentLibrary(Environment &globals)
+  {
+    defineNatives(globals, PERSISTENT_LIBRARY);
+  }
+
+  bool isPersistentLibraryFunction(const std::string &name)
+  {
+    return definesNative(PERSISTENT_LIBRARY, name);
+  }
+}
@@ -0,0 +1,324 @@
+#include <fstream>
+#include <sstream>
+
+#include "cpplox/profile.h"
+#include "cpplox/astcache.h"
+
+namespace CppLox
+{
+  static const char *const PROFILE_MAGIC = "cpplox-profile";
+  static const int PROFILE_VERSION = 2;
+
+  void Profile::index(const std::vector<StmtPtr> &stmts)
+  {
+    binaries.clear();
+    functions.clear();
+    for (const auto &stmt : stmts)
+    {
+      index(stmt.get());
+    }
+  }
+
+  void Profile::index(const Stmt *stmt)
+  {
+    if (stmt != nullptr)
+      stmt->accept(*this);
+  }
+
+  void Profile::index(const Expr *expr)
+  {
+    if (expr != nullptr)
+      expr->accept(*this);
+  }
+
+  bool Profile::load(const std::string &path, const std::string &source)
+  {
+    std::ifstream in(path);
+    std::string magic;
+    int version = 0;
+    uint64_t hash = 0;
+    if (!(in >> magic >> version >> std::hex >> hash >> std::dec) || magic != PROFILE_MAGIC ||
+        version != PROFILE_VERSION || hash != AstCache::hash(source))
+      return false;
+
+    // Read everything before applying any of it.
+    std::vector<std::pair<size_t, BinaryKind>> kinds;
+    std::vector<std::pair<size_t, uint64_t>> counts;
+    std::string tag;
+    size_t node;
+    uint64_t value;
+    while (in >> tag >> node >> value)
+    {
+      if (tag == "binary" && node < binaries.size() && value <= static_cast<uint64_t>(BinaryKind::NOT_EQUAL_INTEGERS))
+        kinds.emplace_back(node, static_cast<BinaryKind>(value));
+      else if (tag == "function" && node < functions.size())
+        counts.emplace_back(node, value);
+      else
+        return false;
+    }
+    if (!in.eof())
+      return false;
+
+    for (const auto &kind : kinds)
+    {
+      binaries[kind.first]->kind = kind.second;
+    }
+    for (const auto &count : counts)
+    {
+      calls[functions[count.first]] += count.second;
+    }
+    return true;
+  }
+
+  void Profile::save(const std::string &path, const std::string &source) const
+  {
+    std::ostringstream out;
+    out << PROFILE_MAGIC << " " << PROFILE_VERSION << " " << std::hex << AstCache::hash(source) << std::dec << "\n";
+    for (size_t i = 0; i < binaries.size(); i++)
+    {
+      // Nodes the optimizer replaced never ran.
+      if (binaries[i]->kind != BinaryKind::UNINITIALIZED)
+        out << "binary " << i << " " << static_cast<int>(binaries[i]->kind) << "\n";
+    }
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+      uint64_t count = callsTo(functions[i]);
+      if (count != 0)
+        out << "function " << i << " " << count << "\n";
+    }
+    std::ofstream(path) << out.str();
+  }
+
+  uint64_t Profile::callsTo(const Function *function) const
+  {
+    auto it = calls.find(function);
+    return it != calls.end() ? it->second : 0;
+  }
+
+  std::any Profile::visitBinaryExpr(const Binary *expr)
+  {
+    binaries.push_back(expr);
+    index(expr->left.get());
+    index(expr->right.get());
+    return std::any();
+  }
+
+  std::any Profile::visitGroupingExpr(const Grouping *expr)
+  {
+    index(expr->expression.get());
+    return std::any();
+  }
+
+  std::any Profile::visitLiteralExpr(const Literal *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitUnaryExpr(const Unary *expr)
+  {
+    index(expr->right.get());
+    return std::any();
+  }
+
+  std::any Profile::visitLogicalExpr(const Logical *expr)
+  {
+    index(expr->left.get());
+    index(expr->right.get());
+    return std::any();
+  }
+
+  std::any Profile::visitInterpolationExpr(const Interpolation *expr)
+  {
+    for (const auto &part : expr->parts)
+    {
+      index(part.get());
+    }
+    return std::any();
+  }
+
+  std::any Profile::visitExpressionStmt(const Expression *stmt)
+  {
+    index(stmt->expression.get());
+    return std::any();
+  }
+
+  std::any Profile::visitPrintStmt(const Print *stmt)
+  {
+    index(stmt->expression.get());
+    return std::any();
+  }
+
+  std::any Profile::visitVariableExpr(const Variable *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitVarStmt(const Var *stmt)
+  {
+    index(stmt->initializer.get());
+    return std::any();
+  }
+
+  std::any Profile::visitAssignExpr(const Assign *expr)
+  {
+    index(expr->value.get());
+    return std::any();
+  }
+
+  std::any Profile::visitBlockStmt(const Block *stmt)
+  {
+    for (const auto &inner : stmt->statements)
+    {
+      index(inner.get());
+    }
+    return std::any();
+  }
+
+  std::any Profile::visitIfStmt(const If *stmt)
+  {
+    index(stmt->condition.get());
+    index(stmt->thenBranch.get());
+    index(stmt->elseBranch.get());
+    return std::any();
+  }
+
+  std::any Profile::visitWhileStmt(const While *stmt)
+  {
+    index(stmt->condition.get());
+    index(stmt->body.get());
+    return std::any();
+  }
+
+  std::any Profile::visitCallExpr(const Call *expr)
+  {
+    index(expr->callee.get());
+    for (const auto &argument : expr->arguments)
+    {
+      index(argument.get());
+    }
+    return std::any();
+  }
+
+  std::any Profile::visitFunctionStmt(const Function *stmt)
+  {
+    functions.push_back(stmt);
+    for (const auto &inner : stmt->body)
+    {
+      index(inner.get());
+    }
+    return std::any();
+  }
+
+  std::any Profile::visitReturnStmt(const Return *stmt)
+  {
+    index(stmt->value.get());
+    return std::any();
+  }
+
+  std::any Profile::visitClassStmt(const Class *stmt)
+  {
+    index(stmt->superclass.get());
+    for (const auto &method : stmt->methods)
+    {
+      index(method.get());
+    }
+    return std::any();
+  }
+
+  std::any Profile::visitGetExpr(const Get *expr)
+  {
+    index(expr->object.get());
+    return std::any();
+  }
+
+  std::any Profile::visitSetExpr(const Set *expr)
+  {
+    index(expr->object.get());
+    index(expr->value.get());
+    return std::any();
+  }
+
+  std::any Profile::visitIndexExpr(const Index *expr)
+  {
+    index(expr->object.get());
+    index(expr->index.get());
+    return std::any();
+  }
+
+  std::any Profile::visitSetIndexExpr(const SetIndex *expr)
+  {
+    index(expr->object.get());
+    index(expr->index.get());
+    index(expr->value.get());
+    return std::any();
+  }
+
+  std::any Profile::visitSliceExpr(const Slice *expr)
+  {
+    index(expr->object.get());
+    index(expr->start.get());
+    index(expr->end.get());
+    return std::any();
+  }
+
+  std::any Profile::visitThisExpr(const This *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitSuperExpr(const Super *expr)
+  {
+    return std::any();
+  }
+
+  // The optimizer's nodes: the profile numbers the tree before it runs.
+  std::any Profile::visitAssignOpExpr(const AssignOp *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitArgRefExpr(const ArgRef *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitConditionalExpr(const Conditional *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitInvariantExpr(const Invariant *expr)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitForLoopStmt(const ForLoop *stmt)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    return std::any();
+  }
+
+  std::any Profile::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    return std::any();
+  }
+}
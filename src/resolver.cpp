@@ -1,6 +1,8 @@
 #pragma once
 
 #include <any>
+#include <string>
+#include <variant>
 #include "cpplox/resolver.h"
 #include "cpplox/interpreter.h"
 #include "cpplox/lox.h"
@@ -208,6 +210,88 @@ namespace CppLox
     return std::any();
   }
 
+  // Fused nodes are built after resolution and carry their own depths;
+  // only their operands need visiting.
+  std::any Resolver::visitForLoopStmt(const ForLoop *stmt)
+  {
+    resolve(stmt->condition);
+    beginScope();
+    resolve(stmt->body);
+    resolve(stmt->increment);
+    endScope();
+    return std::any();
+  }
+
+  std::any Resolver::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    beginScope();
+    declare(stmt->name);
+    resolve(stmt->start);
+    define(stmt->name);
+    resolve(stmt->limit);
+    beginScope();
+    resolve(stmt->body);
+    endScope();
+    endScope();
+    return std::any();
+  }
+
+  std::any Resolver::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    resolve(stmt->loop);
+    return std::any();
+  }
+
+  std::any Resolver::visitInvariantExpr(const Invariant *expr)
+  {
+    resolve(expr->expression);
+    return std::any();
+  }
+
+  std::any Resolver::visitAssignOpExpr(const AssignOp *expr)
+  {
+    resolve(expr->value);
+    return std::any();
+  }
+
+  std::any Resolver::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    resolve(expr->right);
+    return std::any();
+  }
+
+  std::any Resolver::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    resolve(expr->value);
+    resolve(expr->object);
+    return std::any();
+  }
+
+  // An inlined body is already resolved in the callee's scope; resolving it
+  // again here could bind its globals to locals of the caller.
+  std::any Resolver::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    resolve(expr->callee);
+    for (const auto &argument : expr->arguments)
+    {
+      resolve(argument);
+    }
+    return std::any();
+  }
+
+  std::any Resolver::visitArgRefExpr(const ArgRef *expr)
+  {
+    return std::any();
+  }
+
+  std::any Resolver::visitConditionalExpr(const Conditional *expr)
+  {
+    resolve(expr->condition);
+    resolve(expr->thenBranch);
+    resolve(expr->elseBranch);
+    return std::any();
+  }
+
   std::any Resolver::visitBinaryExpr(const Binary *expr)
   {
     resolve(expr->left);
@@ -245,6 +329,15 @@ namespace CppLox
     return std::any();
   }
 
+  std::any Resolver::visitInterpolationExpr(const Interpolation *expr)
+  {
+    for (const auto &part : expr->parts)
+    {
+      resolve(part);
+    }
+    return std::any();
+  }
+
   std::any Resolver::visitUnaryExpr(const Unary *expr)
   {
     resolve(expr->right);
@@ -314,6 +407,29 @@ namespace CppLox
     return std::any();
   }
 
+  std::any Resolver::visitIndexExpr(const Index *expr)
+  {
+    resolve(expr->object);
+    resolve(expr->index);
+    return std::any();
+  }
+
+  std::any Resolver::visitSetIndexExpr(const SetIndex *expr)
+  {
+    resolve(expr->value);
+    resolve(expr->object);
+    resolve(expr->index);
+    return std::any();
+  }
+
+  std::any Resolver::visitSliceExpr(const Slice *expr)
+  {
+    resolve(expr->object);
+    resolve(expr->start);
+    resolve(expr->end);
+    return std::any();
+  }
+
   std::any Resolver::visitThisExpr(const This *expr)
   {
     if (currentClass == ClassType::NONE)
@@ -338,4 +454,351 @@ namespace CppLox
     resolveLocal(expr, expr->keyword);
     return std::any();
   }
-}
\ No newline at end of file
+
+  bool TypeChecker::check(const std::vector<StmtPtr> &stmts)
+  {
+    analysis.analyze(stmts);
+    for (const auto &stmt : stmts)
+    {
+      check(stmt);
+    }
+    return valid;
+  }
+
+  void TypeChecker::check(const StmtPtr &stmt)
+  {
+    if (stmt != nullptr)
+    {
+      stmt->accept(*this);
+    }
+  }
+
+  std::string TypeChecker::typeOf(const ExprPtr &expr)
+  {
+    if (expr == nullptr)
+    {
+      return "";
+    }
+    return std::any_cast<std::string>(expr->accept(*this));
+  }
+
+  void TypeChecker::expect(Annotation annotation, const std::string &type, const Token &where)
+  {
+    if (annotation == Annotation::NONE || type.empty() || type == annotationName(annotation))
+    {
+      return;
+    }
+    lox::error(where, std::string("Expected a ") + annotationName(annotation) + " value but got a " + type + ".");
+    valid = false;
+  }
+
+  void TypeChecker::checkFunction(const Function *function)
+  {
+    for (size_t i = 0; i < function->paramTypes.size(); i++)
+    {
+      if (function->paramTypes[i] == Annotation::NONE)
+        continue;
+      const Binding *binding = analysis.bindingFor(&function->params[i]);
+      if (binding != nullptr)
+      {
+        annotations[binding] = function->paramTypes[i];
+      }
+    }
+    returnTypes.push_back(function->returnType);
+    for (const auto &stmt : function->body)
+    {
+      check(stmt);
+    }
+    returnTypes.pop_back();
+  }
+
+  std::any TypeChecker::visitBinaryExpr(const Binary *expr)
+  {
+    std::string left = typeOf(expr->left);
+    std::string right = typeOf(expr->right);
+    switch (expr->op.type)
+    {
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+      return std::string("num");
+    case TokenType::PLUS:
+      return left == right && (left == "num" || left == "str") ? left : std::string();
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+    case TokenType::EQUAL_EQUAL:
+    case TokenType::BANG_EQUAL:
+      return std::string("bool");
+    default:
+      return std::string();
+    }
+  }
+
+  std::any TypeChecker::visitGroupingExpr(const Grouping *expr)
+  {
+    return typeOf(expr->expression);
+  }
+
+  std::any TypeChecker::visitLiteralExpr(const Literal *expr)
+  {
+    if (std::holds_alternative<double>(expr->value) || std::holds_alternative<int64_t>(expr->value))
+      return std::string("num");
+    if (std::holds_alternative<std::string>(expr->value))
+      return std::string("str");
+    if (std::holds_alternative<bool>(expr->value))
+      return std::string("bool");
+    return std::string("nil");
+  }
+
+  std::any TypeChecker::visitUnaryExpr(const Unary *expr)
+  {
+    typeOf(expr->right);
+    return std::string(expr->op.type == TokenType::BANG ? "bool" : "num");
+  }
+
+  std::any TypeChecker::visitLogicalExpr(const Logical *expr)
+  {
+    std::string left = typeOf(expr->left);
+    std::string right = typeOf(expr->right);
+    return left == right ? left : std::string();
+  }
+
+  std::any TypeChecker::visitInterpolationExpr(const Interpolation *expr)
+  {
+    for (const auto &part : expr->parts)
+    {
+      typeOf(part);
+    }
+    return std::string("str");
+  }
+
+  std::any TypeChecker::visitExpressionStmt(const Expression *stmt)
+  {
+    typeOf(stmt->expression);
+    return std::any();
+  }
+
+  std::any TypeChecker::visitPrintStmt(const Print *stmt)
+  {
+    typeOf(stmt->expression);
+    return std::any();
+  }
+
+  std::any TypeChecker::visitVariableExpr(const Variable *expr)
+  {
+    auto it = annotations.find(analysis.bindingFor(expr));
+    return std::string(it != annotations.end() ? annotationName(it->second) : "");
+  }
+
+  std::any TypeChecker::visitVarStmt(const Var *stmt)
+  {
+    std::string type = typeOf(stmt->initializer);
+    if (stmt->annotation == Annotation::NONE)
+    {
+      return std::any();
+    }
+    if (stmt->initializer == nullptr)
+    {
+      lox::error(stmt->name, "An annotated variable needs an initializer.");
+      valid = false;
+    }
+    expect(stmt->annotation, type, stmt->name);
+    const Binding *binding = analysis.bindingFor(stmt);
+    if (binding != nullptr && !binding->global)
+    {
+      annotations[binding] = stmt->annotation;
+    }
+    return std::any();
+  }
+
+  // Only stores whose type is not evident keep a check at run time.
+  std::any TypeChecker::visitAssignExpr(const Assign *expr)
+  {
+    std::string type = typeOf(expr->value);
+    auto it = annotations.find(analysis.bindingFor(expr));
+    if (it != annotations.end())
+    {
+      expect(it->second, type, expr->name);
+      if (type != annotationName(it->second))
+      {
+        expr->annotation = it->second;
+      }
+    }
+    return type;
+  }
+
+  std::any TypeChecker::visitBlockStmt(const Block *stmt)
+  {
+    for (const auto &inner : stmt->statements)
+    {
+      check(inner);
+    }
+    return std::any();
+  }
+
+  std::any TypeChecker::visitIfStmt(const If *stmt)
+  {
+    typeOf(stmt->condition);
+    check(stmt->thenBranch);
+    check(stmt->elseBranch);
+    return std::any();
+  }
+
+  std::any TypeChecker::visitWhileStmt(const While *stmt)
+  {
+    typeOf(stmt->condition);
+    check(stmt->body);
+    return std::any();
+  }
+
+  std::any TypeChecker::visitCallExpr(const Call *expr)
+  {
+    typeOf(expr->callee);
+    for (const auto &argument : expr->arguments)
+    {
+      typeOf(argument);
+    }
+    return std::string();
+  }
+
+  std::any TypeChecker::visitFunctionStmt(const Function *stmt)
+  {
+    checkFunction(stmt);
+    return std::any();
+  }
+
+  std::any TypeChecker::visitReturnStmt(const Return *stmt)
+  {
+    std::string type = typeOf(stmt->value);
+    Annotation expected = returnTypes.empty() ? Annotation::NONE : returnTypes.back();
+    if (expected == Annotation::NONE)
+    {
+      return std::any();
+    }
+    std::string message = std::string("Expected a ") + annotationName(expected) + " return value";
+    if (stmt->value == nullptr)
+    {
+      lox::error(stmt->keyword, message + ".");
+      valid = false;
+    }
+    else if (!type.empty() && type != annotationName(expected))
+    {
+      lox::error(stmt->keyword, message + " but got a " + type + ".");
+      valid = false;
+    }
+    return std::any();
+  }
+
+  std::any TypeChecker::visitClassStmt(const Class *stmt)
+  {
+    typeOf(stmt->superclass);
+    for (const auto &method : stmt->methods)
+    {
+      auto *function = dynamic_cast<const Function *>(method.get());
+      if (function->name.lexeme == "init" && function->returnType != Annotation::NONE)
+      {
+        lox::error(function->name, "Cannot annotate the return type of an initializer.");
+        valid = false;
+      }
+      checkFunction(function);
+    }
+    return std::any();
+  }
+
+  std::any TypeChecker::visitGetExpr(const Get *expr)
+  {
+    typeOf(expr->object);
+    return std::string();
+  }
+
+  std::any TypeChecker::visitSetExpr(const Set *expr)
+  {
+    typeOf(expr->object);
+    return typeOf(expr->value);
+  }
+
+  std::any TypeChecker::visitIndexExpr(const Index *expr)
+  {
+    typeOf(expr->object);
+    typeOf(expr->index);
+    return std::string();
+  }
+
+  std::any TypeChecker::visitSetIndexExpr(const SetIndex *expr)
+  {
+    typeOf(expr->object);
+    typeOf(expr->index);
+    return typeOf(expr->value);
+  }
+
+  std::any TypeChecker::visitSliceExpr(const Slice *expr)
+  {
+    typeOf(expr->object);
+    typeOf(expr->start);
+    typeOf(expr->end);
+    return std::string();
+  }
+
+  std::any TypeChecker::visitThisExpr(const This *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitSuperExpr(const Super *expr)
+  {
+    return std::string();
+  }
+
+  // The checker runs before the optimizer introduces these.
+  std::any TypeChecker::visitAssignOpExpr(const AssignOp *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitCompareVariableExpr(const CompareVariable *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitSetFieldOpExpr(const SetFieldOp *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitInlinedCallExpr(const InlinedCall *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitArgRefExpr(const ArgRef *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitConditionalExpr(const Conditional *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitInvariantExpr(const Invariant *expr)
+  {
+    return std::string();
+  }
+
+  std::any TypeChecker::visitForLoopStmt(const ForLoop *stmt)
+  {
+    return std::any();
+  }
+
+  std::any TypeChecker::visitCountedLoopStmt(const CountedLoop *stmt)
+  {
+    return std::any();
+  }
+
+  std::any TypeChecker::visitInvariantLoopStmt(const InvariantLoop *stmt)
+  {
+    return std::any();
+  }
+}
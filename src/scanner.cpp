@@ -1,5 +1,6 @@
 
 #include <any>
+#include <charconv>
 #include <string>
 #include <vector>
 
@@ -108,11 +109,28 @@ namespace CppLox
       addToken(RIGHT_PAREN);
       break;
     case '{':
+      if (!interpolations.empty())
+        interpolations.back()++;
       addToken(LEFT_BRACE);
       break;
     case '}':
+      // The `}` that closes an interpolation resumes its string.
+      if (!interpolations.empty() && interpolations.back() == 0)
+      {
+        interpolations.pop_back();
+        string();
+        break;
+      }
+      if (!interpolations.empty())
+        interpolations.back()--;
       addToken(RIGHT_BRACE);
       break;
+    case '[':
+      addToken(LEFT_BRACKET);
+      break;
+    case ']':
+      addToken(RIGHT_BRACKET);
+      break;
     case ',':
       addToken(COMMA);
       break;
@@ -131,6 +149,9 @@ namespace CppLox
     case '*':
       addToken(STAR);
       break;
+    case ':':
+      addToken(COLON);
+      break;
     case '!':
       addToken(match('=') ? BANG_EQUAL : BANG);
       break;
@@ -191,9 +212,11 @@ namespace CppLox
     }
   }
 
+  // Scans the text after a `"`, or after the `}` closing an interpolation,
+  // up to the closing `"` or the next `${`.
   void Scanner::string()
   {
-    while (peek() != '"' && !isAtEnd())
+    while (peek() != '"' && !(peek() == '$' && peekNext() == '{') && !isAtEnd())
     {
       if (peek() == '\n')
         line++;
@@ -206,11 +229,19 @@ namespace CppLox
       return;
     }
 
+    // Trim the delimiters.
+    std::string value = source.substr(start + 1, current - start - 1);
+    if (peek() == '$')
+    {
+      advance();
+      advance();
+      interpolations.push_back(0);
+      addToken(INTERPOLATION, std::move(value));
+      return;
+    }
+
     // The closing ".
     advance();
-
-    // Trim the surrounding quotes.
-    std::string value = source.substr(start + 1, current - start - 2);
     addToken(STRING, std::move(value));
   }
 
@@ -221,6 +252,18 @@ namespace CppLox
       advance();
     }
 
+    // Integral literals that fit are integers.
+    if (peek() != '.' || !isDigit(peekNext()))
+    {
+      int64_t integer;
+      auto parsed = std::from_chars(source.data() + start, source.data() + current, integer);
+      if (parsed.ec == std::errc())
+      {
+        addToken(TokenType::NUMBER, integer);
+        return;
+      }
+    }
+
     if (peek() == '.' && isDigit(peekNext()))
     {
       advance();
@@ -0,0 +1,205 @@
+#include "cpplox/stringlib.h"
+#include "cpplox/loxarray.h"
+#include "cpplox/loxlist.h"
+#include "cpplox/loxmap.h"
+#include "cpplox/loxstring.h"
+#include "cpplox/persistent.h"
+
+namespace CppLox
+{
+  static const LoxStringRef &stringArgument(const std::vector<std::any> &arguments, size_t index, const char *function)
+  {
+    const auto *string = std::any_cast<LoxStringRef>(&arguments[index]);
+    if (string == nullptr)
+      throw NativeError("Argument " + std::to_string(index + 1) + " of '" + function + "' must be a string.");
+    return *string;
+  }
+
+  // The length of a string in bytes, or of a list, an array, a map or a
+  // persistent collection.
+  static std::any len(const std::vector<std::any> &arguments)
+  {
+    if (const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&arguments[0]))
+      return static_cast<int64_t>((*list)->elements.size());
+    if (const auto *array = std::any_cast<std::shared_ptr<Float64Array>>(&arguments[0]))
+      return static_cast<int64_t>((*array)->elements.size());
+    if (const auto *map = std::any_cast<std::shared_ptr<LoxMap>>(&arguments[0]))
+      return static_cast<int64_t>((*map)->size());
+    if (const auto *vector = std::any_cast<std::shared_ptr<PersistentVector>>(&arguments[0]))
+      return static_cast<int64_t>((*vector)->size());
+    if (const auto *map = std::any_cast<std::shared_ptr<PersistentMap>>(&arguments[0]))
+      return static_cast<int64_t>((*map)->size());
+    const auto *string = std::any_cast<LoxStringRef>(&arguments[0]);
+    if (string == nullptr)
+      throw NativeError("Argument 1 of 'len' must be a string or a collection.");
+    return static_cast<int64_t>((*string)->length());
+  }
+
+  // substr(s, start, end): the characters from start up to, not including,
+  // end.
+  static std::any substr(const std::vector<std::any> &arguments)
+  {
+    const LoxStringRef &string = stringArgument(arguments, 0, "substr");
+    size_t start = indexArgument(arguments, 1, "substr", string->length());
+    size_t end = indexArgument(arguments, 2, "substr", string->length());
+    if (end < start)
+      throw NativeError("End of 'substr' is before its start.");
+    return string.slice(start, end - start);
+  }
+
+  // The index of the first occurrence of the needle, or -1.
+  static std::any indexOf(const std::vector<std::any> &arguments)
+  {
+    std::string_view haystack = stringArgument(arguments, 0, "indexOf")->view();
+    std::string_view needle = stringArgument(arguments, 1, "indexOf")->view();
+    size_t index = haystack.find(needle);
+    return index == std::string_view::npos ? int64_t(-1) : static_cast<int64_t>(index);
+  }
+
+  // Replaces every occurrence, left to right. A string without one is
+  // returned as is.
+  static std::any replace(const std::vector<std::any> &arguments)
+  {
+    const LoxStringRef &string = stringArgument(arguments, 0, "replace");
+    std::string_view haystack = string->view();
+    std::string_view pattern = stringArgument(arguments, 1, "replace")->view();
+    std::string_view replacement = stringArgument(arguments, 2, "replace")->view();
+    if (pattern.empty())
+      throw NativeError("Cannot replace an empty string.");
+
+    size_t match = haystack.find(pattern);
+    if (match == std::string_view::npos)
+      return string;
+    std::string result;
+    size_t start = 0;
+    for (; match != std::string_view::npos; match = haystack.find(pattern, start))
+    {
+      result.append(haystack.data() + start, match - start);
+      result.append(replacement);
+      start = match + pattern.size();
+    }
+    result.append(haystack.substr(start));
+    return LoxStringRef(std::move(result));
+  }
+
+  static std::any startsWith(const std::vector<std::any> &arguments)
+  {
+    std::string_view string = stringArgument(arguments, 0, "startsWith")->view();
+    std::string_view prefix = stringArgument(arguments, 1, "startsWith")->view();
+    return string.size() >= prefix.size() && string.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  static std::any endsWith(const std::vector<std::any> &arguments)
+  {
+    std::string_view string = stringArgument(arguments, 0, "endsWith")->view();
+    std::string_view suffix = stringArgument(arguments, 1, "endsWith")->view();
+    return string.size() >= suffix.size() && string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  // ASCII only. The loop has no branches, so the compiler vectorizes it.
+  static LoxStringRef changeCase(std::string_view string, char first, char last)
+  {
+    std::string result(string);
+    for (char &c : result)
+    {
+      c ^= static_cast<char>((static_cast<unsigned char>(c - first) <= static_cast<unsigned char>(last - first)) << 5);
+    }
+    return LoxStringRef(std::move(result));
+  }
+
+  static std::any toUpper(const std::vector<std::any> &arguments)
+  {
+    return changeCase(stringArgument(arguments, 0, "toUpper")->view(), 'a', 'z');
+  }
+
+  static std::any toLower(const std::vector<std::any> &arguments)
+  {
+    return changeCase(stringArgument(arguments, 0, "toLower")->view(), 'A', 'Z');
+  }
+
+  static std::any trim(const std::vector<std::any> &arguments)
+  {
+    const LoxStringRef &string = stringArgument(arguments, 0, "trim");
+    std::string_view chars = string->view();
+    const char *const whitespace = " \t\r\n\v\f";
+    size_t start = chars.find_first_not_of(whitespace);
+    if (start == std::string_view::npos)
+      return string.slice(0, 0);
+    size_t end = chars.find_last_not_of(whitespace) + 1;
+    return string.slice(start, end - start);
+  }
+
+  // split(s, sep): a list of the slices between occurrences of sep, so n
+  // occurrences give n + 1 strings, empty ones included.
+  static std::any split(const std::vector<std::any> &arguments)
+  {
+    const LoxStringRef &string = stringArgument(arguments, 0, "split");
+    std::string_view chars = string->view();
+    std::string_view separator = stringArgument(arguments, 1, "split")->view();
+    if (separator.empty())
+      throw NativeError("Cannot split on an empty string.");
+
+    auto list = std::make_shared<LoxList>();
+    size_t start = 0;
+    for (size_t match = chars.find(separator); match != std::string_view::npos; match = chars.find(separator, start))
+    {
+      list->elements.push_back(string.slice(start, match - start));
+      start = match + separator.size();
+    }
+    list->elements.push_back(string.slice(start, chars.size() - start));
+    return list;
+  }
+
+  // join(list, sep): the list's strings with sep between each two. The
+  // result is sized before anything is copied.
+  static std::any join(const std::vector<std::any> &arguments)
+  {
+    const auto *list = std::any_cast<std::shared_ptr<LoxList>>(&arguments[0]);
+    if (list == nullptr)
+      throw NativeError("Argument 1 of 'join' must be a list.");
+    std::string_view separator = stringArgument(arguments, 1, "join")->view();
+
+    const std::vector<std::any> &elements = (*list)->elements;
+    size_t length = 0;
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+      const auto *element = std::any_cast<LoxStringRef>(&elements[i]);
+      if (element == nullptr)
+        throw NativeError("Element " + std::to_string(i) + " of the list given to 'join' is not a string.");
+      length += (*element)->length() + (i > 0 ? separator.size() : 0);
+    }
+    std::string result;
+    result.reserve(length);
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+      if (i > 0)
+        result.append(separator);
+      result.append((*std::any_cast<LoxStringRef>(&elements[i]))->view());
+    }
+    return LoxStringRef(std::move(result));
+  }
+
+  static const NativeEntry STRING_LIBRARY[] = {
+      {"len", 1, len},
+      {"substr", 3, substr},
+      {"indexOf", 2, indexOf},
+      {"replace", 3, replace},
+      {"startsWith", 2, startsWith},
+      {"endsWith", 2, endsWith},
+      {"toUpper", 1, toUpper},
+      {"toLower", 1, toLower},
+      {"trim", 1, trim},
+      {"split", 2, split},
+      {"join", 2, join},
+  };
+
+  void defineStringLibrary(Environment &globals)
+  {
+    defineNatives(globals, STRING_LIBRARY);
+  }
+
+  bool isStringLibraryFunction(const std::string &name)
+  {
+    return definesNative(STRING_LIBRARY, name);
+  }
+}
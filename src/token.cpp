@@ -16,7 +16,9 @@ namespace CppLox
         using T = std::decay_t<decltype(arg)>;
         if constexpr (std::is_same_v<T, std::nullptr_t>)
             return "null";
-        else if constexpr (std::is_same_v<T, int>)
+        else if constexpr (std::is_same_v<T, bool>)
+            return arg ? "true" : "false";
+        else if constexpr (std::is_same_v<T, int64_t>)
             return std::to_string(arg);
         else if constexpr (std::is_same_v<T, double>)
             return std::to_string(arg);
@@ -6,8 +6,11 @@ FILE_TEMPLATE = """
 #include <memory>
 #include <utility>
 #include <any>
+#include <cstdint>
 
 #include "token.h"
+#include "quickening.h"
+#include "annotation.h"
 
 using namespace std;
 
@@ -74,6 +77,12 @@ def _build_forward_declarations(visitor_class_names: List[str]) -> str:
     )
 
 
+def _build_external_declarations(external_class_names: List[str]) -> str:
+    return "".join(
+        [f"struct {external_class};\n" for external_class in external_class_names]
+    )
+
+
 def _build_visitor_methods(base_class: str, visitor_class_names: List[str]) -> str:
     return "\n".join(
         [
@@ -88,29 +97,31 @@ def _build_member_list(member_list: List[str]) -> str:
 
 
 def _build_constructor(visitor_class, member_list: List[str]) -> str:
-    member_names = [member.split()[1].strip() for member in member_list]
+    member_names = [member.split()[-1].lstrip("*&") for member in member_list]
     return f"{visitor_class}({', '.join(member_list)}) : {', '.join([f'{name}(std::move({name}))' for name in member_names])} {{}}"
 
 
-def _build_derived_class(base_class, visitor_class, member_list):
+def _build_derived_class(base_class, visitor_class, member_list, extra_members):
     return DERIVED_CLS_TEMPLATE.format(
         base_cls=base_class,
         visitor_cls=visitor_class,
         constructor=_build_constructor(visitor_class, member_list),
-        members=_build_member_list(member_list),
+        members=_build_member_list(member_list + extra_members),
     )
 
 
-def generate_cpp(output_dir, base_class, vistor_class_info):
+def generate_cpp(output_dir, base_class, vistor_class_info, external_classes):
     visitor_class_names = [info[0] for info in vistor_class_info]
-    forward_declartions = _build_forward_declarations(visitor_class_names)
+    forward_declartions = _build_external_declarations(
+        external_classes
+    ) + _build_forward_declarations(visitor_class_names)
     visitor_cls_declarations = VISITOR_CLS_TEMPLATE.format(
         base_cls=base_class,
         virtual_methods=_build_visitor_methods(base_class, visitor_class_names),
     )
     derived_classes = "\n".join(
         [
-            _build_derived_class(base_class, info[0], info[1].split(","))
+            _build_derived_class(base_class, info[0], info[1].split(","), info[2])
             for info in vistor_class_info
         ]
     )
@@ -143,19 +154,32 @@ def generate_files(output_dir):
         {
             "base_class": "Expr",
             "visitor_classes": [
-                "Binary   : ExprPtr left, Token op, ExprPtr right",
+                "Binary   : ExprPtr left, Token op, ExprPtr right | mutable BinaryKind kind = BinaryKind::UNINITIALIZED; mutable bool proven = false",
                 "Call     : ExprPtr callee, Token paren, vector<ExprPtr> arguments",
                 "Get      : ExprPtr object, Token name",
                 "Set      : ExprPtr object, Token name, ExprPtr value",
+                "Index    : ExprPtr object, Token bracket, ExprPtr index",
+                "SetIndex : ExprPtr object, Token bracket, ExprPtr index, ExprPtr value",
+                "Slice    : ExprPtr object, Token bracket, ExprPtr start, ExprPtr end",
                 "Super    : Token keyword, Token method",
                 "Grouping : ExprPtr expression",
-                "Literal  : LiteralType value",
+                "Literal  : LiteralType value | std::any materialized = toAny(value)",
                 "This     : Token keyword",
-                "Unary    : Token op, ExprPtr right",
+                "Unary    : Token op, ExprPtr right | mutable bool proven = false",
                 "Variable : Token name",
-                "Assign   : Token name, ExprPtr value",
+                "Assign   : Token name, ExprPtr value | mutable Annotation annotation = Annotation::NONE",
                 "Logical  : ExprPtr left, Token op, ExprPtr right",
+                "Interpolation   : Token quote, vector<ExprPtr> parts",
+                "AssignOp        : Token name, int depth, Token op, ExprPtr value",
+                "CompareVariable : Token name, int depth, Token op, ExprPtr right",
+                "SetFieldOp      : ExprPtr object, Token name, Token op, ExprPtr value",
+                "InlinedCall     : ExprPtr callee, Token paren, vector<ExprPtr> arguments, const Function *target, ExprPtr body",
+                "ArgRef          : Token name, int slot",
+                "Conditional     : ExprPtr condition, ExprPtr thenBranch, ExprPtr elseBranch",
+                "Invariant       : ExprPtr expression, const InvariantLoop *loop | mutable std::any value; mutable uint64_t activation = 0",
             ],
+            # Statement types referenced by expression nodes.
+            "external_classes": ["Function", "InvariantLoop"],
         },
         {
             "base_class": "Stmt",
@@ -165,20 +189,39 @@ def generate_files(output_dir):
                 "Expression : ExprPtr expression",
                 "Print      : ExprPtr expression",
                 "Return     : Token keyword, ExprPtr value",
-                "Var        : Token name, ExprPtr initializer",
-                "Function   : Token name, vector<Token> params, vector<StmtPtr> body",
+                "Var        : Token name, ExprPtr initializer, Annotation annotation",
+                "Function   : Token name, vector<Token> params, vector<StmtPtr> body, vector<Annotation> paramTypes, Annotation returnType",
                 "If         : ExprPtr condition, StmtPtr thenBranch, StmtPtr elseBranch",
                 "While      : ExprPtr condition, StmtPtr body",
+                "ForLoop    : ExprPtr condition, vector<StmtPtr> body, ExprPtr increment",
+                "CountedLoop : Token name, ExprPtr start, Token op, ExprPtr limit, Token stepOp, double step, vector<StmtPtr> body, bool materialize",
+                "InvariantLoop : StmtPtr loop | mutable uint64_t activation = 0",
             ],
         },
     ]
 
+    # Members after "|" are ";"-separated fields with default initializers
+    # that are not constructor parameters.
     for ast in ast_list:
-        visitor_class_info = [info.split(":") for info in ast["visitor_classes"]]
+        visitor_class_info = [info.split(":", 1) for info in ast["visitor_classes"]]
+        visitor_class_info = [
+            (info[0].strip(), *info[1].partition("|")[::2])
+            for info in visitor_class_info
+        ]
         visitor_class_info = [
-            (info[0].strip(), info[1].strip()) for info in visitor_class_info
+            (
+                name,
+                fields.strip(),
+                [extra.strip() for extra in extras.split(";") if extra.strip()],
+            )
+            for name, fields, extras in visitor_class_info
         ]
-        generate_cpp(output_dir, ast["base_class"], visitor_class_info)
+        generate_cpp(
+            output_dir,
+            ast["base_class"],
+            visitor_class_info,
+            ast.get("external_classes", []),
+        )
 
 
 if "__main__" == __name__:
@@ -0,0 +1,68 @@
+import argparse
+import difflib
+import os
+import subprocess
+import sys
+import tempfile
+
+# Runs every .lox program in a directory through the interpreter and through
+# the C it compiles to with --emit-c, and compares each output with the
+# program's .expected file.
+
+
+def run(command):
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=60)
+    return result.stdout.decode()
+
+
+def compiled_output(cpplox, compiler, script, work):
+    source = os.path.join(work, "program.c")
+    binary = os.path.join(work, "program")
+    run([cpplox, "--emit-c", source, script])
+    if not os.path.exists(source):
+        return "cpplox --emit-c wrote no C for this program\n"
+    compile = subprocess.run([compiler, "-O2", "-w", source, "-o", binary, "-lm"], stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT)
+    if compile.returncode != 0:
+        return compile.stdout.decode()
+    return run([binary])
+
+
+def report(name, how, expected, got):
+    if got == expected:
+        return True
+    print("FAIL {} ({})".format(name, how))
+    sys.stdout.writelines(difflib.unified_diff(expected.splitlines(True), got.splitlines(True), "expected", how))
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("cpplox", help="the cpplox binary")
+    parser.add_argument("directory", help="holds NAME.lox and NAME.expected pairs")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="the C compiler")
+    args = parser.parse_args()
+
+    cpplox = os.path.abspath(args.cpplox)
+    scripts = sorted(name for name in os.listdir(args.directory) if name.endswith(".lox"))
+    failures = 0
+    for name in scripts:
+        script = os.path.join(args.directory, name)
+        with open(script[:-len(".lox")] + ".expected") as file:
+            expected = file.read()
+        with tempfile.TemporaryDirectory() as work:
+            outputs = [
+                ("interpreter", run([cpplox, script])),
+                ("interpreter --no-opt --no-jit", run([cpplox, "--no-opt", "--no-jit", script])),
+                ("--emit-c", compiled_output(cpplox, args.cc, script, work)),
+            ]
+        passed = all([report(name, how, expected, got) for how, got in outputs])
+        if not passed:
+            failures += 1
+
+    print("{} of {} programs agree".format(len(scripts) - failures, len(scripts)))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())